@@ -0,0 +1,441 @@
+/* clog-bench: per-call latency distributions and throughput of clog.
+ *
+ * Usage: clog-bench [-t max_threads] [-n calls_per_thread] [-o results]
+ *                   [-b baseline] [--fd] [--async]
+ *
+ * Every case logs n calls on each of 1, 2, 4... max_threads threads and
+ * times each call. One JSON object per case goes to the results file
+ * (stdout by default) and a table to stderr. With -b, each case is also
+ * compared with the same case in an earlier results file. On Linux, cycles
+ * and instructions per call come from perf_event_open when the kernel
+ * allows it. */
+#include "../clog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if CLOG_POSIX
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#endif
+
+#define BENCH_MAX_THREADS 64
+
+typedef enum {
+  CASE_FILTERED,
+  CASE_CATEGORY,
+  CASE_SHORT,
+  CASE_LONG
+} bench_kind_t;
+
+typedef struct {
+  const char *name;
+  bench_kind_t kind;
+  bool color;
+} bench_case_t;
+
+static const bench_case_t bench_cases[] = {
+    {"filtered", CASE_FILTERED, false},
+    {"category", CASE_CATEGORY, false},
+    {"short", CASE_SHORT, false},
+    {"short_color", CASE_SHORT, true},
+    {"long", CASE_LONG, false},
+};
+
+static const char *const bench_targets[] = {"devnull", "file", "pipe"};
+
+typedef struct {
+  pthread_t thread;
+  const bench_case_t *bcase;
+  size_t calls;
+  uint32_t *latencies; /* Nanoseconds per call */
+  uint64_t cycles;
+  uint64_t instructions;
+  bool counted;
+} bench_worker_t;
+
+static char long_message[512];
+static atomic_int start_flag;
+static atomic_int ready_count;
+static bool perf_available = true;
+
+#ifdef __linux__
+/* Opens a disabled user-space hardware counter for the calling thread */
+static int perf_open(uint64_t config) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.size = sizeof(attr);
+  attr.config = config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+static void *bench_worker(void *arg) {
+  bench_worker_t *worker = (bench_worker_t *)arg;
+  const bench_case_t *bcase = worker->bcase;
+  int cycles_fd = -1;
+  int instructions_fd = -1;
+
+#ifdef __linux__
+  if (perf_available) {
+    cycles_fd = perf_open(PERF_COUNT_HW_CPU_CYCLES);
+    instructions_fd = perf_open(PERF_COUNT_HW_INSTRUCTIONS);
+  }
+#endif
+
+  atomic_fetch_add(&ready_count, 1);
+  while (!atomic_load(&start_flag))
+    sched_yield();
+
+#ifdef __linux__
+  if (cycles_fd >= 0 && instructions_fd >= 0) {
+    ioctl(cycles_fd, PERF_EVENT_IOC_ENABLE, 0);
+    ioctl(instructions_fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+  for (size_t i = 0; i < worker->calls; i++) {
+    uint64_t t0 = clog_now_ns();
+    switch (bcase->kind) {
+    case CASE_FILTERED:
+      TRACE("Filtered message %zu", i);
+      break;
+    case CASE_CATEGORY:
+      CLOG_CAT_DEBUG("bench.net.http", "Filtered category message %zu", i);
+      break;
+    case CASE_SHORT:
+      INFO("Short message %zu", i);
+      break;
+    case CASE_LONG:
+      INFO("Long message %zu %s", i, long_message);
+      break;
+    }
+    uint64_t elapsed = clog_now_ns() - t0;
+    worker->latencies[i] =
+        elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+  }
+#ifdef __linux__
+  if (cycles_fd >= 0 && instructions_fd >= 0) {
+    ioctl(cycles_fd, PERF_EVENT_IOC_DISABLE, 0);
+    ioctl(instructions_fd, PERF_EVENT_IOC_DISABLE, 0);
+    worker->counted =
+        read(cycles_fd, &worker->cycles, sizeof(uint64_t)) ==
+            sizeof(uint64_t) &&
+        read(instructions_fd, &worker->instructions, sizeof(uint64_t)) ==
+            sizeof(uint64_t);
+  }
+  if (cycles_fd >= 0)
+    close(cycles_fd);
+  if (instructions_fd >= 0)
+    close(instructions_fd);
+#endif
+  return NULL;
+}
+
+/* Drains the read end of the pipe target */
+static void *pipe_drain(void *arg) {
+  int fd = *(int *)arg;
+  char buf[65536];
+  while (read(fd, buf, sizeof(buf)) > 0) {
+  }
+  return NULL;
+}
+
+static int compare_u32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static uint32_t percentile(const uint32_t *sorted, size_t n, double p) {
+  size_t index = (size_t)(p * (double)(n - 1) + 0.5);
+  return sorted[index];
+}
+
+/* Cost of the two clock reads around each call. Latencies include it; it
+ * is reported so that the filtered case can be read in context */
+static uint32_t timer_overhead(void) {
+  uint64_t best = UINT64_MAX;
+  for (int i = 0; i < 1000; i++) {
+    uint64_t t0 = clog_now_ns();
+    uint64_t t1 = clog_now_ns();
+    if (t1 - t0 < best)
+      best = t1 - t0;
+  }
+  return (uint32_t)best;
+}
+
+/* Looks up "key": value in one JSON line */
+static bool json_number(const char *line, const char *key, double *value) {
+  char pattern[64];
+  snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+  const char *p = strstr(line, pattern);
+  if (!p)
+    return false;
+  *value = strtod(p + strlen(pattern), NULL);
+  return true;
+}
+
+/* Finds the baseline line of the same case */
+static bool baseline_find(FILE *baseline, const char *key, double *p50,
+                          double *p99, double *throughput) {
+  char line[1024];
+  if (!baseline)
+    return false;
+  rewind(baseline);
+  while (fgets(line, sizeof(line), baseline)) {
+    if (strstr(line, key) && json_number(line, "p50_ns", p50) &&
+        json_number(line, "p99_ns", p99) &&
+        json_number(line, "calls_per_sec", throughput))
+      return true;
+  }
+  return false;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-t max_threads] [-n calls_per_thread] [-o results] "
+          "[-b baseline] [--fd] [--async]\n",
+          argv0);
+}
+
+int main(int argc, char **argv) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  int max_threads = cpus > 4 ? (int)cpus : 4;
+  size_t calls = 20000;
+  const char *results_path = NULL;
+  const char *baseline_path = NULL;
+  bool use_fd = false;
+  bool use_async = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+      max_threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      calls = (size_t)strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      results_path = argv[++i];
+    } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+      baseline_path = argv[++i];
+    } else if (strcmp(argv[i], "--fd") == 0) {
+      use_fd = true;
+    } else if (strcmp(argv[i], "--async") == 0) {
+      use_async = true;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (max_threads < 1 || max_threads > BENCH_MAX_THREADS || calls == 0) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  FILE *results = stdout;
+  if (results_path && strcmp(results_path, "-") != 0) {
+    results = fopen(results_path, "w");
+    if (!results) {
+      perror(results_path);
+      return 1;
+    }
+  }
+  FILE *baseline = NULL;
+  if (baseline_path) {
+    baseline = fopen(baseline_path, "r");
+    if (!baseline) {
+      perror(baseline_path);
+      return 1;
+    }
+  }
+
+#ifdef __linux__
+  int probe = perf_open(PERF_COUNT_HW_CPU_CYCLES);
+  perf_available = probe >= 0;
+  if (probe >= 0)
+    close(probe);
+#else
+  perf_available = false;
+#endif
+
+  memset(long_message, 'x', sizeof(long_message) - 1);
+  /* A full category table: the cached call-site check must not scan it */
+  for (int i = 0; i < CLOG_MAX_CATEGORIES - 1; i++) {
+    char name[32];
+    snprintf(name, sizeof(name), "bench.other%d", i);
+    clog_set_category_level(name, CLOG_DEBUG);
+  }
+  clog_set_category_level("bench.net", CLOG_INFO);
+  uint32_t overhead = timer_overhead();
+  uint32_t *latencies = (uint32_t *)malloc(calls * (size_t)max_threads *
+                                           sizeof(uint32_t));
+  if (!latencies) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  fprintf(stderr,
+          "clog-bench: %zu calls per thread, timer overhead %u ns%s%s\n",
+          calls, overhead, use_fd ? ", fd sink" : ", FILE* sink",
+          use_async ? ", async" : "");
+  fprintf(stderr, "%-12s %-8s %3s %12s %8s %8s %8s %9s %8s %8s%s\n", "case",
+          "target", "thr", "calls/s", "p50", "p99", "p99.9", "max", "cyc",
+          "ins", baseline ? "  vs baseline" : "");
+
+  for (size_t c = 0; c < sizeof(bench_cases) / sizeof(bench_cases[0]); c++) {
+    const bench_case_t *bcase = &bench_cases[c];
+    for (size_t t = 0; t < sizeof(bench_targets) / sizeof(bench_targets[0]);
+         t++) {
+      /* A filtered call never reaches the output */
+      if ((bcase->kind == CASE_FILTERED || bcase->kind == CASE_CATEGORY) &&
+          t > 0)
+        continue;
+      for (int threads = 1; threads <= max_threads;
+           threads = threads < max_threads && threads * 2 > max_threads
+                         ? max_threads
+                         : threads * 2) {
+        /* Set up the target */
+        int fds[2] = {-1, -1};
+        int fd = -1;
+        pthread_t drain;
+        char path[] = "/tmp/clog-bench-XXXXXX";
+        if (strcmp(bench_targets[t], "devnull") == 0) {
+          fd = open("/dev/null", O_WRONLY);
+        } else if (strcmp(bench_targets[t], "file") == 0) {
+          fd = mkstemp(path);
+        } else if (pipe(fds) == 0) {
+          fd = fds[1];
+          pthread_create(&drain, NULL, pipe_drain, &fds[0]);
+        }
+        if (fd < 0) {
+          perror(bench_targets[t]);
+          return 1;
+        }
+        FILE *fp = NULL;
+        if (use_fd) {
+          clog_set_output_fd(fd);
+        } else {
+          fp = fdopen(fd, "w");
+          clog_set_output(fp);
+        }
+        clog_set_level(CLOG_INFO);
+        clog_set_color_mode(bcase->color ? CLOG_COLOR_ALWAYS
+                                         : CLOG_COLOR_NEVER);
+        if (use_async)
+          clog_set_async(true);
+
+        /* Run */
+        bench_worker_t workers[BENCH_MAX_THREADS];
+        atomic_store(&start_flag, 0);
+        atomic_store(&ready_count, 0);
+        for (int w = 0; w < threads; w++) {
+          memset(&workers[w], 0, sizeof(workers[w]));
+          workers[w].bcase = bcase;
+          workers[w].calls = calls;
+          workers[w].latencies = latencies + (size_t)w * calls;
+          pthread_create(&workers[w].thread, NULL, bench_worker, &workers[w]);
+        }
+        while (atomic_load(&ready_count) < threads)
+          sched_yield();
+        uint64_t start = clog_now_ns();
+        atomic_store(&start_flag, 1);
+        for (int w = 0; w < threads; w++)
+          pthread_join(workers[w].thread, NULL);
+        clog_flush();
+        uint64_t wall_ns = clog_now_ns() - start;
+
+        /* Tear the target down */
+        if (use_async)
+          clog_set_async(false);
+        if (use_fd)
+          clog_set_output_fd(-1);
+        else
+          clog_set_output(NULL);
+        if (fp)
+          fclose(fp);
+        else
+          close(fd);
+        if (fds[0] >= 0) {
+          pthread_join(drain, NULL);
+          close(fds[0]);
+        }
+        if (strcmp(bench_targets[t], "file") == 0)
+          unlink(path);
+
+        /* Report */
+        size_t total = calls * (size_t)threads;
+        qsort(latencies, total, sizeof(uint32_t), compare_u32);
+        uint64_t cycles = 0;
+        uint64_t instructions = 0;
+        bool counted = perf_available;
+        for (int w = 0; w < threads; w++) {
+          counted = counted && workers[w].counted;
+          cycles += workers[w].cycles;
+          instructions += workers[w].instructions;
+        }
+        double throughput =
+            wall_ns ? (double)total * 1e9 / (double)wall_ns : 0.0;
+        uint32_t p50 = percentile(latencies, total, 0.50);
+        uint32_t p99 = percentile(latencies, total, 0.99);
+        uint32_t p999 = percentile(latencies, total, 0.999);
+        uint32_t max = latencies[total - 1];
+        double cycles_per_call = counted ? (double)cycles / (double)total : 0;
+        double instructions_per_call =
+            counted ? (double)instructions / (double)total : 0;
+
+        char key[128];
+        snprintf(key, sizeof(key),
+                 "\"case\":\"%s\",\"target\":\"%s\",\"threads\":%d,",
+                 bcase->name, bench_targets[t], threads);
+        fprintf(results,
+                "{%s\"sink\":\"%s\",\"async\":%s,\"calls\":%zu,"
+                "\"calls_per_sec\":%.0f,\"p50_ns\":%u,\"p99_ns\":%u,"
+                "\"p999_ns\":%u,\"max_ns\":%u,\"timer_ns\":%u",
+                key, use_fd ? "fd" : "file", use_async ? "true" : "false",
+                total, throughput, p50, p99, p999, max, overhead);
+        if (counted)
+          fprintf(results, ",\"cycles_per_call\":%.1f,"
+                           "\"instructions_per_call\":%.1f",
+                  cycles_per_call, instructions_per_call);
+        fprintf(results, "}\n");
+
+        fprintf(stderr, "%-12s %-8s %3d %12.0f %8u %8u %8u %9u", bcase->name,
+                bench_targets[t], threads, throughput, p50, p99, p999, max);
+        if (counted)
+          fprintf(stderr, " %8.0f %8.0f", cycles_per_call,
+                  instructions_per_call);
+        else
+          fprintf(stderr, " %8s %8s", "-", "-");
+        double base_p50, base_p99, base_throughput;
+        if (baseline_find(baseline, key, &base_p50, &base_p99,
+                          &base_throughput) &&
+            base_p50 > 0 && base_p99 > 0 && base_throughput > 0)
+          fprintf(stderr, "  %+6.1f%% calls/s %+6.1f%% p50 %+6.1f%% p99",
+                  100.0 * (throughput / base_throughput - 1.0),
+                  100.0 * (p50 / base_p50 - 1.0),
+                  100.0 * (p99 / base_p99 - 1.0));
+        fprintf(stderr, "\n");
+
+        if (threads == max_threads)
+          break;
+      }
+    }
+  }
+
+  free(latencies);
+  if (results != stdout)
+    fclose(results);
+  if (baseline)
+    fclose(baseline);
+  clog_cleanup();
+  return 0;
+}
+#else
+int main(void) {
+  fprintf(stderr, "clog-bench: POSIX only\n");
+  return 0;
+}
+#endif
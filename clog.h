@@ -1,9 +1,22 @@
 #ifndef CLOG_H
 #define CLOG_H
 
+/* Strict ISO modes (-std=c11) hide the POSIX interfaces the backend uses;
+ * ask for them unless the includer picked its own feature set. Like any
+ * feature macro this only works if clog.h comes before system headers */
+#if defined(__STRICT_ANSI__) && !defined(_WIN32) &&                            \
+    !defined(_POSIX_C_SOURCE) && !defined(_XOPEN_SOURCE) &&                    \
+    !defined(_GNU_SOURCE) && !defined(_DEFAULT_SOURCE) && !defined(_BSD_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <errno.h>
+#include <limits.h>
 #include <stdarg.h>
 #include <stdatomic.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,20 +32,108 @@
 #include <fcntl.h>
 #include <io.h>
 #include <process.h>
+#include <sys/stat.h>
 #include <windows.h>
 #define getpid() _getpid()
 #else
 #define CLOG_WINDOWS 0
 #define CLOG_POSIX 1
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+/* syscall() is only declared outside the strict standard modes */
+#if defined(__linux__) &&                                                      \
+    (defined(_DEFAULT_SOURCE) || defined(_GNU_SOURCE) || defined(_BSD_SOURCE))
+#define CLOG_HAS_SYSCALL 1
+#else
+#define CLOG_HAS_SYSCALL 0
+#endif
 #endif
 
 /* Attribute macro for cross-platform compatibility */
 #if defined(__GNUC__) || defined(__clang__)
 #define ATTRIBUTE_UNUSED __attribute__((unused))
+#define ATTRIBUTE_PRINTF(fmt, args) __attribute__((format(printf, fmt, args)))
+#define ATTRIBUTE_COLD __attribute__((cold, noinline))
 #else
 #define ATTRIBUTE_UNUSED
+#define ATTRIBUTE_PRINTF(fmt, args)
+#define ATTRIBUTE_COLD
+#endif
+
+/* Stack traces on glibc and macOS, which provide backtrace(); define
+ * CLOG_NO_BACKTRACE to leave them out */
+#if !defined(CLOG_NO_BACKTRACE) &&                                            \
+    (defined(__GLIBC__) || defined(__APPLE__)) &&                              \
+    (defined(__GNUC__) || defined(__clang__))
+#include <execinfo.h>
+#define CLOG_HAS_BACKTRACE 1
+#else
+#define CLOG_HAS_BACKTRACE 0
+#endif
+
+/* Vector width used to scan strings for bytes that need escaping; define
+ * CLOG_NO_SIMD to force the scalar loop */
+#if !defined(CLOG_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define CLOG_SIMD_AVX2 1
+#define CLOG_SIMD_SSE2 1
+#elif !defined(CLOG_NO_SIMD) &&                                                \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define CLOG_SIMD_AVX2 0
+#define CLOG_SIMD_SSE2 1
+#else
+#define CLOG_SIMD_AVX2 0
+#define CLOG_SIMD_SSE2 0
+#endif
+
+/* Messages are formatted by a built-in engine for the common conversions;
+ * define CLOG_NO_FAST_FORMAT to use vsnprintf for everything */
+#ifndef CLOG_NO_FAST_FORMAT
+#define CLOG_FAST_FORMAT 1
+#else
+#define CLOG_FAST_FORMAT 0
+#endif
+
+/* Linkage. By default each translation unit that includes this header gets
+ * its own private copy of the code and state. Define CLOG_SHARED in every
+ * file, and CLOG_IMPLEMENTATION in exactly one of them, to link a single
+ * shared instance instead; all files must then agree on the configuration
+ * macros below */
+#if defined(CLOG_IMPLEMENTATION) && !defined(CLOG_SHARED)
+#define CLOG_SHARED
+#endif
+#ifdef CLOG_SHARED
+#define CLOG_API
+#ifdef CLOG_IMPLEMENTATION
+#define CLOG_GLOBAL
+#define CLOG_INIT(...) = __VA_ARGS__
+#define CLOG_DEFINE_IMPL 1
+#else
+#define CLOG_GLOBAL extern
+#define CLOG_INIT(...)
+#define CLOG_DEFINE_IMPL 0
+#endif
+#else
+#define CLOG_API static
+#define CLOG_GLOBAL static
+#define CLOG_INIT(...) = __VA_ARGS__
+#define CLOG_DEFINE_IMPL 1
 #endif
 
 #ifdef __cplusplus
@@ -45,43 +146,437 @@ extern "C" {
 #endif
 
 #ifndef CLOG_MAX_TIME_SIZE
-#define CLOG_MAX_TIME_SIZE 32
+#define CLOG_MAX_TIME_SIZE 48
 #endif
 
 #ifndef CLOG_MAX_LOCATION_SIZE
 #define CLOG_MAX_LOCATION_SIZE 256
 #endif
 
+/* Numeric levels for the preprocessor; they match clog_level_t */
+#define CLOG_LEVEL_TRACE 0
+#define CLOG_LEVEL_DEBUG 1
+#define CLOG_LEVEL_INFO 2
+#define CLOG_LEVEL_WARN 3
+#define CLOG_LEVEL_ERROR 4
+#define CLOG_LEVEL_FATAL 5
+#define CLOG_LEVEL_OFF 6
+
+/* Lowest level compiled in; macros below it expand to no code at all */
+#ifndef CLOG_COMPILE_MIN_LEVEL
+#define CLOG_COMPILE_MIN_LEVEL CLOG_LEVEL_TRACE
+#endif
+
+/* Size of a fully rendered line: timestamp, level tag, message, location */
+#define CLOG_MAX_LINE_SIZE                                                     \
+  (CLOG_MAX_MESSAGE_SIZE + CLOG_MAX_TIME_SIZE + CLOG_MAX_LOCATION_SIZE + 256)
+
+/* Library-owned output buffer used when the flush policy defers flushes */
+#ifndef CLOG_OUTPUT_BUFFER_SIZE
+#define CLOG_OUTPUT_BUFFER_SIZE (64 * 1024)
+#endif
+
+/* Maximum iovec entries passed to a single writev */
+#ifdef IOV_MAX
+#define CLOG_IOV_MAX IOV_MAX
+#else
+#define CLOG_IOV_MAX 1024
+#endif
+
+/* Memory-mapped sink: default size of each mapped file segment */
+#ifndef CLOG_MMAP_SEGMENT_SIZE
+#define CLOG_MMAP_SEGMENT_SIZE (16 * 1024 * 1024)
+#endif
+
+/* Sinks that can be registered with clog_add_sink at the same time */
+#ifndef CLOG_MAX_SINKS
+#define CLOG_MAX_SINKS 8
+#endif
+
+/* Categories that can have a level set with clog_set_category_level at
+ * the same time, and the longest category name, terminator included */
+#ifndef CLOG_MAX_CATEGORIES
+#define CLOG_MAX_CATEGORIES 64
+#endif
+
+#ifndef CLOG_CATEGORY_NAME_SIZE
+#define CLOG_CATEGORY_NAME_SIZE 64
+#endif
+
+/* Pattern layouts: steps and bytes of literal text a compiled pattern may
+ * use for each level and color setting */
+#ifndef CLOG_PATTERN_MAX_OPS
+#define CLOG_PATTERN_MAX_OPS 32
+#endif
+
+#ifndef CLOG_PATTERN_TEXT_SIZE
+#define CLOG_PATTERN_TEXT_SIZE 256
+#endif
+
+/* Batches: bytes of rendered lines a thread collects before the block is
+ * written out, even if the batch is still open */
+#ifndef CLOG_BATCH_SIZE
+#define CLOG_BATCH_SIZE (16 * 1024)
+#endif
+
+/* Backtraces: return addresses kept per record, and resolved addresses
+ * cached for reuse (must be a power of two) */
+#ifndef CLOG_BACKTRACE_DEPTH
+#define CLOG_BACKTRACE_DEPTH 32
+#endif
+
+#ifndef CLOG_BACKTRACE_CACHE_SIZE
+#define CLOG_BACKTRACE_CACHE_SIZE 256
+#endif
+
+/* Bytes of one rendered frame, and of a whole trace */
+#define CLOG_BACKTRACE_FRAME_SIZE 160
+#define CLOG_BACKTRACE_TEXT_SIZE                                               \
+  (CLOG_BACKTRACE_DEPTH * CLOG_BACKTRACE_FRAME_SIZE)
+
+/* Flight recorder: bytes of recent lines kept per thread, and how many
+ * threads can hold a ring at the same time */
+#ifndef CLOG_RECORDER_SIZE
+#define CLOG_RECORDER_SIZE (64 * 1024)
+#endif
+
+#ifndef CLOG_RECORDER_THREADS
+#define CLOG_RECORDER_THREADS 64
+#endif
+
+#if CLOG_RECORDER_SIZE < 2 * CLOG_MAX_LINE_SIZE
+#error "CLOG_RECORDER_SIZE must hold at least two lines"
+#endif
+
+#if CLOG_BATCH_SIZE < CLOG_MAX_LINE_SIZE
+#error "CLOG_BATCH_SIZE must hold at least one line"
+#endif
+
+/* Binary mode: distinct call sites remembered per stream (power of two) */
+#ifndef CLOG_BINARY_MAX_SITES
+#define CLOG_BINARY_MAX_SITES 4096
+#endif
+
+/* Binary mode: largest encoded argument payload per record */
+#ifndef CLOG_BINARY_MAX_PAYLOAD
+#define CLOG_BINARY_MAX_PAYLOAD (4 * CLOG_MAX_MESSAGE_SIZE)
+#endif
+
+/* Rate-limited call sites report their suppressed count at most this often */
+#ifndef CLOG_SUPPRESS_REPORT_MS
+#define CLOG_SUPPRESS_REPORT_MS 5000
+#endif
+
+/* Async mode: number of queued records (must be a power of two) */
+#ifndef CLOG_ASYNC_QUEUE_SIZE
+#define CLOG_ASYNC_QUEUE_SIZE 1024
+#endif
+
+/* Async mode: maximum records written by the writer thread per flush */
+#ifndef CLOG_ASYNC_BATCH_SIZE
+#define CLOG_ASYNC_BATCH_SIZE 64
+#endif
+
+/* Async mode: how long the idle writer thread parks before re-checking */
+#ifndef CLOG_ASYNC_IDLE_MS
+#define CLOG_ASYNC_IDLE_MS 100
+#endif
+
+/* Control block: directory of the clog.<pid> files read by clogctl, and
+ * how often the control thread publishes counters and applies requests */
+#ifndef CLOG_CONTROL_DIR
+#define CLOG_CONTROL_DIR "/dev/shm"
+#endif
+
+#ifndef CLOG_CONTROL_INTERVAL_MS
+#define CLOG_CONTROL_INTERVAL_MS 100
+#endif
+
+/* Lock tuning: spin rounds before parking and the cap on pause backoff */
+#ifndef CLOG_LOCK_SPIN_LIMIT
+#define CLOG_LOCK_SPIN_LIMIT 16
+#endif
+
+#ifndef CLOG_LOCK_MAX_BACKOFF
+#define CLOG_LOCK_MAX_BACKOFF 64
+#endif
+
+/* Thread-local storage for per-thread formatting buffers */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define CLOG_THREAD_LOCAL _Thread_local
+#define CLOG_HAS_TLS 1
+#elif defined(_MSC_VER)
+#define CLOG_THREAD_LOCAL __declspec(thread)
+#define CLOG_HAS_TLS 1
+#elif defined(__GNUC__) || defined(__clang__)
+#define CLOG_THREAD_LOCAL __thread
+#define CLOG_HAS_TLS 1
+#else
+#define CLOG_THREAD_LOCAL
+#define CLOG_HAS_TLS 0
+#endif
+
+/* Statistics shards; more shards spread the counters of more threads */
+#ifndef CLOG_STATS_SHARDS
+#define CLOG_STATS_SHARDS 16
+#endif
+
+/* CLOG_STATS collects the pipeline counters, lock counters included */
+#if defined(CLOG_STATS) && !defined(CLOG_LOCK_STATS)
+#define CLOG_LOCK_STATS
+#endif
+
+/* Lock contention counters, collected only when CLOG_LOCK_STATS is defined */
+typedef struct {
+  uint64_t acquisitions; /* Successful lock acquisitions */
+  uint64_t spins;        /* Failed acquisition attempts while spinning */
+  uint64_t parks;        /* Times a thread went to sleep on the lock */
+  uint64_t wait_ns;      /* Total time spent waiting for a contended lock */
+} clog_lock_stats_t;
+
+/* Counter slots of a statistics shard */
+enum {
+  CLOG_STAT_LOCK_ACQUISITIONS,
+  CLOG_STAT_LOCK_SPINS,
+  CLOG_STAT_LOCK_PARKS,
+  CLOG_STAT_LOCK_WAIT_NS,
+  CLOG_STAT_EMITTED, /* One slot per level */
+  CLOG_STAT_FILTERED = CLOG_STAT_EMITTED + CLOG_LEVEL_OFF,
+  CLOG_STAT_BYTES = CLOG_STAT_FILTERED + CLOG_LEVEL_OFF,
+  CLOG_STAT_TRUNCATED,
+  CLOG_STAT_WRITES,
+  CLOG_STAT_WRITE_ERRORS,
+  CLOG_STAT_WRITE_NS,
+  CLOG_STAT_COUNT
+};
+
+#ifdef CLOG_LOCK_STATS
+/* Each thread counts into one of the shards with relaxed adds, so threads
+ * do not contend on counters; readers sum the shards. The padding keeps
+ * neighbouring shards off each other's cache lines */
+typedef struct {
+  atomic_uint_fast64_t counters[CLOG_STAT_COUNT];
+  char pad[64];
+} clog_stats_shard_t;
+
+CLOG_GLOBAL clog_stats_shard_t clog_stats_shards[CLOG_STATS_SHARDS];
+CLOG_GLOBAL atomic_uint clog_stats_next_shard CLOG_INIT(0);
+
+static inline void clog_stat_add(int counter, uint64_t n) {
+  static CLOG_THREAD_LOCAL unsigned int shard;
+  if (!shard)
+    shard = atomic_fetch_add_explicit(&clog_stats_next_shard, 1,
+                                      memory_order_relaxed) %
+                CLOG_STATS_SHARDS +
+            1;
+  atomic_fetch_add_explicit(&clog_stats_shards[shard - 1].counters[counter],
+                            n, memory_order_relaxed);
+}
+
+/* Sum of one counter over all shards */
+static inline uint64_t clog_stat_sum(int counter) {
+  uint64_t sum = 0;
+  for (int i = 0; i < CLOG_STATS_SHARDS; i++)
+    sum += atomic_load_explicit(&clog_stats_shards[i].counters[counter],
+                                memory_order_relaxed);
+  return sum;
+}
+#define CLOG_LOCK_COUNT(counter, n) clog_stat_add(counter, n)
+#else
+#define CLOG_LOCK_COUNT(counter, n) ((void)0)
+#endif
+
+#ifdef CLOG_STATS
+#define CLOG_STAT_ADD(counter, n) clog_stat_add(counter, n)
+/* Counts a record against its level; out-of-range levels are skipped */
+#define CLOG_STAT_LEVEL(base, level)                                           \
+  do {                                                                         \
+    if ((unsigned int)(level) <= CLOG_LEVEL_FATAL)                             \
+      clog_stat_add((base) + (int)(level), 1);                                 \
+  } while (0)
+#else
+#define CLOG_STAT_ADD(counter, n) ((void)0)
+#define CLOG_STAT_LEVEL(base, level) ((void)0)
+#endif
+
+/* Monotonic clock in nanoseconds */
+static inline uint64_t clog_now_ns(void) {
+#if CLOG_WINDOWS
+  LARGE_INTEGER freq, counter;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&counter);
+  return (uint64_t)((double)counter.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* Tells the CPU we are in a spin-wait loop */
+static inline void clog_cpu_relax(void) {
+#if CLOG_WINDOWS
+  YieldProcessor();
+#elif (defined(__GNUC__) || defined(__clang__)) &&                             \
+    (defined(__x86_64__) || defined(__i386__))
+  __asm__ __volatile__("pause");
+#elif (defined(__GNUC__) || defined(__clang__)) &&                             \
+    (defined(__aarch64__) || defined(__arm__))
+  __asm__ __volatile__("yield");
+#endif
+}
+
+/* Spins with exponential backoff; returns false once the budget is spent */
+static inline bool clog_lock_backoff(unsigned int *round) {
+  if (*round >= CLOG_LOCK_SPIN_LIMIT)
+    return false;
+  unsigned int pauses = 1u << (*round < 6 ? *round : 6);
+  if (pauses > CLOG_LOCK_MAX_BACKOFF)
+    pauses = CLOG_LOCK_MAX_BACKOFF;
+  for (unsigned int i = 0; i < pauses; i++)
+    clog_cpu_relax();
+  (*round)++;
+  return true;
+}
+
 /* Thread safety - platform-specific implementations */
 #if CLOG_WINDOWS
 typedef CRITICAL_SECTION clog_mutex_t;
+#define CLOG_MUTEX_INITIALIZER {0}
 #define CLOG_MUTEX_INIT(mutex) InitializeCriticalSection(mutex)
 #define CLOG_MUTEX_LOCK(mutex) EnterCriticalSection(mutex)
 #define CLOG_MUTEX_UNLOCK(mutex) LeaveCriticalSection(mutex)
 #define CLOG_MUTEX_DESTROY(mutex) DeleteCriticalSection(mutex)
 #define CLOG_HAS_THREADS 1
+#elif CLOG_POSIX && CLOG_HAS_SYSCALL
+/* Spin-then-park mutex: 0 = unlocked, 1 = locked, 2 = locked with waiters */
+typedef struct {
+  atomic_int state;
+} clog_mutex_t;
+#define CLOG_MUTEX_INITIALIZER {0}
+#define CLOG_MUTEX_INIT(mutex) atomic_init(&(mutex)->state, 0)
+#define CLOG_MUTEX_LOCK(mutex) clog_lock_acquire(mutex)
+#define CLOG_MUTEX_UNLOCK(mutex) clog_lock_release(mutex)
+#define CLOG_MUTEX_DESTROY(mutex) ((void)0)
+#define CLOG_HAS_THREADS 1
+
+static inline void clog_futex(atomic_int *addr, int op, int val) {
+  syscall(SYS_futex, (int *)addr, op | FUTEX_PRIVATE_FLAG, val, NULL, NULL,
+          0);
+}
+
+static void clog_lock_acquire_slow(clog_mutex_t *mutex) {
+  uint64_t start = 0;
+#ifdef CLOG_LOCK_STATS
+  start = clog_now_ns();
+#endif
+  unsigned int round = 0;
+  int expected;
+  while (clog_lock_backoff(&round)) {
+    expected = 0;
+    if (atomic_load_explicit(&mutex->state, memory_order_relaxed) == 0 &&
+        atomic_compare_exchange_weak_explicit(&mutex->state, &expected, 1,
+                                              memory_order_acquire,
+                                              memory_order_relaxed)) {
+      CLOG_LOCK_COUNT(CLOG_STAT_LOCK_SPINS, round);
+      goto acquired;
+    }
+  }
+  CLOG_LOCK_COUNT(CLOG_STAT_LOCK_SPINS, round);
+
+  /* Mark the lock contended and sleep until the holder hands it back */
+  while (atomic_exchange_explicit(&mutex->state, 2, memory_order_acquire) !=
+         0) {
+    CLOG_LOCK_COUNT(CLOG_STAT_LOCK_PARKS, 1);
+    clog_futex(&mutex->state, FUTEX_WAIT, 2);
+  }
+
+acquired:
+  CLOG_LOCK_COUNT(CLOG_STAT_LOCK_ACQUISITIONS, 1);
+  CLOG_LOCK_COUNT(CLOG_STAT_LOCK_WAIT_NS, clog_now_ns() - start);
+  (void)start;
+}
+
+static inline void clog_lock_acquire(clog_mutex_t *mutex) {
+  int expected = 0;
+  if (atomic_compare_exchange_strong_explicit(&mutex->state, &expected, 1,
+                                              memory_order_acquire,
+                                              memory_order_relaxed)) {
+    CLOG_LOCK_COUNT(CLOG_STAT_LOCK_ACQUISITIONS, 1);
+    return;
+  }
+  clog_lock_acquire_slow(mutex);
+}
+
+static inline void clog_lock_release(clog_mutex_t *mutex) {
+  if (atomic_exchange_explicit(&mutex->state, 0, memory_order_release) == 2)
+    clog_futex(&mutex->state, FUTEX_WAKE, 1);
+}
+#elif CLOG_POSIX
+/* Spin on trylock, then park in the pthread mutex */
+typedef pthread_mutex_t clog_mutex_t;
+#define CLOG_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define CLOG_MUTEX_INIT(mutex) pthread_mutex_init(mutex, NULL)
+#define CLOG_MUTEX_LOCK(mutex) clog_lock_acquire(mutex)
+#define CLOG_MUTEX_UNLOCK(mutex) pthread_mutex_unlock(mutex)
+#define CLOG_MUTEX_DESTROY(mutex) pthread_mutex_destroy(mutex)
+#define CLOG_HAS_THREADS 1
+
+static void clog_lock_acquire_slow(clog_mutex_t *mutex) {
+  uint64_t start = 0;
+#ifdef CLOG_LOCK_STATS
+  start = clog_now_ns();
+#endif
+  unsigned int round = 0;
+  while (clog_lock_backoff(&round)) {
+    if (pthread_mutex_trylock(mutex) == 0) {
+      CLOG_LOCK_COUNT(CLOG_STAT_LOCK_SPINS, round);
+      goto acquired;
+    }
+  }
+  CLOG_LOCK_COUNT(CLOG_STAT_LOCK_SPINS, round);
+  CLOG_LOCK_COUNT(CLOG_STAT_LOCK_PARKS, 1);
+  pthread_mutex_lock(mutex);
+
+acquired:
+  CLOG_LOCK_COUNT(CLOG_STAT_LOCK_ACQUISITIONS, 1);
+  CLOG_LOCK_COUNT(CLOG_STAT_LOCK_WAIT_NS, clog_now_ns() - start);
+  (void)start;
+}
+
+static inline void clog_lock_acquire(clog_mutex_t *mutex) {
+  if (pthread_mutex_trylock(mutex) == 0) {
+    CLOG_LOCK_COUNT(CLOG_STAT_LOCK_ACQUISITIONS, 1);
+    return;
+  }
+  clog_lock_acquire_slow(mutex);
+}
 #elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L &&              \
     !defined(__STDC_NO_ATOMICS__)
-#include <stdatomic.h>
 typedef atomic_flag clog_mutex_t;
+#define CLOG_MUTEX_INITIALIZER ATOMIC_FLAG_INIT
 #define CLOG_MUTEX_INIT(mutex) atomic_flag_clear(mutex)
 #define CLOG_MUTEX_LOCK(mutex)                                                 \
   while (atomic_flag_test_and_set(mutex)) {                                    \
+    clog_cpu_relax();                                                          \
   }
 #define CLOG_MUTEX_UNLOCK(mutex) atomic_flag_clear(mutex)
 #define CLOG_MUTEX_DESTROY(mutex) ((void)0)
 #define CLOG_HAS_THREADS 1
 #elif defined(__GNUC__) || defined(__clang__)
 typedef volatile int clog_mutex_t;
+#define CLOG_MUTEX_INITIALIZER 0
 #define CLOG_MUTEX_INIT(mutex) (*(mutex) = 0)
 #define CLOG_MUTEX_LOCK(mutex)                                                 \
   while (__sync_lock_test_and_set(mutex, 1)) {                                 \
+    clog_cpu_relax();                                                          \
   }
 #define CLOG_MUTEX_UNLOCK(mutex) __sync_lock_release(mutex)
 #define CLOG_MUTEX_DESTROY(mutex) ((void)0)
 #define CLOG_HAS_THREADS 1
 #else
 typedef int clog_mutex_t;
+#define CLOG_MUTEX_INITIALIZER 0
 #define CLOG_MUTEX_INIT(mutex) (*(mutex) = 0)
 #define CLOG_MUTEX_LOCK(mutex) ((void)0)
 #define CLOG_MUTEX_UNLOCK(mutex) ((void)0)
@@ -89,6 +584,22 @@ typedef int clog_mutex_t;
 #define CLOG_HAS_THREADS 0
 #endif
 
+/* Async backend - writer thread and parking primitives */
+#if CLOG_HAS_THREADS && !defined(CLOG_NO_ASYNC)
+#define CLOG_HAS_ASYNC 1
+#if CLOG_WINDOWS
+typedef HANDLE clog_thread_t;
+typedef CRITICAL_SECTION clog_park_mutex_t;
+typedef CONDITION_VARIABLE clog_park_cond_t;
+#else
+typedef pthread_t clog_thread_t;
+typedef pthread_mutex_t clog_park_mutex_t;
+typedef pthread_cond_t clog_park_cond_t;
+#endif
+#else
+#define CLOG_HAS_ASYNC 0
+#endif
+
 /* ANSI Color Codes */
 #define CLOG_RESET "\x1B[0m"
 #define CLOG_BOLD "\x1B[1m"
@@ -122,6 +633,18 @@ typedef enum {
   CLOG_FATAL = 5
 } clog_level_t;
 
+/* Pass as the flush level to never flush because of a record's level */
+#define CLOG_FLUSH_LEVEL_NONE ((clog_level_t)(CLOG_FATAL + 1))
+
+/* Pass as the flight recorder level to turn the recorder off */
+#define CLOG_RECORDER_OFF ((clog_level_t)(CLOG_FATAL + 1))
+
+/* Pass as a category level to drop the category's records */
+#define CLOG_CATEGORY_OFF ((clog_level_t)(CLOG_FATAL + 1))
+
+/* Pass as the backtrace level to stop attaching stack traces */
+#define CLOG_BACKTRACE_OFF ((clog_level_t)(CLOG_FATAL + 1))
+
 /* Color mode enumeration */
 typedef enum {
   CLOG_COLOR_AUTO = 0,   /* Auto-detect color support */
@@ -131,147 +654,1182 @@ typedef enum {
   CLOG_COLOR_WIN32 = 4   /* Force Windows Console API */
 } clog_color_mode_t;
 
+/* Fractional digits appended to the timestamp */
+typedef enum {
+  CLOG_TIME_SECONDS = 0, /* 2024-01-31 12:00:00 */
+  CLOG_TIME_MILLIS = 3,  /* 2024-01-31 12:00:00.123 */
+  CLOG_TIME_MICROS = 6,  /* 2024-01-31 12:00:00.123456 */
+  CLOG_TIME_NANOS = 9    /* 2024-01-31 12:00:00.123456789 */
+} clog_time_precision_t;
+
+/* Timestamp layout */
+typedef enum {
+  CLOG_TIME_FORMAT_DEFAULT = 0, /* 2024-01-31 12:00:00 */
+  CLOG_TIME_FORMAT_ISO8601 = 1  /* 2024-01-31T12:00:00+01:00 or ...Z */
+} clog_time_format_t;
+
+/* Time-based rotation of the rotating file sink */
+typedef enum {
+  CLOG_ROTATE_NEVER = 0,  /* Rotate on size only */
+  CLOG_ROTATE_HOURLY = 1, /* Also at the top of every local hour */
+  CLOG_ROTATE_DAILY = 2   /* Also at local midnight */
+} clog_rotate_t;
+
+/* Compression applied to rotated files by the rotation thread */
+typedef enum {
+  CLOG_COMPRESS_NONE = 0,
+  CLOG_COMPRESS_GZIP = 1, /* Runs gzip from PATH, appends .gz */
+  CLOG_COMPRESS_ZSTD = 2  /* Runs zstd from PATH, appends .zst */
+} clog_compress_t;
+
+/* Async queue overflow behavior */
+typedef enum {
+  CLOG_OVERFLOW_BLOCK = 0,       /* Wait for the writer to free a slot */
+  CLOG_OVERFLOW_DROP_NEWEST = 1, /* Discard the record being logged */
+  CLOG_OVERFLOW_DROP_OLDEST = 2  /* Discard the oldest queued record */
+} clog_overflow_t;
+
+/* Async backend counters */
+typedef struct {
+  size_t enqueued;       /* Records accepted into the queue */
+  size_t written;        /* Records written by the writer thread */
+  size_t dropped_newest; /* Records discarded by CLOG_OVERFLOW_DROP_NEWEST */
+  size_t dropped_oldest; /* Records discarded by CLOG_OVERFLOW_DROP_OLDEST */
+  size_t blocked;        /* Times a producer waited for a free slot */
+} clog_async_stats_t;
+
+/* Pipeline counters, collected only when CLOG_STATS is defined */
+typedef struct {
+  uint64_t emitted[CLOG_FATAL + 1];  /* Records past the level check */
+  uint64_t filtered[CLOG_FATAL + 1]; /* Records dropped by the level check */
+  uint64_t bytes_written;            /* Bytes handed to outputs and sinks */
+  uint64_t truncated;                /* Messages cut to fit their buffer */
+  uint64_t writes;                   /* Writes to outputs and sinks */
+  uint64_t write_errors;             /* Writes that failed or came up short */
+  uint64_t write_ns;                 /* Time spent in those writes */
+  clog_lock_stats_t lock;            /* Acquisitions and wait time */
+} clog_stats_t;
+
+/* Shared-memory control block at CLOG_CONTROL_DIR/clog.<pid>; clogctl
+ * reads the snapshot and stores requested_level, and the control thread
+ * applies the request and refreshes the rest */
+#define CLOG_CONTROL_MAGIC 0x474f4c43u /* "CLOG" */
+#define CLOG_CONTROL_VERSION 1
+#define CLOG_CONTROL_NO_REQUEST (-1)
+
+typedef struct {
+  atomic_uint magic;          /* CLOG_CONTROL_MAGIC once the block is ready */
+  uint32_t version;           /* CLOG_CONTROL_VERSION */
+  int64_t pid;                /* Owning process */
+  atomic_int level;           /* Main output's level */
+  atomic_int min_level;       /* Lowest level any output accepts */
+  atomic_int requested_level; /* Level to apply, or CLOG_CONTROL_NO_REQUEST */
+  atomic_uint publishes;      /* Snapshots published so far */
+  atomic_uint_least64_t emitted[CLOG_FATAL + 1];  /* See clog_stats_t */
+  atomic_uint_least64_t filtered[CLOG_FATAL + 1]; /* See clog_stats_t */
+  atomic_uint_least64_t bytes_written;
+  atomic_uint_least64_t truncated;
+  atomic_uint_least64_t write_errors;
+  atomic_uint_least64_t dropped; /* Async records dropped on overflow */
+  atomic_uint_least64_t blocked; /* Async producers that waited */
+} clog_control_t;
+
+/* Per-call-site state of the sampling and rate-limiting macros; static
+ * zero initialization is a valid starting state */
+typedef struct {
+  atomic_uint_least64_t calls;       /* Calls that passed the level check */
+  atomic_uint_least64_t window;      /* Rate limit: second << 24 | count */
+  atomic_uint_least64_t suppressed;  /* Skipped since the last report */
+  atomic_uint_least64_t reported_ns; /* Start of the current report period */
+} clog_site_t;
+
+/* Per-call-site state of the category macros: the category name and the
+ * levels resolved for it, packed as generation << 6 | output << 3 | gate
+ * where output is the main output's level for the category and gate the
+ * lowest level any output takes. A stale generation means re-resolve */
+typedef struct {
+  const char *name;
+  atomic_uint state;
+} clog_category_site_t;
+
+/* Steps of a compiled pattern; the level name, colors and literal text
+ * between fields all become TEXT */
+enum {
+  CLOG_PATTERN_TEXT,
+  CLOG_PATTERN_TIME,
+  CLOG_PATTERN_MESSAGE,
+  CLOG_PATTERN_FILE,
+  CLOG_PATTERN_LINE,
+  CLOG_PATTERN_FUNC,
+  CLOG_PATTERN_THREAD,
+  CLOG_PATTERN_PID,
+  CLOG_PATTERN_ELAPSED,
+  CLOG_PATTERN_CATEGORY
+};
+
+typedef struct {
+  uint8_t kind;    /* CLOG_PATTERN_TEXT, CLOG_PATTERN_TIME... */
+  uint8_t left;    /* Pad after the field rather than before it */
+  uint16_t width;  /* Minimum width, 0 for none */
+  uint16_t offset; /* TEXT: start in the variant's text */
+  uint16_t len;    /* TEXT: length */
+} clog_pattern_op_t;
+
+/* One compiled variant per level (and UNKN), with and without colors */
+#define CLOG_PATTERN_VARIANTS (2 * (CLOG_FATAL + 2))
+
+/* A layout pattern set with clog_set_pattern, compiled once */
+typedef struct clog_pattern {
+  struct clog_pattern *retired; /* Next older replaced pattern */
+  uint8_t count[CLOG_PATTERN_VARIANTS];
+  clog_pattern_op_t ops[CLOG_PATTERN_VARIANTS][CLOG_PATTERN_MAX_OPS];
+  char text[CLOG_PATTERN_VARIANTS][CLOG_PATTERN_TEXT_SIZE];
+} clog_pattern_t;
+
+/* Line layout */
+typedef enum {
+  CLOG_FORMAT_TEXT = 0,  /* 2024-01-31 12:00:00 [INFO] message  (f.c:1 in f) */
+  CLOG_FORMAT_JSON = 1,  /* {"ts":"...","level":"INFO","msg":"message",...} */
+  CLOG_FORMAT_LOGFMT = 2 /* ts="..." level=INFO msg=message file=f.c ... */
+} clog_output_format_t;
+
+/* Value type of a structured field */
+typedef enum {
+  CLOG_FIELD_INT = 0,
+  CLOG_FIELD_DOUBLE = 1,
+  CLOG_FIELD_STRING = 2,
+  CLOG_FIELD_BOOL = 3
+} clog_field_type_t;
+
+/* A typed key/value pair attached to one record; strings are borrowed and
+ * only read while the call that logs them runs */
+typedef struct {
+  const char *key;
+  clog_field_type_t type;
+  union {
+    long long i;
+    double d;
+    const char *s;
+    bool b;
+  } value;
+} clog_field_t;
+
+/* An output added next to the main one with clog_add_sink */
+typedef struct {
+  FILE *fp;                    /* Stream to write, or NULL to use fd */
+  int fd;                      /* Raw descriptor, used when fp is NULL */
+  clog_level_t level;          /* Lowest level the sink receives */
+  clog_color_mode_t color;     /* AUTO colors terminals only */
+  clog_output_format_t format; /* Layout of the sink's lines */
+} clog_sink_config_t;
+
+/* A registered sink; id 0 marks a free slot */
+typedef struct {
+  int id;
+  FILE *fp;
+  int fd;
+  clog_level_t level;
+  clog_output_format_t format;
+  bool use_ansi;
+} clog_sink_t;
+
+/* Number of distinct renderings of a record: each format, with and
+ * without ANSI colors */
+#define CLOG_LAYOUT_COUNT 6
+
 /* Global state */
-static clog_mutex_t clog_mutex;
-static atomic_bool clog_is_initialized = false;
-static clog_level_t clog_min_level = CLOG_TRACE;
-static clog_color_mode_t clog_color_mode = CLOG_COLOR_AUTO;
-static FILE *clog_output = NULL; /* NULL means stdout */
-static bool clog_show_timestamp = true;
-static bool clog_show_location = true;
+CLOG_GLOBAL clog_mutex_t clog_mutex CLOG_INIT(CLOG_MUTEX_INITIALIZER);
+CLOG_GLOBAL atomic_bool clog_is_initialized CLOG_INIT(false);
+/* Lowest level any output accepts, so a record no output wants costs one
+ * load and compare; written under clog_sink_mutex but read without it.
+ * clog_output_level is the main output's own level. It, the descriptors
+ * and clog_show_timestamp are atomic because clog_signal_logf reads them
+ * from signal handlers */
+CLOG_GLOBAL atomic_int clog_min_level CLOG_INIT(CLOG_TRACE);
+CLOG_GLOBAL atomic_int clog_output_level CLOG_INIT(CLOG_TRACE);
+CLOG_GLOBAL clog_color_mode_t clog_color_mode CLOG_INIT(CLOG_COLOR_AUTO);
+CLOG_GLOBAL FILE *clog_output CLOG_INIT(NULL); /* NULL means stdout */
+CLOG_GLOBAL atomic_int clog_output_fd CLOG_INIT(-1); /* >= 0 bypasses stdio */
+/* Descriptor behind clog_output, for writers that must avoid stdio */
+CLOG_GLOBAL atomic_int clog_output_fileno CLOG_INIT(1);
+CLOG_GLOBAL atomic_bool clog_show_timestamp CLOG_INIT(true);
+CLOG_GLOBAL bool clog_show_location CLOG_INIT(true);
+/* Text layout compiled by clog_set_pattern, or NULL for the built-in one.
+ * Replaced patterns may still be in use by other threads: they are kept
+ * on the retired list, guarded by clog_sink_mutex, until clog_cleanup */
+CLOG_GLOBAL _Atomic(clog_pattern_t *) clog_pattern CLOG_INIT(NULL);
+CLOG_GLOBAL clog_pattern_t *clog_pattern_retired CLOG_INIT(NULL);
+/* Monotonic time of clog_init, for elapsed time in patterns */
+CLOG_GLOBAL uint64_t clog_start_ns CLOG_INIT(0);
+#if CLOG_HAS_TLS
+/* Category of the record the thread is logging, for patterns */
+CLOG_GLOBAL CLOG_THREAD_LOCAL const char *clog_current_category;
+#endif
+CLOG_GLOBAL clog_output_format_t clog_output_format CLOG_INIT(CLOG_FORMAT_TEXT);
+#ifdef CLOG_STATS
+/* Set by the formatters when the record being logged was truncated */
+CLOG_GLOBAL CLOG_THREAD_LOCAL bool clog_stats_truncated;
+#define CLOG_STAT_TRUNCATED_MARK() (clog_stats_truncated = true)
+#else
+#define CLOG_STAT_TRUNCATED_MARK() ((void)0)
+#endif
+/* Additional sinks; the table and the writes to them are guarded by
+ * clog_sink_mutex, and clog_sink_count lets the log path skip both */
+CLOG_GLOBAL clog_mutex_t clog_sink_mutex CLOG_INIT(CLOG_MUTEX_INITIALIZER);
+CLOG_GLOBAL clog_sink_t clog_sinks[CLOG_MAX_SINKS];
+CLOG_GLOBAL atomic_int clog_sink_count CLOG_INIT(0);
+CLOG_GLOBAL int clog_sink_next_id CLOG_INIT(1);
+/* Lowest level the sinks and the flight recorder accept, guarded by
+ * clog_sink_mutex; the category gate is the lower of it and the
+ * category's own level */
+CLOG_GLOBAL clog_level_t clog_aux_min_level CLOG_INIT(CLOG_CATEGORY_OFF);
+
+/* Category levels, guarded by clog_sink_mutex. Every change bumps the
+ * generation, which call sites compare against their cached state */
+typedef struct {
+  char name[CLOG_CATEGORY_NAME_SIZE];
+  clog_level_t level;
+} clog_category_t;
+
+#define CLOG_CATEGORY_GENERATION_MASK ((1u << 26) - 1)
+CLOG_GLOBAL clog_category_t clog_categories[CLOG_MAX_CATEGORIES];
+CLOG_GLOBAL int clog_category_count CLOG_INIT(0);
+CLOG_GLOBAL atomic_uint clog_category_generation CLOG_INIT(1);
+
+/* Flight recorder: records the main output drops are kept in per-thread
+ * rings and dumped with async-signal-safe writes on FATAL or a crash */
+#if CLOG_HAS_TLS
+#define CLOG_HAS_RECORDER 1
+/* One thread's ring. Only the owner writes; head counts every byte ever
+ * written and dumped is the head at the last dump */
+typedef struct {
+  atomic_int state; /* CLOG_RING_OWNED or CLOG_RING_RETIRED */
+  unsigned long thread_id;
+  atomic_uint_least64_t head;
+  atomic_uint_least64_t dumped;
+  char data[CLOG_RECORDER_SIZE];
+} clog_ring_t;
+
+enum { CLOG_RING_OWNED = 1, CLOG_RING_RETIRED = 2 };
+
+/* Signals caught by clog_install_crash_handlers */
+#define CLOG_CRASH_SIGNAL_COUNT 5
+
+/* Level and dump descriptor are guarded by clog_sink_mutex; rings are
+ * allocated on a thread's first record and never freed */
+CLOG_GLOBAL clog_level_t clog_recorder_level CLOG_INIT(CLOG_RECORDER_OFF);
+CLOG_GLOBAL int clog_recorder_fd CLOG_INIT(2);
+CLOG_GLOBAL _Atomic(clog_ring_t *) clog_recorder_rings[CLOG_RECORDER_THREADS];
+CLOG_GLOBAL CLOG_THREAD_LOCAL clog_ring_t *clog_recorder_ring;
+#if CLOG_POSIX
+/* Retires a thread's ring when it exits so another thread can take it */
+CLOG_GLOBAL pthread_key_t clog_recorder_key;
+CLOG_GLOBAL bool clog_recorder_key_ready CLOG_INIT(false);
+/* Dispositions replaced by the crash handlers, restored before re-raising */
+CLOG_GLOBAL struct sigaction clog_crash_previous[CLOG_CRASH_SIGNAL_COUNT];
+CLOG_GLOBAL bool clog_crash_installed CLOG_INIT(false);
+#endif
+#else
+#define CLOG_HAS_RECORDER 0
+#endif
+
+/* A thread's open batch: the main output's lines, rendered with one shared
+ * timestamp and written as a single block on commit */
+#if CLOG_HAS_TLS
+#define CLOG_HAS_BATCH 1
+typedef struct {
+  bool open;
+  clog_level_t level;   /* Highest level added, for the flush policy */
+  struct timespec when; /* Taken by clog_batch_begin */
+  size_t len;
+  char data[CLOG_BATCH_SIZE];
+} clog_batch_t;
+
+CLOG_GLOBAL CLOG_THREAD_LOCAL clog_batch_t clog_batch;
+#else
+#define CLOG_HAS_BATCH 0
+#endif
+
+/* Backtraces: the public entry points keep the caller's raw return
+ * addresses, and frames are symbolized only when the record is written,
+ * through a direct-mapped cache of resolved addresses */
+#if CLOG_HAS_BACKTRACE
+typedef struct {
+  int depth; /* Frames of the record being logged, 0 for none */
+  void *frames[CLOG_BACKTRACE_DEPTH];
+  /* A line followed by its trace, so both go out in one write */
+  char text[CLOG_MAX_LINE_SIZE + CLOG_BACKTRACE_TEXT_SIZE];
+} clog_backtrace_t;
+
+typedef struct {
+  void *addr; /* NULL while the entry is empty */
+  char text[CLOG_BACKTRACE_FRAME_SIZE];
+} clog_backtrace_entry_t;
+
+CLOG_GLOBAL clog_level_t clog_backtrace_level CLOG_INIT(CLOG_BACKTRACE_OFF);
+CLOG_GLOBAL CLOG_THREAD_LOCAL clog_backtrace_t clog_backtrace;
+/* Guards the cache, which every thread and the async writer share */
+CLOG_GLOBAL clog_mutex_t clog_backtrace_mutex
+    CLOG_INIT(CLOG_MUTEX_INITIALIZER);
+CLOG_GLOBAL clog_backtrace_entry_t
+    clog_backtrace_cache[CLOG_BACKTRACE_CACHE_SIZE];
+#endif
+/* Flush policy; the TRACE level flushes every line */
+CLOG_GLOBAL clog_level_t clog_flush_level CLOG_INIT(CLOG_TRACE);
+CLOG_GLOBAL size_t clog_flush_bytes CLOG_INIT(0);
+CLOG_GLOBAL unsigned int clog_flush_interval_ms CLOG_INIT(0);
+/* Pending output, guarded by clog_mutex */
+CLOG_GLOBAL char *clog_out_buf CLOG_INIT(NULL);
+CLOG_GLOBAL size_t clog_out_len CLOG_INIT(0);
+CLOG_GLOBAL uint64_t clog_out_last_flush CLOG_INIT(0);
+CLOG_GLOBAL atomic_int clog_time_precision CLOG_INIT(CLOG_TIME_SECONDS);
+CLOG_GLOBAL atomic_int clog_time_format CLOG_INIT(CLOG_TIME_FORMAT_DEFAULT);
+CLOG_GLOBAL atomic_bool clog_time_utc CLOG_INIT(false);
+CLOG_GLOBAL atomic_bool clog_time_coarse CLOG_INIT(false);
+/* Bumped to invalidate cached prefixes */
+CLOG_GLOBAL atomic_uint clog_time_generation CLOG_INIT(0);
+/* Seconds east of UTC, and the time until which that offset holds */
+CLOG_GLOBAL atomic_long clog_tz_offset CLOG_INIT(0);
+CLOG_GLOBAL atomic_llong clog_tz_valid_until CLOG_INIT(0);
+
+/* Display settings a line is rendered with in place of the globals above,
+ * for output written by another process (clog_binary_decode) */
+typedef struct {
+  bool show_timestamp;
+  bool show_location;
+  int time_precision;
+  int time_format;
+  bool time_utc;
+} clog_render_settings_t;
+
+/* Binary mode stream layout (native byte order):
+ *   header  "CLOGBIN1" u32 0x01020304, u8 version, u8 show_timestamp,
+ *           u8 show_location, u8 precision, u8 time_format, u8 utc,
+ *           u8 sizeof(long double), u8 reserved
+ *   site    u8 1, u32 id, i32 line, str format, str file, str func
+ *   record  u8 2, u8 level, u32 id, i64 sec, u32 nsec, u32 size, payload
+ *   text    u8 3, u8 level, i64 sec, u32 nsec, i32 line, str message,
+ *           str file, str func
+ * where str is u32 length (0xFFFFFFFF for NULL) followed by the bytes, and
+ * payload holds the printf arguments in format order: int-sized integers as
+ * 4 bytes, other integers, pointers and doubles as 8 bytes, long doubles in
+ * their native size, and strings as str. Each site is written once, before
+ * its first record; text records carry messages that could not be deferred */
+#define CLOG_BINARY_MAGIC "CLOGBIN1"
+#define CLOG_BINARY_VERSION 1
+#define CLOG_BINARY_NULL_STR 0xFFFFFFFFu
+
+enum {
+  CLOG_BINARY_SITE = 1,
+  CLOG_BINARY_RECORD = 2,
+  CLOG_BINARY_TEXT = 3
+};
+
+/* A call site already described in the binary stream */
+typedef struct {
+  const char *format;
+  const char *file;
+  int line;
+} clog_binary_site_t;
+
+/* Non-NULL switches to binary mode */
+CLOG_GLOBAL _Atomic(FILE *) clog_binary_output CLOG_INIT(NULL);
+CLOG_GLOBAL clog_binary_site_t *clog_binary_sites CLOG_INIT(NULL);
+
+/* One mapped window of the memory-mapped sink. Writers reserve bytes with a
+ * fetch-add on tail; the reservation that first runs past size records
+ * where the data ends, and users lets a rollover wait for writers still
+ * copying into the old window */
+typedef struct {
+  char *base;
+  size_t size;
+  uint64_t offset;     /* File offset of base */
+  atomic_size_t tail;  /* Next free byte; runs past size once full */
+  atomic_size_t used;  /* Bytes in use once full, SIZE_MAX until then */
+  atomic_size_t users; /* Writers currently inside this window */
+} clog_mmap_segment_t;
+
+/* The two windows alternate: the next one is mapped while the old drains */
+CLOG_GLOBAL clog_mmap_segment_t clog_mmap_segments[2];
+CLOG_GLOBAL _Atomic(clog_mmap_segment_t *) clog_mmap_current CLOG_INIT(NULL);
+CLOG_GLOBAL int clog_mmap_fd CLOG_INIT(-1);
+CLOG_GLOBAL size_t clog_mmap_segment_size CLOG_INIT(0);
+
+#if CLOG_HAS_ASYNC
+/* One queued record; sequence implements the bounded MPMC handshake */
+typedef struct {
+  atomic_size_t sequence;
+  clog_level_t level;
+  size_t len;
+  char data[CLOG_MAX_LINE_SIZE];
+#if CLOG_HAS_BACKTRACE
+  int depth; /* Frames the writer symbolizes under the line, 0 for none */
+  void *frames[CLOG_BACKTRACE_DEPTH];
+#endif
+} clog_async_slot_t;
+
+/* Producer and consumer positions live on separate cache lines */
+typedef struct {
+  clog_async_slot_t *slots;
+  char pad0[64];
+  atomic_size_t enqueue_pos;
+  char pad1[64];
+  atomic_size_t dequeue_pos;
+  char pad2[64];
+  atomic_size_t completed; /* Positions written or dropped */
+  atomic_size_t producers; /* Producers currently inside the queue */
+  atomic_bool active;
+  atomic_bool stop;
+  atomic_bool sleeping;
+  atomic_int overflow;
+  atomic_size_t enqueued;
+  atomic_size_t written;
+  atomic_size_t dropped_newest;
+  atomic_size_t dropped_oldest;
+  atomic_size_t blocked;
+  clog_thread_t thread;
+  clog_park_mutex_t park_mutex;
+  clog_park_cond_t park_cond;
+} clog_async_queue_t;
+
+CLOG_GLOBAL clog_async_queue_t clog_async;
+#endif
+
+/* Rotating file sink: loggers only swap descriptors, and all renaming,
+ * opening and compressing happens on the rotation thread */
+#if CLOG_POSIX && CLOG_HAS_ASYNC
+#define CLOG_HAS_ROTATE 1
+typedef struct {
+  char *path;           /* Active file name, NULL while the sink is off */
+  size_t max_bytes;     /* Size trigger, 0 for none */
+  clog_rotate_t every;  /* Time trigger */
+  unsigned int keep;    /* Rotated files to retain */
+  size_t written;       /* Bytes in the active file */
+  time_t deadline;      /* Next time boundary, 0 for none */
+  int active_fd;        /* Also clog_output_fd while the sink is on */
+  int next_fd;          /* Pre-opened successor, -1 until ready */
+  int retired_fd;       /* Replaced file waiting for the thread, or -1 */
+  bool stop;            /* Guarded by park_mutex, as is retired_fd */
+  atomic_int compress;  /* clog_compress_t */
+  clog_thread_t thread;
+  clog_park_mutex_t park_mutex;
+  clog_park_cond_t park_cond;
+} clog_rotate_state_t;
+
+CLOG_GLOBAL clog_rotate_state_t clog_rotate;
+#else
+#define CLOG_HAS_ROTATE 0
+#endif
+
+/* Control block: the mapping, and the thread that keeps it current. It
+ * only needs POSIX threads, so it stays available with CLOG_NO_ASYNC */
+#if CLOG_POSIX && CLOG_HAS_THREADS
+#define CLOG_HAS_CONTROL 1
+typedef struct {
+  clog_control_t *block; /* NULL while publishing is off */
+  char path[256];
+  bool stop; /* Guarded by park_mutex */
+  pthread_t thread;
+  pthread_mutex_t park_mutex;
+  pthread_cond_t park_cond;
+} clog_control_state_t;
+
+CLOG_GLOBAL clog_control_state_t clog_control;
+#else
+#define CLOG_HAS_CONTROL 0
+#endif
 
 #if CLOG_WINDOWS
-static HANDLE clog_console_handle = INVALID_HANDLE_VALUE;
-static WORD clog_original_console_attrs = 0;
-static bool clog_console_initialized = false;
+CLOG_GLOBAL HANDLE clog_console_handle CLOG_INIT(INVALID_HANDLE_VALUE);
+CLOG_GLOBAL WORD clog_original_console_attrs CLOG_INIT(0);
+CLOG_GLOBAL bool clog_console_initialized CLOG_INIT(false);
 #endif
 
 /* Function declarations */
 /* Initializes the logging system, ensuring thread-safe setup */
-static void clog_init(void);
+CLOG_API void clog_init(void);
 /* Cleans up resources, called automatically via atexit */
-static void clog_cleanup(void);
+CLOG_API void clog_cleanup(void);
 /* Returns string representation of log level */
-static const char *clog_level_string(clog_level_t level);
+CLOG_API const char *clog_level_string(clog_level_t level);
 /* Returns ANSI color code for log level */
-static const char *clog_level_color_ansi(clog_level_t level);
-/* Formats current time into buffer */
-static void clog_format_time(char *buffer, size_t size);
-/* Writes string to output, handling Unicode on Windows */
-static void clog_safe_write(const char *str, size_t len);
+CLOG_API const char *clog_level_color_ansi(clog_level_t level);
+/* Formats current time into buffer and returns its length */
+CLOG_API size_t clog_format_time(char *buffer, size_t size);
+/* Formats the given wall-clock time into buffer and returns its length */
+CLOG_API size_t clog_format_timespec(const struct timespec *ts, char *buffer,
+                                    size_t size);
+/* Sets the number of fractional second digits in timestamps */
+CLOG_API void clog_set_time_precision(clog_time_precision_t precision)
+      ATTRIBUTE_UNUSED;
+/* Selects the default or ISO-8601 timestamp layout */
+CLOG_API void clog_set_time_format(clog_time_format_t format) ATTRIBUTE_UNUSED;
+/* Renders timestamps in UTC instead of local time */
+CLOG_API void clog_set_time_utc(bool utc) ATTRIBUTE_UNUSED;
+/* Uses the cheaper, tick-granular coarse clock where available */
+CLOG_API void clog_set_time_coarse(bool coarse) ATTRIBUTE_UNUSED;
+/* Writes string to output, handling Unicode on Windows; does not flush */
+CLOG_API void clog_safe_write(const char *str, size_t len);
 /* Sets output file for logging */
-static void clog_set_output(FILE *fp) ATTRIBUTE_UNUSED;
+CLOG_API void clog_set_output(FILE *fp) ATTRIBUTE_UNUSED;
+/* Sets a raw file descriptor as output, bypassing stdio; -1 to unset */
+CLOG_API void clog_set_output_fd(int fd) ATTRIBUTE_UNUSED;
+/* Appends lines to a preallocated, memory-mapped file without locking or
+ * system calls; segment_size 0 picks CLOG_MMAP_SEGMENT_SIZE, NULL path
+ * closes the file. POSIX only */
+CLOG_API bool clog_set_output_mmap(const char *path,
+                                   size_t segment_size) ATTRIBUTE_UNUSED;
+/* Writes to path and rotates it to path.1, path.2... once it holds
+ * max_bytes or every hour or day, keeping the newest keep rotated files;
+ * 0 disables a trigger, NULL path turns the sink off. POSIX only */
+CLOG_API bool clog_set_output_rotating(const char *path, size_t max_bytes,
+                                       clog_rotate_t every,
+                                       unsigned int keep) ATTRIBUTE_UNUSED;
+/* Compresses files after rotation, if the tool is installed */
+CLOG_API void clog_set_rotate_compress(clog_compress_t mode) ATTRIBUTE_UNUSED;
+/* Writes len bytes to fd, retrying short writes, EINTR and EAGAIN */
+CLOG_API bool clog_fd_write(int fd, const char *str, size_t len);
 /* Sets minimum log level */
-static void clog_set_level(clog_level_t level) ATTRIBUTE_UNUSED;
+CLOG_API void clog_set_level(clog_level_t level) ATTRIBUTE_UNUSED;
 /* Sets color mode for output */
-static void clog_set_color_mode(clog_color_mode_t mode) ATTRIBUTE_UNUSED;
+CLOG_API void clog_set_color_mode(clog_color_mode_t mode) ATTRIBUTE_UNUSED;
 /* Toggles timestamp display */
-static void clog_set_show_timestamp(bool show) ATTRIBUTE_UNUSED;
+CLOG_API void clog_set_show_timestamp(bool show) ATTRIBUTE_UNUSED;
 /* Toggles location display */
-static void clog_set_show_location(bool show) ATTRIBUTE_UNUSED;
+CLOG_API void clog_set_show_location(bool show) ATTRIBUTE_UNUSED;
+/* Replaces the text layout with a pattern such as "%T %L [%t] %m", parsed
+ * once here; NULL restores the built-in layout. Returns false if the
+ * pattern is malformed or too long */
+CLOG_API bool clog_set_pattern(const char *pattern) ATTRIBUTE_UNUSED;
+/* Selects text, JSON lines or logfmt output */
+CLOG_API void clog_set_output_format(clog_output_format_t format)
+    ATTRIBUTE_UNUSED;
+/* Adds an output with its own level, colors and layout; returns an id for
+ * clog_remove_sink, or -1 when all CLOG_MAX_SINKS slots are taken */
+CLOG_API int clog_add_sink(const clog_sink_config_t *config) ATTRIBUTE_UNUSED;
+/* Removes a sink; once this returns the sink is no longer written to */
+CLOG_API bool clog_remove_sink(int id) ATTRIBUTE_UNUSED;
+/* Keeps records at level and above that the main output drops in
+ * per-thread rings, dumped to path (stderr if NULL) on FATAL and crashes */
+CLOG_API bool clog_set_flight_recorder(clog_level_t level, const char *path)
+    ATTRIBUTE_UNUSED;
+/* Writes a stack trace under main-output text records at level and above;
+ * CLOG_BACKTRACE_OFF stops it. False where backtraces are unavailable */
+CLOG_API bool clog_set_backtrace(clog_level_t level) ATTRIBUTE_UNUSED;
+/* Sets the level of a category and, unless they have their own, of its
+ * subcategories ("net" covers "net.http"); replaces the main output's
+ * level for those records. Returns false when the table is full */
+CLOG_API bool clog_set_category_level(const char *name, clog_level_t level)
+    ATTRIBUTE_UNUSED;
+/* Removes a category's own level so it inherits its parent's again */
+CLOG_API bool clog_clear_category_level(const char *name) ATTRIBUTE_UNUSED;
+/* Returns the level in effect for a category, inherited or not */
+CLOG_API clog_level_t clog_get_category_level(const char *name)
+    ATTRIBUTE_UNUSED;
+/* Writes the lines recorded since the last dump to fd, or to the
+ * recorder's file if fd is negative; async-signal-safe */
+CLOG_API void clog_dump_flight_recorder(int fd) ATTRIBUTE_UNUSED;
+/* Dumps the flight recorder on SIGSEGV, SIGBUS, SIGFPE, SIGILL and SIGABRT,
+ * then hands the signal to the previous disposition (POSIX only) */
+CLOG_API bool clog_install_crash_handlers(void) ATTRIBUTE_UNUSED;
 /* Safely concatenates strings */
-static void clog_safe_strcat(char *dest, const char *src,
-                             size_t dest_size) ATTRIBUTE_UNUSED;
+CLOG_API void clog_safe_strcat(char *dest, const char *src,
+                               size_t dest_size) ATTRIBUTE_UNUSED;
+/* Returns string length, reading at most max_len bytes */
+CLOG_API size_t clog_safe_strlen(const char *str, size_t max_len);
 /* Safely copies strings */
-static void clog_safe_strcpy(char *dest, const char *src,
-                             size_t dest_size) ATTRIBUTE_UNUSED;
-/* Internal logging implementation */
-static void clog_log_impl(clog_level_t level, const char *file, int line,
-                          const char *func, const char *format, va_list args);
+CLOG_API void clog_safe_strcpy(char *dest, const char *src,
+                               size_t dest_size) ATTRIBUTE_UNUSED;
+/* Enables or disables the background writer thread */
+CLOG_API bool clog_set_async(bool enable) ATTRIBUTE_UNUSED;
+/* Selects what happens when the async queue is full */
+CLOG_API void clog_set_async_overflow(clog_overflow_t policy) ATTRIBUTE_UNUSED;
+/* Copies async backend counters into stats */
+CLOG_API void clog_get_async_stats(clog_async_stats_t *stats) ATTRIBUTE_UNUSED;
+/* Copies lock contention counters (zero unless CLOG_LOCK_STATS) */
+CLOG_API void clog_get_lock_stats(clog_lock_stats_t *stats) ATTRIBUTE_UNUSED;
+/* Copies the pipeline counters (zero unless CLOG_STATS) */
+CLOG_API void clog_get_stats(clog_stats_t *stats) ATTRIBUTE_UNUSED;
+/* Publishes the control block for clogctl, or removes it */
+CLOG_API bool clog_set_control(bool enable) ATTRIBUTE_UNUSED;
+/* Zeroes the pipeline and lock counters */
+CLOG_API void clog_reset_stats(void) ATTRIBUTE_UNUSED;
+/* Flushes immediately at or above level, once bytes are buffered, or when
+ * interval_ms has passed since the last flush (0 disables a trigger) */
+CLOG_API void clog_set_flush_policy(clog_level_t level, size_t bytes,
+                                    unsigned int interval_ms) ATTRIBUTE_UNUSED;
+/* Switches to binary records written to fp, or back to text with NULL */
+CLOG_API bool clog_set_binary_output(FILE *fp) ATTRIBUTE_UNUSED;
+/* Turns a binary stream back into the text clog_log_impl would produce */
+CLOG_API bool clog_binary_decode(FILE *in, FILE *out) ATTRIBUTE_UNUSED;
+/* Waits until every record logged so far has reached the output */
+CLOG_API void clog_flush(void);
+/* Buffers one line per the flush policy; returns true if a flush is due */
+CLOG_API bool clog_buffer_line(clog_level_t level, const char *str, size_t len);
+/* Writes the output buffer and flushes the stream; needs clog_mutex */
+CLOG_API void clog_flush_output(void);
+/* Renders one complete line, with nfields structured fields, into dst and
+ * returns its length; when is the timestamp to show, or NULL for now */
+CLOG_API size_t clog_format_record(char *dst, size_t size, clog_level_t level,
+                                   const char *file, int line, const char *func,
+                                   const clog_field_t *fields, size_t nfields,
+                                   const char *format, va_list args,
+                                   bool use_ansi, const struct timespec *when);
+/* Writes one rendered line to the output without flushing */
+CLOG_API void clog_write_record(clog_level_t level, const char *str,
+                                size_t len);
+/* Internal logging implementation, kept out of line and off the hot path */
+CLOG_API void clog_log_impl(clog_level_t level, const char *file, int line,
+                            const char *func, const clog_field_t *fields,
+                            size_t nfields, const char *format, va_list args)
+    ATTRIBUTE_COLD;
 
 #if CLOG_WINDOWS
 /* Initializes Windows console for color support */
-static void clog_init_console(void);
+CLOG_API void clog_init_console(void);
 /* Sets console color based on log level */
-static void clog_set_console_color(clog_level_t level);
+CLOG_API void clog_set_console_color(clog_level_t level);
 /* Resets console color to default */
-static void clog_reset_console_color(void);
+CLOG_API void clog_reset_console_color(void);
 /* Checks if output is a console */
-static bool clog_is_console_output(FILE *fp);
+CLOG_API bool clog_is_console_output(FILE *fp);
+/* Checks if a file descriptor is a console */
+CLOG_API bool clog_is_console_fd(int fd);
 #endif
 
 /* Signal-safe logging function for use in signal handlers */
-static inline void clog_signal_log(const char *message);
+CLOG_API void clog_signal_log(const char *message) ATTRIBUTE_UNUSED;
+/* Signal-safe formatted logging to the output's descriptor: %d %i %u %x %X
+ * %p %s %c with l, ll, z and a zero-padded width; one write per line */
+CLOG_API void clog_signal_logf(clog_level_t level, const char *format, ...)
+    ATTRIBUTE_PRINTF(2, 3) ATTRIBUTE_UNUSED;
 
-/* Main logging function */
-static inline void clog_log(clog_level_t level, const char *file, int line,
-                            const char *func, const char *format, ...) {
-  if (level < clog_min_level)
-    return;
+/* Main logging function; the macros below expand to calls of it */
+CLOG_API void clog_log(clog_level_t level, const char *file, int line,
+                       const char *func, const char *format, ...)
+    ATTRIBUTE_UNUSED;
 
-  if (!atomic_load(&clog_is_initialized)) {
-    clog_init();
-  }
+/* Logs a record of a category; see CLOG_CAT_LOG */
+CLOG_API void clog_log_category(clog_category_site_t *site,
+                                clog_level_t level, const char *file, int line,
+                                const char *func, const char *format, ...)
+    ATTRIBUTE_PRINTF(6, 7) ATTRIBUTE_UNUSED;
+/* Resolves a category call site's levels and returns its new state */
+CLOG_API unsigned int clog_category_resolve(clog_category_site_t *site)
+    ATTRIBUTE_COLD;
 
-  va_list args;
-  va_start(args, format);
-  clog_log_impl(level, file, line, func, format, args);
-  va_end(args);
+/* Logs a message followed by typed key/value fields; see CLOG_KV */
+CLOG_API void clog_log_fields(clog_level_t level, const char *file, int line,
+                              const char *func, const clog_field_t *fields,
+                              size_t nfields, const char *format, ...)
+    ATTRIBUTE_PRINTF(7, 8) ATTRIBUTE_UNUSED;
+
+/* Opens a batch on the calling thread: until clog_batch_commit, its lines
+ * for the main output are collected with one shared timestamp. Returns
+ * false if a batch is already open, which then stays open */
+CLOG_API bool clog_batch_begin(void) ATTRIBUTE_UNUSED;
+/* Logs a record into the open batch; the logging macros join it too */
+CLOG_API void clog_batch_add(clog_level_t level, const char *file, int line,
+                             const char *func, const char *format, ...)
+    ATTRIBUTE_PRINTF(5, 6) ATTRIBUTE_UNUSED;
+/* Writes the batch as one contiguous block under one lock and closes it;
+ * returns false if no batch was open */
+CLOG_API bool clog_batch_commit(void) ATTRIBUTE_UNUSED;
+
+/* Field constructors for CLOG_FIELDS */
+static inline clog_field_t clog_field_int(const char *key, long long value) {
+  clog_field_t field;
+  field.key = key;
+  field.type = CLOG_FIELD_INT;
+  field.value.i = value;
+  return field;
 }
 
-/* Convenience macros */
-#define TRACE(...)                                                             \
-  clog_log(CLOG_TRACE, __FILE__, __LINE__, __func__, __VA_ARGS__)
-#define DEBUG(...)                                                             \
-  clog_log(CLOG_DEBUG, __FILE__, __LINE__, __func__, __VA_ARGS__)
-#define INFO(...) clog_log(CLOG_INFO, __FILE__, __LINE__, __func__, __VA_ARGS__)
-#define WARN(...) clog_log(CLOG_WARN, __FILE__, __LINE__, __func__, __VA_ARGS__)
-#define ERROR(...)                                                             \
-  clog_log(CLOG_ERROR, __FILE__, __LINE__, __func__, __VA_ARGS__)
-#define FATAL(...)                                                             \
-  clog_log(CLOG_FATAL, __FILE__, __LINE__, __func__, __VA_ARGS__)
+static inline clog_field_t clog_field_double(const char *key, double value) {
+  clog_field_t field;
+  field.key = key;
+  field.type = CLOG_FIELD_DOUBLE;
+  field.value.d = value;
+  return field;
+}
 
-/* Backward compatibility */
-#define LOG(level, custom_error, format, ...)                                  \
-  clog_log(level, __FILE__, __LINE__, __func__, format, ##__VA_ARGS__)
+static inline clog_field_t clog_field_str(const char *key, const char *value) {
+  clog_field_t field;
+  field.key = key;
+  field.type = CLOG_FIELD_STRING;
+  field.value.s = value;
+  return field;
+}
 
-/* Implementation */
-static void clog_init(void) {
-  if (atomic_load(&clog_is_initialized)) {
-    return;
-  }
-  bool expected = false;
-  if (atomic_compare_exchange_strong(&clog_is_initialized, &expected, true)) {
-    CLOG_MUTEX_INIT(&clog_mutex);
-#if CLOG_WINDOWS
-    clog_init_console();
-#endif
-    atexit(clog_cleanup);
-  } else {
-    while (!atomic_load(&clog_is_initialized)) {
-      // Busy wait
-    }
-  }
+static inline clog_field_t clog_field_bool(const char *key, bool value) {
+  clog_field_t field;
+  field.key = key;
+  field.type = CLOG_FIELD_BOOL;
+  field.value.b = value;
+  return field;
 }
 
-static void clog_cleanup(void) {
-  if (!atomic_load(&clog_is_initialized))
-    return;
+/* Runtime half of CLOG_ENABLED; compared as clog_level_t like clog_log
+ * always has, so out-of-range levels still reach the output as UNKN */
+static inline bool clog_level_enabled(clog_level_t level) {
+  return level >= (clog_level_t)atomic_load_explicit(&clog_min_level,
+                                                     memory_order_relaxed);
+}
 
-#if CLOG_WINDOWS
-  if (clog_console_initialized && clog_console_handle != INVALID_HANDLE_VALUE) {
-    SetConsoleTextAttribute(clog_console_handle, clog_original_console_attrs);
-    clog_console_initialized = false;
+/* True when a record at level would reach some output, e.g.
+ *   if (CLOG_ENABLED(CLOG_DEBUG)) { dump_tables(); DEBUG("..."); }
+ * Constant-false below CLOG_COMPILE_MIN_LEVEL, where level is evaluated
+ * twice */
+#if CLOG_COMPILE_MIN_LEVEL > CLOG_LEVEL_TRACE
+#define CLOG_ENABLED(level)                                                    \
+  ((int)(level) >= CLOG_COMPILE_MIN_LEVEL && clog_level_enabled(level))
+#else
+#define CLOG_ENABLED(level) clog_level_enabled(level)
+#endif
+
+/* Never called; lets stripped macros keep their format arguments checked */
+static inline void clog_discard(const char *format, ...) ATTRIBUTE_PRINTF(1, 2);
+static inline void clog_discard(const char *format, ...) { (void)format; }
+
+/* Expansion of a macro below CLOG_COMPILE_MIN_LEVEL: the arguments are
+ * type-checked but never evaluated, and no code is emitted */
+#define CLOG_DISCARD(...)                                                      \
+  do {                                                                         \
+    if (0)                                                                     \
+      clog_discard(__VA_ARGS__);                                               \
+  } while (0)
+
+/* True for the 1st, (n+1)th, (2n+1)th... call */
+static inline bool clog_site_every_n(clog_site_t *site, uint64_t n) {
+  uint64_t call = atomic_fetch_add_explicit(&site->calls, 1,
+                                            memory_order_relaxed);
+  return n <= 1 || call % n == 0;
+}
+
+/* True for the first n calls only */
+static inline bool clog_site_first_n(clog_site_t *site, uint64_t n) {
+  if (atomic_load_explicit(&site->calls, memory_order_relaxed) >= n)
+    return false;
+  return atomic_fetch_add_explicit(&site->calls, 1, memory_order_relaxed) < n;
+}
+
+/* True for at most per_sec calls in each one-second window */
+static inline bool clog_site_rate_limit(clog_site_t *site, uint32_t per_sec) {
+  const uint64_t count_mask = (1u << 24) - 1;
+  uint64_t second = clog_now_ns() / 1000000000ull;
+  uint64_t limit = per_sec < count_mask ? per_sec : count_mask;
+  uint64_t old = atomic_load_explicit(&site->window, memory_order_relaxed);
+  for (;;) {
+    uint64_t next;
+    if ((old >> 24) != second)
+      next = second << 24;
+    else
+      next = old;
+    if ((next & count_mask) >= limit)
+      return false;
+    next++;
+    if (atomic_compare_exchange_weak_explicit(&site->window, &old, next,
+                                              memory_order_relaxed,
+                                              memory_order_relaxed))
+      return true;
+  }
+}
+
+/* Counts a suppressed call, and once per CLOG_SUPPRESS_REPORT_MS logs how
+ * many calls the site has skipped. Called with allowed=true before a
+ * message goes out so the report precedes it */
+static inline void clog_site_account(clog_site_t *site, bool allowed,
+                                     clog_level_t level, const char *file,
+                                     int line, const char *func) {
+  if (!allowed)
+    atomic_fetch_add_explicit(&site->suppressed, 1, memory_order_relaxed);
+  else if (atomic_load_explicit(&site->suppressed, memory_order_relaxed) == 0)
+    return;
+
+  uint64_t now = clog_now_ns();
+  uint64_t start =
+      atomic_load_explicit(&site->reported_ns, memory_order_relaxed);
+  if (start == 0) {
+    atomic_compare_exchange_strong(&site->reported_ns, &start, now);
+    return;
+  }
+  if (now - start < (uint64_t)CLOG_SUPPRESS_REPORT_MS * 1000000ull ||
+      !atomic_compare_exchange_strong(&site->reported_ns, &start, now))
+    return;
+
+  uint64_t skipped = atomic_exchange(&site->suppressed, 0);
+  if (skipped)
+    clog_log(level, file, line, func, "Suppressed %llu messages",
+             (unsigned long long)skipped);
+}
+
+/* Shared body of the sampling macros: filters by level before touching the
+ * site, and never formats a suppressed message */
+#define CLOG_SITE_LOG(level, decide, ...)                                      \
+  do {                                                                         \
+    static clog_site_t clog_site_;                                             \
+    clog_level_t clog_site_level_ = (level);                                   \
+    if (CLOG_ENABLED(clog_site_level_)) {                                      \
+      bool clog_site_allowed_ = decide;                                        \
+      clog_site_account(&clog_site_, clog_site_allowed_, clog_site_level_,     \
+                        __FILE__, __LINE__, __func__);                         \
+      if (clog_site_allowed_)                                                  \
+        clog_log(clog_site_level_, __FILE__, __LINE__, __func__,               \
+                 __VA_ARGS__);                                                 \
+    } else {                                                                   \
+      CLOG_STAT_LEVEL(CLOG_STAT_FILTERED, clog_site_level_);                   \
+    }                                                                          \
+  } while (0)
+
+/* Logs the 1st, (n+1)th, (2n+1)th... call at this site */
+#define CLOG_EVERY_N(level, n, ...)                                            \
+  CLOG_SITE_LOG(level, clog_site_every_n(&clog_site_, (n)), __VA_ARGS__)
+/* Logs only the first n calls at this site */
+#define CLOG_FIRST_N(level, n, ...)                                            \
+  CLOG_SITE_LOG(level, clog_site_first_n(&clog_site_, (n)), __VA_ARGS__)
+/* Logs at most per_sec calls per second at this site */
+#define CLOG_RATE_LIMIT(level, per_sec, ...)                                   \
+  CLOG_SITE_LOG(level, clog_site_rate_limit(&clog_site_, (per_sec)),           \
+                __VA_ARGS__)
+
+/* Hot path of the category macros: one load and compare while no level
+ * has changed since the site last resolved its category */
+static inline bool clog_category_enabled(clog_category_site_t *site,
+                                         clog_level_t level) {
+  unsigned int state = atomic_load_explicit(&site->state,
+                                            memory_order_relaxed);
+  if ((state >> 6) != (atomic_load_explicit(&clog_category_generation,
+                                            memory_order_relaxed) &
+                       CLOG_CATEGORY_GENERATION_MASK))
+    state = clog_category_resolve(site);
+  return (unsigned int)level >= (state & 7);
+}
+
+/* Logs under a named category such as "net.http", filtered by the level
+ * clog_set_category_level gave it or its nearest parent, e.g.
+ *   CLOG_CAT_LOG("db", CLOG_DEBUG, "Query took %d ms", ms);
+ * Category names must outlive the call site (string literals do) */
+#define CLOG_CAT_LOG(category, level, ...)                                     \
+  do {                                                                         \
+    static clog_category_site_t clog_cat_site_ = {category, 0};                \
+    clog_level_t clog_cat_level_ = (level);                                    \
+    if ((int)clog_cat_level_ >= CLOG_COMPILE_MIN_LEVEL &&                      \
+        clog_category_enabled(&clog_cat_site_, clog_cat_level_))               \
+      clog_log_category(&clog_cat_site_, clog_cat_level_, __FILE__, __LINE__,  \
+                        __func__, __VA_ARGS__);                                \
+    else                                                                       \
+      CLOG_STAT_LEVEL(CLOG_STAT_FILTERED, clog_cat_level_);                    \
+  } while (0)
+
+/* Expands to the field array and count arguments of CLOG_KV */
+#define CLOG_FIELDS(...)                                                       \
+  (const clog_field_t[]){__VA_ARGS__},                                         \
+      sizeof((const clog_field_t[]){__VA_ARGS__}) / sizeof(clog_field_t)
+
+/* Logs a message with structured fields, e.g.
+ *   CLOG_KV(CLOG_INFO, CLOG_FIELDS(clog_field_int("user", 42)), "Login");
+ * The fields are only built when the level is enabled */
+#define CLOG_KV(level, fields, ...)                                            \
+  do {                                                                         \
+    clog_level_t clog_kv_level_ = (level);                                     \
+    if (CLOG_ENABLED(clog_kv_level_))                                          \
+      clog_log_fields(clog_kv_level_, __FILE__, __LINE__, __func__, fields,    \
+                      __VA_ARGS__);                                            \
+    else                                                                       \
+      CLOG_STAT_LEVEL(CLOG_STAT_FILTERED, clog_kv_level_);                     \
+  } while (0)
+
+/* Body of the convenience macros: the level is tested before any argument
+ * is evaluated, so a filtered call costs one load and compare */
+#define CLOG_LEVEL_LOG(level, ...)                                             \
+  do {                                                                         \
+    clog_level_t clog_log_level_ = (level);                                    \
+    if (CLOG_ENABLED(clog_log_level_))                                         \
+      clog_log(clog_log_level_, __FILE__, __LINE__, __func__, __VA_ARGS__);    \
+    else                                                                       \
+      CLOG_STAT_LEVEL(CLOG_STAT_FILTERED, clog_log_level_);                    \
+  } while (0)
+
+/* Convenience macros */
+#if CLOG_COMPILE_MIN_LEVEL <= CLOG_LEVEL_TRACE
+#define TRACE(...) CLOG_LEVEL_LOG(CLOG_TRACE, __VA_ARGS__)
+#else
+#define TRACE(...) CLOG_DISCARD(__VA_ARGS__)
+#endif
+#if CLOG_COMPILE_MIN_LEVEL <= CLOG_LEVEL_DEBUG
+#define DEBUG(...) CLOG_LEVEL_LOG(CLOG_DEBUG, __VA_ARGS__)
+#else
+#define DEBUG(...) CLOG_DISCARD(__VA_ARGS__)
+#endif
+#if CLOG_COMPILE_MIN_LEVEL <= CLOG_LEVEL_INFO
+#define INFO(...) CLOG_LEVEL_LOG(CLOG_INFO, __VA_ARGS__)
+#else
+#define INFO(...) CLOG_DISCARD(__VA_ARGS__)
+#endif
+#if CLOG_COMPILE_MIN_LEVEL <= CLOG_LEVEL_WARN
+#define WARN(...) CLOG_LEVEL_LOG(CLOG_WARN, __VA_ARGS__)
+#else
+#define WARN(...) CLOG_DISCARD(__VA_ARGS__)
+#endif
+#if CLOG_COMPILE_MIN_LEVEL <= CLOG_LEVEL_ERROR
+#define ERROR(...) CLOG_LEVEL_LOG(CLOG_ERROR, __VA_ARGS__)
+#else
+#define ERROR(...) CLOG_DISCARD(__VA_ARGS__)
+#endif
+#if CLOG_COMPILE_MIN_LEVEL <= CLOG_LEVEL_FATAL
+#define FATAL(...) CLOG_LEVEL_LOG(CLOG_FATAL, __VA_ARGS__)
+#else
+#define FATAL(...) CLOG_DISCARD(__VA_ARGS__)
+#endif
+
+/* Category convenience macros */
+#if CLOG_COMPILE_MIN_LEVEL <= CLOG_LEVEL_TRACE
+#define CLOG_CAT_TRACE(category, ...)                                          \
+  CLOG_CAT_LOG(category, CLOG_TRACE, __VA_ARGS__)
+#else
+#define CLOG_CAT_TRACE(category, ...) CLOG_DISCARD(__VA_ARGS__)
+#endif
+#if CLOG_COMPILE_MIN_LEVEL <= CLOG_LEVEL_DEBUG
+#define CLOG_CAT_DEBUG(category, ...)                                          \
+  CLOG_CAT_LOG(category, CLOG_DEBUG, __VA_ARGS__)
+#else
+#define CLOG_CAT_DEBUG(category, ...) CLOG_DISCARD(__VA_ARGS__)
+#endif
+#if CLOG_COMPILE_MIN_LEVEL <= CLOG_LEVEL_INFO
+#define CLOG_CAT_INFO(category, ...)                                           \
+  CLOG_CAT_LOG(category, CLOG_INFO, __VA_ARGS__)
+#else
+#define CLOG_CAT_INFO(category, ...) CLOG_DISCARD(__VA_ARGS__)
+#endif
+#if CLOG_COMPILE_MIN_LEVEL <= CLOG_LEVEL_WARN
+#define CLOG_CAT_WARN(category, ...)                                           \
+  CLOG_CAT_LOG(category, CLOG_WARN, __VA_ARGS__)
+#else
+#define CLOG_CAT_WARN(category, ...) CLOG_DISCARD(__VA_ARGS__)
+#endif
+#if CLOG_COMPILE_MIN_LEVEL <= CLOG_LEVEL_ERROR
+#define CLOG_CAT_ERROR(category, ...)                                          \
+  CLOG_CAT_LOG(category, CLOG_ERROR, __VA_ARGS__)
+#else
+#define CLOG_CAT_ERROR(category, ...) CLOG_DISCARD(__VA_ARGS__)
+#endif
+#if CLOG_COMPILE_MIN_LEVEL <= CLOG_LEVEL_FATAL
+#define CLOG_CAT_FATAL(category, ...)                                          \
+  CLOG_CAT_LOG(category, CLOG_FATAL, __VA_ARGS__)
+#else
+#define CLOG_CAT_FATAL(category, ...) CLOG_DISCARD(__VA_ARGS__)
+#endif
+
+/* Backward compatibility */
+#define LOG(level, custom_error, format, ...)                                  \
+  CLOG_LEVEL_LOG(level, format, ##__VA_ARGS__)
+
+/* Implementation */
+#if CLOG_DEFINE_IMPL
+#if CLOG_POSIX
+/* Unmaps the memory-mapped sink; defined with the output functions */
+static void clog_mmap_close(void);
+#endif
+#if CLOG_HAS_ROTATE
+/* Turns the rotating sink off and waits for pending rotation work */
+static void clog_rotate_stop(void);
+#endif
+/* Recomputes the level gates; defined with the level setters */
+static void clog_update_min_level(void);
+
+CLOG_API void clog_init(void) {
+  if (atomic_load(&clog_is_initialized)) {
+    return;
+  }
+  bool expected = false;
+  if (atomic_compare_exchange_strong(&clog_is_initialized, &expected, true)) {
+    CLOG_MUTEX_INIT(&clog_mutex);
+    CLOG_MUTEX_INIT(&clog_sink_mutex);
+#if CLOG_HAS_BACKTRACE
+    CLOG_MUTEX_INIT(&clog_backtrace_mutex);
+#endif
+    clog_start_ns = clog_now_ns();
+#if CLOG_WINDOWS
+    clog_init_console();
+#endif
+    atexit(clog_cleanup);
+#if defined(CLOG_ASYNC) && CLOG_HAS_ASYNC
+    clog_set_async(true);
+#endif
+#if defined(CLOG_CONTROL) && CLOG_HAS_CONTROL
+    clog_set_control(true);
+#endif
+  } else {
+    while (!atomic_load(&clog_is_initialized)) {
+      // Busy wait
+    }
+  }
+}
+
+CLOG_API void clog_cleanup(void) {
+  if (!atomic_load(&clog_is_initialized))
+    return;
+
+  /* Other threads' open batches are lost, but not the exiting thread's */
+  clog_batch_commit();
+  clog_set_control(false);
+
+#if CLOG_HAS_ASYNC
+  clog_set_async(false);
+#endif
+#if CLOG_HAS_ROTATE
+  clog_rotate_stop();
+#endif
+
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  clog_flush_output();
+  free(clog_out_buf);
+  clog_out_buf = NULL;
+  if (clog_binary_output)
+    fflush(clog_binary_output);
+  clog_binary_output = NULL;
+  free(clog_binary_sites);
+  clog_binary_sites = NULL;
+#if CLOG_POSIX
+  clog_mmap_close();
+#endif
+  CLOG_MUTEX_UNLOCK(&clog_mutex);
+
+  clog_set_flight_recorder(CLOG_RECORDER_OFF, NULL);
+
+  /* Sinks belong to the caller: flushed but never closed */
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  for (int i = 0; i < CLOG_MAX_SINKS; i++) {
+    if (clog_sinks[i].id && clog_sinks[i].fp)
+      fflush(clog_sinks[i].fp);
+  }
+  memset(clog_sinks, 0, sizeof(clog_sinks));
+  atomic_store(&clog_sink_count, 0);
+  clog_category_count = 0;
+  clog_update_min_level();
+  clog_pattern_t *pattern = atomic_exchange(&clog_pattern, NULL);
+  if (pattern) {
+    pattern->retired = clog_pattern_retired;
+    clog_pattern_retired = pattern;
+  }
+  while (clog_pattern_retired) {
+    pattern = clog_pattern_retired;
+    clog_pattern_retired = pattern->retired;
+    free(pattern);
+  }
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+
+#if CLOG_WINDOWS
+  if (clog_console_initialized && clog_console_handle != INVALID_HANDLE_VALUE) {
+    SetConsoleTextAttribute(clog_console_handle, clog_original_console_attrs);
+    clog_console_initialized = false;
   }
 #endif
 
   CLOG_MUTEX_DESTROY(&clog_mutex);
+  CLOG_MUTEX_DESTROY(&clog_sink_mutex);
+#if CLOG_HAS_BACKTRACE
+  CLOG_MUTEX_DESTROY(&clog_backtrace_mutex);
+  clog_backtrace_level = CLOG_BACKTRACE_OFF;
+#endif
   atomic_store(&clog_is_initialized, false);
 }
 
-static void clog_set_level(clog_level_t level) { clog_min_level = level; }
+/* Recomputes the lowest level any output accepts and makes category call
+ * sites resolve their levels again; needs clog_sink_mutex */
+static void clog_update_min_level(void) {
+  clog_level_t level = CLOG_CATEGORY_OFF;
+  for (int i = 0; i < CLOG_MAX_SINKS; i++) {
+    if (clog_sinks[i].id && clog_sinks[i].level < level)
+      level = clog_sinks[i].level;
+  }
+#if CLOG_HAS_RECORDER
+  if (clog_recorder_level < level)
+    level = clog_recorder_level;
+#endif
+  clog_aux_min_level = level;
+  clog_level_t output = (clog_level_t)atomic_load(&clog_output_level);
+  if (output < level)
+    level = output;
+  atomic_store_explicit(&clog_min_level, level, memory_order_relaxed);
+#if CLOG_HAS_CONTROL
+  if (clog_control.block) {
+    atomic_store(&clog_control.block->level, (int)output);
+    atomic_store(&clog_control.block->min_level, (int)level);
+  }
+#endif
+  /* Generation 0 would match never-resolved sites */
+  unsigned int generation = atomic_fetch_add(&clog_category_generation, 1) + 1;
+  if ((generation & CLOG_CATEGORY_GENERATION_MASK) == 0)
+    atomic_fetch_add(&clog_category_generation, 1);
+}
+
+CLOG_API void clog_set_level(clog_level_t level) {
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  atomic_store(&clog_output_level, (int)level);
+  clog_update_min_level();
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+}
 
-static void clog_set_color_mode(clog_color_mode_t mode) {
+CLOG_API void clog_set_color_mode(clog_color_mode_t mode) {
   clog_color_mode = mode;
 }
 
-static void clog_set_output(FILE *fp) { clog_output = fp; }
+CLOG_API void clog_set_output(FILE *fp) {
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  /* Records queued for the previous output must land there first */
+  clog_flush();
+#if CLOG_HAS_ROTATE
+  clog_rotate_stop();
+#endif
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  clog_flush_output();
+#if CLOG_POSIX
+  clog_mmap_close();
+#endif
+  clog_output = fp;
+  clog_output_fd = -1;
+#if CLOG_WINDOWS
+  clog_output_fileno = fp ? _fileno(fp) : 1;
+#else
+  clog_output_fileno = fp ? fileno(fp) : STDOUT_FILENO;
+#endif
+  CLOG_MUTEX_UNLOCK(&clog_mutex);
+}
+
+CLOG_API void clog_set_output_fd(int fd) {
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  clog_flush();
+#if CLOG_HAS_ROTATE
+  clog_rotate_stop();
+#endif
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  clog_flush_output();
+#if CLOG_POSIX
+  clog_mmap_close();
+#endif
+  clog_output_fd = fd;
+  CLOG_MUTEX_UNLOCK(&clog_mutex);
+}
+
+CLOG_API void clog_set_show_timestamp(bool show) {
+  atomic_store(&clog_show_timestamp, show);
+}
 
-static void clog_set_show_timestamp(bool show) { clog_show_timestamp = show; }
+CLOG_API void clog_set_show_location(bool show) { clog_show_location = show; }
 
-static void clog_set_show_location(bool show) { clog_show_location = show; }
+CLOG_API void clog_set_output_format(clog_output_format_t format) {
+  clog_output_format = format;
+}
 
-static const char *clog_level_string(clog_level_t level) {
+CLOG_API const char *clog_level_string(clog_level_t level) {
   switch (level) {
   case CLOG_TRACE:
     return "TRACE";
@@ -290,7 +1848,7 @@ static const char *clog_level_string(clog_level_t level) {
   }
 }
 
-static const char *clog_level_color_ansi(clog_level_t level) {
+CLOG_API const char *clog_level_color_ansi(clog_level_t level) {
   switch (level) {
   case CLOG_TRACE:
     return CLOG_DIM CLOG_WHITE;
@@ -310,7 +1868,7 @@ static const char *clog_level_color_ansi(clog_level_t level) {
 }
 
 #if CLOG_WINDOWS
-static void clog_init_console(void) {
+CLOG_API void clog_init_console(void) {
   if (clog_console_initialized)
     return;
 
@@ -330,7 +1888,7 @@ static void clog_init_console(void) {
   }
 }
 
-static void clog_set_console_color(clog_level_t level) {
+CLOG_API void clog_set_console_color(clog_level_t level) {
   if (!clog_console_initialized ||
       clog_console_handle == INVALID_HANDLE_VALUE) {
     return;
@@ -364,285 +1922,4546 @@ static void clog_set_console_color(clog_level_t level) {
   SetConsoleTextAttribute(clog_console_handle, color);
 }
 
-static void clog_reset_console_color(void) {
+CLOG_API void clog_reset_console_color(void) {
   if (clog_console_initialized && clog_console_handle != INVALID_HANDLE_VALUE) {
     SetConsoleTextAttribute(clog_console_handle, clog_original_console_attrs);
   }
 }
 
-static bool clog_is_console_output(FILE *fp) {
+CLOG_API bool clog_is_console_output(FILE *fp) {
   if (!fp)
     fp = stdout;
 
-  int fd = _fileno(fp);
+  return clog_is_console_fd(_fileno(fp));
+}
+
+CLOG_API bool clog_is_console_fd(int fd) {
   HANDLE h = (HANDLE)_get_osfhandle(fd);
   DWORD mode;
   return GetConsoleMode(h, &mode) != 0;
 }
 #endif
 
-static void clog_format_time(char *buffer, size_t size) {
-  time_t now;
-  struct tm *tm_info;
+/* "00".."99" for rendering two digits per lookup */
+static const char clog_digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "74757677787980818283848586878889909192939495969798"
+    "99";
 
-  now = time(NULL);
-  if (now == (time_t)-1) {
-    snprintf(buffer, size, "0000-00-00 00:00:00");
-    return;
-  }
+static inline char *clog_put2(char *p, unsigned int v) {
+  memcpy(p, &clog_digit_pairs[v * 2], 2);
+  return p + 2;
+}
 
-#if CLOG_WINDOWS
-  struct tm tm_storage;
-  if (localtime_s(&tm_storage, &now) != 0) {
-    snprintf(buffer, size, "0000-00-00 00:00:00");
-    return;
-  }
-  tm_info = &tm_storage;
-#else
-  struct tm tm_storage;
-  tm_info = localtime_r(&now, &tm_storage);
-  if (!tm_info) {
-    snprintf(buffer, size, "0000-00-00 00:00:00");
-    return;
+/* Days since 1970-01-01 to a proleptic Gregorian date (H. Hinnant) */
+static void clog_civil_from_days(long long z, int *year, unsigned int *month,
+                                 unsigned int *day) {
+  z += 719468;
+  long long era = (z >= 0 ? z : z - 146096) / 146097;
+  unsigned int doe = (unsigned int)(z - era * 146097);
+  unsigned int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  unsigned int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  unsigned int mp = (5 * doy + 2) / 153;
+  *day = doy - (153 * mp + 2) / 5 + 1;
+  *month = mp < 10 ? mp + 3 : mp - 9;
+  *year = (int)(yoe + era * 400) + (*month <= 2);
+}
+
+static long long clog_days_from_civil(int year, unsigned int month,
+                                      unsigned int day) {
+  year -= month <= 2;
+  long long era = (year >= 0 ? year : year - 399) / 400;
+  unsigned int yoe = (unsigned int)(year - era * 400);
+  unsigned int mp = month > 2 ? month - 3 : month + 9;
+  unsigned int doy = (153 * mp + 2) / 5 + day - 1;
+  unsigned int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (long long)doe - 719468;
+}
+
+/* Renders local seconds since the epoch as YYYY-MM-DD HH:MM:SS, with a T
+ * separator for ISO 8601; returns NULL past year 9999 */
+static char *clog_put_datetime(char *p, long long local, bool iso) {
+  long long days = (local >= 0 ? local : local - 86399) / 86400;
+  long long secs = local - days * 86400;
+  int year;
+  unsigned int month, day;
+  clog_civil_from_days(days, &year, &month, &day);
+  if (year < 0 || year > 9999)
+    return NULL;
+
+  p = clog_put2(p, (unsigned int)year / 100);
+  p = clog_put2(p, (unsigned int)year % 100);
+  *p++ = '-';
+  p = clog_put2(p, month);
+  *p++ = '-';
+  p = clog_put2(p, day);
+  *p++ = iso ? 'T' : ' ';
+  p = clog_put2(p, (unsigned int)(secs / 3600));
+  *p++ = ':';
+  p = clog_put2(p, (unsigned int)(secs / 60 % 60));
+  *p++ = ':';
+  return clog_put2(p, (unsigned int)(secs % 60));
+}
+
+/* Renders the ISO 8601 zone designator: Z, +HH:MM, or nothing */
+static char *clog_put_zone(char *p, long offset, bool iso, bool utc) {
+  if (iso && utc) {
+    *p++ = 'Z';
+  } else if (iso) {
+    long abs_offset = offset < 0 ? -offset : offset;
+    *p++ = offset < 0 ? '-' : '+';
+    p = clog_put2(p, (unsigned int)(abs_offset / 3600 % 100));
+    *p++ = ':';
+    p = clog_put2(p, (unsigned int)(abs_offset / 60 % 60));
   }
-#endif
+  return p;
+}
 
-  if (strftime(buffer, size, "%Y-%m-%d %H:%M:%S", tm_info) == 0) {
-    snprintf(buffer, size, "0000-00-00 00:00:00");
+/* Renders '.' and the leading digits of nsec; nothing for 0 digits */
+static char *clog_put_fraction(char *p, long nsec, int digits) {
+  static const unsigned int pow10[] = {1,      10,      100,      1000,
+                                       10000,  100000,  1000000,  10000000,
+                                       100000000, 1000000000};
+  if (digits <= 0 || digits > 9)
+    return p;
+  unsigned int frac = (unsigned int)nsec / pow10[9 - digits];
+  *p = '.';
+  for (int i = digits; i > 0; i--) {
+    p[i] = (char)('0' + frac % 10);
+    frac /= 10;
   }
+  return p + digits + 1;
 }
 
-static void clog_safe_write(const char *str, size_t len) {
-  FILE *output = clog_output ? clog_output : stdout;
+/* Local UTC offset, recomputed at most once per quarter hour so the hot path
+ * never takes the tz lock inside localtime_r */
+static long clog_utc_offset(time_t now) {
+  if ((long long)now <
+      atomic_load_explicit(&clog_tz_valid_until, memory_order_acquire))
+    return atomic_load_explicit(&clog_tz_offset, memory_order_relaxed);
+
+  struct tm tm_storage;
 #if CLOG_WINDOWS
-  if (clog_is_console_output(output)) {
-    int wlen = MultiByteToWideChar(CP_UTF8, 0, str, len, NULL, 0);
-    if (wlen > 0) {
-      wchar_t *wstr = malloc((wlen + 1) * sizeof(wchar_t));
-      if (wstr) {
-        MultiByteToWideChar(CP_UTF8, 0, str, len, wstr, wlen);
-        wstr[wlen] = L'\0';
-        fwprintf(output, L"%s", wstr);
-        free(wstr);
-      } else {
-        fwrite(str, 1, len, output);
-      }
-    } else {
-      fwrite(str, 1, len, output);
-    }
-  } else {
-    fwrite(str, 1, len, output);
-  }
+  if (localtime_s(&tm_storage, &now) != 0)
+    return 0;
 #else
-  fwrite(str, 1, len, output);
+  if (!localtime_r(&now, &tm_storage))
+    return 0;
 #endif
-  fflush(output);
+  long long local =
+      clog_days_from_civil(tm_storage.tm_year + 1900,
+                           (unsigned int)tm_storage.tm_mon + 1,
+                           (unsigned int)tm_storage.tm_mday) *
+          86400 +
+      tm_storage.tm_hour * 3600 + tm_storage.tm_min * 60 + tm_storage.tm_sec;
+  long offset = (long)(local - (long long)now);
+  atomic_store_explicit(&clog_tz_offset, offset, memory_order_relaxed);
+  atomic_store_explicit(&clog_tz_valid_until, ((long long)now / 900 + 1) * 900,
+                        memory_order_release);
+  return offset;
 }
 
-static inline void clog_signal_log(const char *message) {
-#if CLOG_POSIX
-  size_t len = strlen(message);
-  write(STDERR_FILENO, message, len);
-  write(STDERR_FILENO, "\n", 1);
-#else /* CLOG_WINDOWS */
-  size_t len = strlen(message);
-  int wlen = MultiByteToWideChar(CP_UTF8, 0, message, len, NULL, 0);
-  if (wlen > 0) {
-    wchar_t *wstr = malloc((wlen + 1) * sizeof(wchar_t));
-    if (wstr) {
-      MultiByteToWideChar(CP_UTF8, 0, message, len, wstr, wlen);
-      wstr[wlen] = L'\0';
-      fwprintf(stderr, L"%s\n", wstr);
-      free(wstr);
-    } else {
-      _write(_fileno(stderr), message, len);
-      _write(_fileno(stderr), "\n", 1);
-    }
-  } else {
-    _write(_fileno(stderr), message, len);
-    _write(_fileno(stderr), "\n", 1);
-  }
+static bool clog_clock_now(struct timespec *ts) {
+#if CLOG_WINDOWS
+  return timespec_get(ts, TIME_UTC) != 0;
+#else
+#ifdef CLOCK_REALTIME_COARSE
+  if (atomic_load_explicit(&clog_time_coarse, memory_order_relaxed))
+    return clock_gettime(CLOCK_REALTIME_COARSE, ts) == 0;
+#endif
+  return clock_gettime(CLOCK_REALTIME, ts) == 0;
 #endif
 }
 
-static size_t clog_safe_strlen(const char *str, size_t max_len) {
-  if (!str)
-    return 0;
-  size_t len = 0;
-  while (len < max_len && str[len] != '\0') {
-    len++;
-  }
-  return len;
+static void clog_invalidate_time_cache(void) {
+  atomic_store(&clog_tz_valid_until, 0);
+  atomic_fetch_add(&clog_time_generation, 1);
 }
 
-static void clog_safe_strcpy(char *dest, const char *src, size_t dest_size) {
-  if (!dest || dest_size == 0)
-    return;
-  if (!src) {
-    dest[0] = '\0';
-    return;
-  }
-
-  size_t i = 0;
-  while (i < dest_size - 1 && src[i] != '\0') {
-    dest[i] = src[i];
-    i++;
-  }
-  dest[i] = '\0';
+CLOG_API void clog_set_time_precision(clog_time_precision_t precision) {
+  atomic_store(&clog_time_precision, (int)precision);
 }
 
-static void clog_safe_strcat(char *dest, const char *src, size_t dest_size) {
-  if (!dest || !src || dest_size == 0)
-    return;
+CLOG_API void clog_set_time_format(clog_time_format_t format) {
+  atomic_store(&clog_time_format, (int)format);
+  clog_invalidate_time_cache();
+}
 
-  size_t dest_len = clog_safe_strlen(dest, dest_size);
-  if (dest_len >= dest_size - 1)
-    return;
+CLOG_API void clog_set_time_utc(bool utc) {
+  atomic_store(&clog_time_utc, utc);
+  clog_invalidate_time_cache();
+}
 
-  size_t remaining = dest_size - dest_len - 1;
-  size_t i = 0;
+CLOG_API void clog_set_time_coarse(bool coarse) {
+  atomic_store(&clog_time_coarse, coarse);
+}
 
-  while (i < remaining && src[i] != '\0') {
-    dest[dest_len + i] = src[i];
-    i++;
+CLOG_API size_t clog_format_time(char *buffer, size_t size) {
+  struct timespec ts;
+  if (!clog_clock_now(&ts)) {
+    clog_safe_strcpy(buffer, "0000-00-00 00:00:00", size);
+    return clog_safe_strlen(buffer, size);
   }
-  dest[dest_len + i] = '\0';
+  return clog_format_timespec(&ts, buffer, size);
 }
 
-static const char *clog_basename(const char *path) {
-  if (!path)
-    return "unknown";
+/* clog_format_timespec with the time settings of settings, or of the
+ * globals if it is NULL */
+static size_t clog_format_timespec_as(const struct timespec *ts,
+                                      char *buffer, size_t size,
+                                      const clog_render_settings_t *settings) {
+  /* The date/time text only changes once per second: each thread keeps the
+   * last rendering and only appends the fraction on a cache hit */
+  static CLOG_THREAD_LOCAL struct {
+    long long sec;
+    unsigned int generation;
+    bool iso;
+    bool utc;
+    size_t prefix_len;
+    size_t suffix_len;
+    char prefix[24]; /* YYYY-MM-DD HH:MM:SS */
+    char suffix[8];  /* Z or +HH:MM */
+  } cache = {-1, 0, false, false, 0, 0, {0}, {0}};
+  static const char fallback[] = "0000-00-00 00:00:00";
 
-  const char *filename = path;
-  const char *p = path;
+  if (size == 0)
+    return 0;
 
-  while (*p) {
-    if (*p == '/' || *p == '\\') {
-      filename = p + 1;
+  unsigned int generation =
+      atomic_load_explicit(&clog_time_generation, memory_order_relaxed);
+  bool iso, utc;
+  if (settings) {
+    iso = settings->time_format == CLOG_TIME_FORMAT_ISO8601;
+    utc = settings->time_utc;
+  } else {
+    iso = atomic_load_explicit(&clog_time_format, memory_order_relaxed) ==
+          CLOG_TIME_FORMAT_ISO8601;
+    utc = atomic_load_explicit(&clog_time_utc, memory_order_relaxed);
+  }
+  if ((long long)ts->tv_sec != cache.sec || generation != cache.generation ||
+      iso != cache.iso || utc != cache.utc) {
+    long offset = utc ? 0 : clog_utc_offset(ts->tv_sec);
+    char *p = clog_put_datetime(cache.prefix, (long long)ts->tv_sec + offset,
+                                iso);
+    if (!p) {
+      clog_safe_strcpy(buffer, fallback, size);
+      return clog_safe_strlen(buffer, size);
     }
-    p++;
+    cache.prefix_len = (size_t)(p - cache.prefix);
+    p = clog_put_zone(cache.suffix, offset, iso, utc);
+    cache.suffix_len = (size_t)(p - cache.suffix);
+    cache.sec = (long long)ts->tv_sec;
+    cache.generation = generation;
+    cache.iso = iso;
+    cache.utc = utc;
   }
 
-  return filename;
-}
+  char text[CLOG_MAX_TIME_SIZE > 48 ? CLOG_MAX_TIME_SIZE : 48];
+  memcpy(text, cache.prefix, cache.prefix_len);
+  size_t len = cache.prefix_len;
 
-static bool clog_should_use_colors(void) {
-  FILE *output = clog_output ? clog_output : stdout;
+  int digits = settings ? settings->time_precision
+                        : atomic_load_explicit(&clog_time_precision,
+                                               memory_order_relaxed);
+  len = (size_t)(clog_put_fraction(text + len, ts->tv_nsec, digits) - text);
+
+  memcpy(text + len, cache.suffix, cache.suffix_len);
+  len += cache.suffix_len;
+
+  if (len > size - 1)
+    len = size - 1;
+  memcpy(buffer, text, len);
+  buffer[len] = '\0';
+  return len;
+}
+
+CLOG_API size_t clog_format_timespec(const struct timespec *ts, char *buffer,
+                                     size_t size) {
+  return clog_format_timespec_as(ts, buffer, size, NULL);
+}
+
+#if CLOG_POSIX
+/* Waits until a non-blocking descriptor can take more data */
+static void clog_fd_wait_writable(int fd) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLOUT;
+  pfd.revents = 0;
+  while (poll(&pfd, 1, -1) < 0 && errno == EINTR) {
+  }
+}
+
+/* Writes every iovec, resuming after short writes; iov is consumed */
+static bool clog_fd_writev(int fd, struct iovec *iov, int iovcnt) {
+  while (iovcnt > 0) {
+    ssize_t n = writev(fd, iov, iovcnt < CLOG_IOV_MAX ? iovcnt : CLOG_IOV_MAX);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        clog_fd_wait_writable(fd);
+        continue;
+      }
+      return false;
+    }
+    if (n == 0)
+      return false;
+
+    size_t done = (size_t)n;
+    while (iovcnt > 0 && done >= iov->iov_len) {
+      done -= iov->iov_len;
+      iov++;
+      iovcnt--;
+    }
+    if (iovcnt > 0) {
+      iov->iov_base = (char *)iov->iov_base + done;
+      iov->iov_len -= done;
+    }
+  }
+  return true;
+}
+#endif
+
+CLOG_API bool clog_fd_write(int fd, const char *str, size_t len) {
+#if CLOG_POSIX
+  struct iovec iov;
+  iov.iov_base = (void *)str;
+  iov.iov_len = len;
+  return clog_fd_writev(fd, &iov, 1);
+#else
+  while (len > 0) {
+    int n = _write(fd, str, len > INT_MAX ? INT_MAX : (unsigned int)len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    str += n;
+    len -= (size_t)n;
+  }
+  return true;
+#endif
+}
+
+#if CLOG_POSIX
+/* Maps a fresh window whose first free byte is file offset end; needs
+ * clog_mutex */
+static bool clog_mmap_map(clog_mmap_segment_t *seg, uint64_t end) {
+  uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+  uint64_t offset = end & ~(page - 1);
+  size_t size = clog_mmap_segment_size;
+
+  /* Reserve the blocks up front: writing a hole on a full disk is SIGBUS.
+   * posix_fallocate is only declared in POSIX.1-2001 mode and later */
+#if defined(_POSIX_C_SOURCE) && _POSIX_C_SOURCE >= 200112L &&                  \
+    !defined(__APPLE__)
+  if (posix_fallocate(clog_mmap_fd, (off_t)offset, (off_t)size) != 0 &&
+      ftruncate(clog_mmap_fd, (off_t)(offset + size)) != 0)
+    return false;
+#else
+  if (ftruncate(clog_mmap_fd, (off_t)(offset + size)) != 0)
+    return false;
+#endif
+  void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    clog_mmap_fd, (off_t)offset);
+  if (base == MAP_FAILED)
+    return false;
+
+  seg->base = (char *)base;
+  seg->size = size;
+  seg->offset = offset;
+  atomic_store(&seg->used, SIZE_MAX);
+  atomic_store(&seg->tail, (size_t)(end - offset));
+  return true;
+}
+
+/* Unpublishes seg and waits until no writer is copying into it */
+static size_t clog_mmap_retire(clog_mmap_segment_t *seg) {
+  unsigned int round = 0;
+  while (atomic_load(&seg->users) != 0) {
+    if (!clog_lock_backoff(&round))
+      sched_yield();
+  }
+  size_t used = atomic_load(&seg->used);
+  if (used == SIZE_MAX) {
+    used = atomic_load(&seg->tail);
+    if (used > seg->size)
+      used = seg->size;
+  }
+  munmap(seg->base, seg->size);
+  return used;
+}
+
+/* Unmaps the sink and trims the preallocated tail; needs clog_mutex */
+static void clog_mmap_close(void) {
+  clog_mmap_segment_t *seg = atomic_load(&clog_mmap_current);
+  if (!seg)
+    return;
+  atomic_store(&clog_mmap_current, NULL);
+  uint64_t end = seg->offset + clog_mmap_retire(seg);
+  if (ftruncate(clog_mmap_fd, (off_t)end) != 0) {
+    /* The file keeps zeroed space at the end; the lines are intact */
+  }
+  close(clog_mmap_fd);
+  clog_mmap_fd = -1;
+}
+
+/* Replaces a full window with one starting where its data ends; returns
+ * false once the sink is gone. Needs clog_mutex */
+static bool clog_mmap_roll(clog_mmap_segment_t *full) {
+  /* Someone else rolled already; full may even be current again, remapped,
+   * so only a window that has overflowed counts */
+  if (atomic_load(&clog_mmap_current) != full ||
+      atomic_load(&full->tail) <= full->size)
+    return atomic_load(&clog_mmap_current) != NULL;
+
+  /* The writer whose reservation crossed the end records it right away */
+  size_t used;
+  unsigned int round = 0;
+  while ((used = atomic_load(&full->used)) == SIZE_MAX) {
+    if (!clog_lock_backoff(&round))
+      sched_yield();
+  }
+
+  clog_mmap_segment_t *next = full == &clog_mmap_segments[0]
+                                  ? &clog_mmap_segments[1]
+                                  : &clog_mmap_segments[0];
+  if (!clog_mmap_map(next, full->offset + used)) {
+    clog_mmap_close();
+    return false;
+  }
+  atomic_store(&clog_mmap_current, next);
+  clog_mmap_retire(full);
+  return true;
+}
+
+/* Copies one line into the mapping; false if the sink is not open */
+static bool clog_mmap_write(const char *str, size_t len, bool locked) {
+  for (;;) {
+    clog_mmap_segment_t *seg = atomic_load(&clog_mmap_current);
+    if (!seg)
+      return false;
+    atomic_fetch_add(&seg->users, 1);
+    if (atomic_load(&clog_mmap_current) != seg) {
+      atomic_fetch_sub(&seg->users, 1);
+      continue;
+    }
+
+    size_t pos =
+        atomic_fetch_add_explicit(&seg->tail, len, memory_order_relaxed);
+    if (pos + len <= seg->size) {
+      memcpy(seg->base + pos, str, len);
+      atomic_fetch_sub_explicit(&seg->users, 1, memory_order_release);
+      return true;
+    }
+    if (pos <= seg->size)
+      atomic_store(&seg->used, pos);
+    atomic_fetch_sub(&seg->users, 1);
+
+    if (!locked)
+      CLOG_MUTEX_LOCK(&clog_mutex);
+    bool open = clog_mmap_roll(seg);
+    if (!locked)
+      CLOG_MUTEX_UNLOCK(&clog_mutex);
+    if (!open)
+      return false;
+  }
+}
+
+/* Opens path for appending through the mapping; needs clog_mutex */
+static bool clog_mmap_open(const char *path, size_t segment_size) {
+  uint64_t page = (uint64_t)sysconf(_SC_PAGESIZE);
+  /* A line must always fit in a fresh window after its unaligned start */
+  uint64_t min_size = 16 * page + 2 * (uint64_t)CLOG_MAX_LINE_SIZE;
+  uint64_t size = segment_size ? segment_size : CLOG_MMAP_SEGMENT_SIZE;
+  if (size < min_size)
+    size = min_size;
+  size = (size + page - 1) & ~(page - 1);
+
+  int fd = open(path, O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+
+  clog_mmap_fd = fd;
+  clog_mmap_segment_size = (size_t)size;
+  if (!clog_mmap_map(&clog_mmap_segments[0], (uint64_t)st.st_size)) {
+    close(fd);
+    clog_mmap_fd = -1;
+    return false;
+  }
+  atomic_store(&clog_mmap_current, &clog_mmap_segments[0]);
+  return true;
+}
+#endif
+
+CLOG_API bool clog_set_output_mmap(const char *path, size_t segment_size) {
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+#if CLOG_POSIX
+  clog_flush();
+#if CLOG_HAS_ROTATE
+  clog_rotate_stop();
+#endif
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  clog_flush_output();
+  clog_mmap_close();
+  bool ok = !path || clog_mmap_open(path, segment_size);
+  CLOG_MUTEX_UNLOCK(&clog_mutex);
+  return ok;
+#else
+  (void)segment_size;
+  return !path;
+#endif
+}
+
+#if CLOG_HAS_ROTATE
+extern char **environ;
+
+static const char *const clog_rotate_exts[] = {"", ".gz", ".zst"};
+
+/* First local hour or day boundary after now */
+static time_t clog_rotate_deadline(time_t now, clog_rotate_t every) {
+  long long period = every == CLOG_ROTATE_HOURLY ? 3600 : 86400;
+  long long local = (long long)now + clog_utc_offset(now);
+  return (time_t)((local / period + 1) * period - (local - (long long)now));
+}
+
+/* path.index followed by ext; index 0 names path itself */
+static void clog_rotate_name(char *dst, size_t size, const char *path,
+                             unsigned int index, const char *ext) {
+  if (index)
+    snprintf(dst, size, "%s.%u%s", path, index, ext);
+  else
+    snprintf(dst, size, "%s%s", path, ext);
+}
+
+/* Shifts path.N to path.N+1, dropping the oldest, then moves path to path.1
+ * and the successor (path.next) into its place */
+static void clog_rotate_files(const char *path, unsigned int keep, char *from,
+                              char *to, size_t size) {
+  size_t exts = sizeof(clog_rotate_exts) / sizeof(clog_rotate_exts[0]);
+  for (size_t e = 0; keep && e < exts; e++) {
+    clog_rotate_name(from, size, path, keep, clog_rotate_exts[e]);
+    remove(from);
+  }
+  for (unsigned int i = keep; i-- > 1;) {
+    for (size_t e = 0; e < exts; e++) {
+      clog_rotate_name(from, size, path, i, clog_rotate_exts[e]);
+      clog_rotate_name(to, size, path, i + 1, clog_rotate_exts[e]);
+      rename(from, to);
+    }
+  }
+  if (keep) {
+    clog_rotate_name(to, size, path, 1, "");
+    rename(path, to);
+  } else {
+    remove(path);
+  }
+  clog_rotate_name(from, size, path, 0, ".next");
+  rename(from, path);
+}
+
+/* Runs a compressor and waits for it; false if it is missing or failed */
+static bool clog_rotate_spawn(const char *const argv[]) {
+  pid_t pid;
+  int status;
+  if (posix_spawnp(&pid, argv[0], NULL, NULL, (char *const *)argv,
+                   environ) != 0)
+    return false;
+  while (waitpid(pid, &status, 0) < 0) {
+    if (errno != EINTR)
+      return false;
+  }
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void *clog_rotate_thread(void *arg) {
+  (void)arg;
+  const char *path = clog_rotate.path;
+  size_t size = strlen(path) + 32;
+  char *from = (char *)malloc(size);
+  char *to = (char *)malloc(size);
+
+  pthread_mutex_lock(&clog_rotate.park_mutex);
+  for (;;) {
+    while (clog_rotate.retired_fd < 0 && !clog_rotate.stop)
+      pthread_cond_wait(&clog_rotate.park_cond, &clog_rotate.park_mutex);
+    int retired = clog_rotate.retired_fd;
+    bool stop = clog_rotate.stop;
+    clog_rotate.retired_fd = -1;
+    pthread_mutex_unlock(&clog_rotate.park_mutex);
+
+    if (retired >= 0 && from && to) {
+      close(retired);
+      clog_rotate_files(path, clog_rotate.keep, from, to, size);
+
+      /* The next switch only needs this descriptor, not the compression */
+      if (!stop) {
+        clog_rotate_name(from, size, path, 0, ".next");
+        int next = open(from, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND |
+                                  O_CLOEXEC, 0644);
+        CLOG_MUTEX_LOCK(&clog_mutex);
+        clog_rotate.next_fd = next;
+        CLOG_MUTEX_UNLOCK(&clog_mutex);
+      }
+
+      clog_rotate_name(from, size, path, 1, "");
+      int mode = atomic_load(&clog_rotate.compress);
+      if (clog_rotate.keep && mode == CLOG_COMPRESS_GZIP) {
+        const char *argv[] = {"gzip", "-f", "--", from, NULL};
+        clog_rotate_spawn(argv);
+      } else if (clog_rotate.keep && mode == CLOG_COMPRESS_ZSTD) {
+        const char *argv[] = {"zstd", "-q", "-f", "--rm", "--", from, NULL};
+        clog_rotate_spawn(argv);
+      }
+    } else if (retired >= 0) {
+      close(retired);
+    }
+
+    pthread_mutex_lock(&clog_rotate.park_mutex);
+    if (clog_rotate.stop && clog_rotate.retired_fd < 0)
+      break;
+  }
+  pthread_mutex_unlock(&clog_rotate.park_mutex);
+  free(from);
+  free(to);
+  return NULL;
+}
+
+/* Switches to the pre-opened successor once a trigger has fired; a file
+ * only grows past its limit while the thread is still preparing it. Needs
+ * clog_mutex */
+static void clog_rotate_account(size_t len) {
+  if (!clog_rotate.path || clog_rotate.active_fd < 0 ||
+      clog_output_fd != clog_rotate.active_fd)
+    return;
+
+  time_t now = 0;
+  bool due = clog_rotate.max_bytes && clog_rotate.written &&
+             clog_rotate.written + len > clog_rotate.max_bytes;
+  if (!due && clog_rotate.deadline) {
+    now = time(NULL);
+    due = now >= clog_rotate.deadline;
+  }
+  if (due && clog_rotate.next_fd >= 0) {
+    int retired = clog_rotate.active_fd;
+    clog_rotate.active_fd = clog_rotate.next_fd;
+    clog_output_fd = clog_rotate.next_fd;
+    clog_rotate.next_fd = -1;
+    clog_rotate.written = 0;
+    if (clog_rotate.deadline)
+      clog_rotate.deadline =
+          clog_rotate_deadline(now ? now : time(NULL), clog_rotate.every);
+
+    pthread_mutex_lock(&clog_rotate.park_mutex);
+    clog_rotate.retired_fd = retired;
+    pthread_cond_signal(&clog_rotate.park_cond);
+    pthread_mutex_unlock(&clog_rotate.park_mutex);
+  }
+  clog_rotate.written += len;
+}
+
+static void clog_rotate_stop(void) {
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  if (!clog_rotate.path) {
+    CLOG_MUTEX_UNLOCK(&clog_mutex);
+    return;
+  }
+  clog_flush_output();
+  if (clog_output_fd == clog_rotate.active_fd)
+    clog_output_fd = -1;
+  int active = clog_rotate.active_fd;
+  clog_rotate.active_fd = -1;
+  CLOG_MUTEX_UNLOCK(&clog_mutex);
+
+  /* Let a pending rotation finish its renames and compression */
+  pthread_mutex_lock(&clog_rotate.park_mutex);
+  clog_rotate.stop = true;
+  pthread_cond_signal(&clog_rotate.park_cond);
+  pthread_mutex_unlock(&clog_rotate.park_mutex);
+  pthread_join(clog_rotate.thread, NULL);
+
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  char *path = clog_rotate.path;
+  int next = clog_rotate.next_fd;
+  clog_rotate.path = NULL;
+  clog_rotate.next_fd = -1;
+  CLOG_MUTEX_UNLOCK(&clog_mutex);
+
+  if (next >= 0) {
+    size_t size = strlen(path) + sizeof(".next");
+    char *name = (char *)malloc(size);
+    close(next);
+    if (name) {
+      clog_rotate_name(name, size, path, 0, ".next");
+      remove(name);
+      free(name);
+    }
+  }
+  close(active);
+  free(path);
+  pthread_mutex_destroy(&clog_rotate.park_mutex);
+  pthread_cond_destroy(&clog_rotate.park_cond);
+}
+#endif
+
+CLOG_API bool clog_set_output_rotating(const char *path, size_t max_bytes,
+                                       clog_rotate_t every,
+                                       unsigned int keep) {
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+#if CLOG_HAS_ROTATE
+  clog_flush();
+  clog_rotate_stop();
+  if (!path)
+    return true;
+
+  size_t len = strlen(path);
+  char *copy = (char *)malloc(len + 1);
+  char *next_name = (char *)malloc(len + sizeof(".next"));
+  if (!copy || !next_name) {
+    free(copy);
+    free(next_name);
+    return false;
+  }
+  memcpy(copy, path, len + 1);
+  clog_rotate_name(next_name, len + sizeof(".next"), path, 0, ".next");
+
+  struct stat st;
+  int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  int next = open(next_name, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND |
+                                 O_CLOEXEC, 0644);
+  if (fd < 0 || next < 0 || fstat(fd, &st) != 0) {
+    if (fd >= 0)
+      close(fd);
+    if (next >= 0) {
+      close(next);
+      remove(next_name);
+    }
+    free(copy);
+    free(next_name);
+    return false;
+  }
+  free(next_name);
+
+  clog_rotate.path = copy;
+  clog_rotate.max_bytes = max_bytes;
+  clog_rotate.every = every;
+  clog_rotate.keep = keep;
+  clog_rotate.written = (size_t)st.st_size;
+  clog_rotate.deadline =
+      every == CLOG_ROTATE_NEVER ? 0 : clog_rotate_deadline(time(NULL), every);
+  clog_rotate.active_fd = -1;
+  clog_rotate.next_fd = next;
+  clog_rotate.retired_fd = -1;
+  clog_rotate.stop = false;
+  pthread_mutex_init(&clog_rotate.park_mutex, NULL);
+  pthread_cond_init(&clog_rotate.park_cond, NULL);
+  if (pthread_create(&clog_rotate.thread, NULL, clog_rotate_thread, NULL) !=
+      0) {
+    close(fd);
+    close(next);
+    clog_rotate.path = NULL;
+    clog_rotate.next_fd = -1;
+    free(copy);
+    return false;
+  }
+
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  clog_flush_output();
+  clog_mmap_close();
+  clog_rotate.active_fd = fd;
+  clog_output_fd = fd;
+  CLOG_MUTEX_UNLOCK(&clog_mutex);
+  return true;
+#else
+  (void)max_bytes;
+  (void)every;
+  (void)keep;
+  return !path;
+#endif
+}
+
+CLOG_API void clog_set_rotate_compress(clog_compress_t mode) {
+#if CLOG_HAS_ROTATE
+  atomic_store(&clog_rotate.compress, (int)mode);
+#else
+  (void)mode;
+#endif
+}
+
+#ifdef CLOG_STATS
+/* Accounts one write of len bytes that began at start */
+static void clog_stat_write(size_t len, bool ok, uint64_t start) {
+  clog_stat_add(CLOG_STAT_WRITES, 1);
+  clog_stat_add(CLOG_STAT_WRITE_NS, clog_now_ns() - start);
+  if (ok)
+    clog_stat_add(CLOG_STAT_BYTES, len);
+  else
+    clog_stat_add(CLOG_STAT_WRITE_ERRORS, 1);
+}
+#endif
+
+/* Body of clog_safe_write; returns false if the write failed */
+static bool clog_output_write(const char *str, size_t len) {
+#if CLOG_POSIX
+  if (atomic_load_explicit(&clog_mmap_current, memory_order_relaxed) &&
+      clog_mmap_write(str, len, true))
+    return true;
+#endif
+#if CLOG_HAS_ROTATE
+  clog_rotate_account(len);
+#endif
+  if (clog_output_fd >= 0)
+    return clog_fd_write(clog_output_fd, str, len);
+
+  FILE *output = clog_output ? clog_output : stdout;
+#if CLOG_WINDOWS
+  if (clog_is_console_output(output)) {
+    int wlen = MultiByteToWideChar(CP_UTF8, 0, str, len, NULL, 0);
+    if (wlen > 0) {
+      wchar_t *wstr = malloc((wlen + 1) * sizeof(wchar_t));
+      if (wstr) {
+        MultiByteToWideChar(CP_UTF8, 0, str, len, wstr, wlen);
+        wstr[wlen] = L'\0';
+        int n = fwprintf(output, L"%s", wstr);
+        free(wstr);
+        return n >= 0;
+      }
+    }
+  }
+#endif
+  return fwrite(str, 1, len, output) == len;
+}
+
+CLOG_API void clog_safe_write(const char *str, size_t len) {
+#ifdef CLOG_STATS
+  uint64_t start = clog_now_ns();
+  bool ok = clog_output_write(str, len);
+  clog_stat_write(len, ok, start);
+#else
+  clog_output_write(str, len);
+#endif
+}
+
+CLOG_API void clog_signal_log(const char *message) {
+#if CLOG_POSIX
+  size_t len = strlen(message);
+  write(STDERR_FILENO, message, len);
+  write(STDERR_FILENO, "\n", 1);
+#else /* CLOG_WINDOWS */
+  size_t len = strlen(message);
+  int wlen = MultiByteToWideChar(CP_UTF8, 0, message, len, NULL, 0);
+  if (wlen > 0) {
+    wchar_t *wstr = malloc((wlen + 1) * sizeof(wchar_t));
+    if (wstr) {
+      MultiByteToWideChar(CP_UTF8, 0, message, len, wstr, wlen);
+      wstr[wlen] = L'\0';
+      fwprintf(stderr, L"%s\n", wstr);
+      free(wstr);
+    } else {
+      _write(_fileno(stderr), message, len);
+      _write(_fileno(stderr), "\n", 1);
+    }
+  } else {
+    _write(_fileno(stderr), message, len);
+    _write(_fileno(stderr), "\n", 1);
+  }
+#endif
+}
+
+CLOG_API size_t clog_safe_strlen(const char *str, size_t max_len) {
+  if (!str)
+    return 0;
+  size_t len = 0;
+  while (len < max_len && str[len] != '\0') {
+    len++;
+  }
+  return len;
+}
+
+CLOG_API void clog_safe_strcpy(char *dest, const char *src, size_t dest_size) {
+  if (!dest || dest_size == 0)
+    return;
+  if (!src) {
+    dest[0] = '\0';
+    return;
+  }
+
+  size_t i = 0;
+  while (i < dest_size - 1 && src[i] != '\0') {
+    dest[i] = src[i];
+    i++;
+  }
+  dest[i] = '\0';
+}
+
+CLOG_API void clog_safe_strcat(char *dest, const char *src, size_t dest_size) {
+  if (!dest || !src || dest_size == 0)
+    return;
+
+  size_t dest_len = clog_safe_strlen(dest, dest_size);
+  if (dest_len >= dest_size - 1)
+    return;
+
+  size_t remaining = dest_size - dest_len - 1;
+  size_t i = 0;
+
+  while (i < remaining && src[i] != '\0') {
+    dest[dest_len + i] = src[i];
+    i++;
+  }
+  dest[dest_len + i] = '\0';
+}
+
+static const char *clog_basename(const char *path) {
+  if (!path)
+    return "unknown";
+
+  const char *filename = path;
+  const char *p = path;
+
+  while (*p) {
+    if (*p == '/' || *p == '\\') {
+      filename = p + 1;
+    }
+    p++;
+  }
+
+  return filename;
+}
+
+static bool clog_should_use_colors(void) {
+  FILE *output = clog_output ? clog_output : stdout;
 
   switch (clog_color_mode) {
   case CLOG_COLOR_NEVER:
     return false;
-  case CLOG_COLOR_ALWAYS:
-  case CLOG_COLOR_ANSI:
-  case CLOG_COLOR_WIN32:
+  case CLOG_COLOR_ALWAYS:
+  case CLOG_COLOR_ANSI:
+  case CLOG_COLOR_WIN32:
+    return true;
+  case CLOG_COLOR_AUTO:
+  default:
+    if (atomic_load_explicit(&clog_mmap_current, memory_order_relaxed))
+      return false;
+#if CLOG_WINDOWS
+    return clog_output_fd >= 0 ? clog_is_console_fd(clog_output_fd)
+                               : clog_is_console_output(output);
+#else
+    return isatty(clog_output_fd >= 0 ? clog_output_fd : fileno(output));
+#endif
+  }
+}
+
+static bool clog_use_ansi_colors(void) {
+  if (!clog_should_use_colors())
+    return false;
+
+  switch (clog_color_mode) {
+  case CLOG_COLOR_ANSI:
+    return true;
+  case CLOG_COLOR_WIN32:
+    return false;
+  case CLOG_COLOR_AUTO:
+  case CLOG_COLOR_ALWAYS:
+  default:
+#if CLOG_WINDOWS
+    return true;
+#else
+    return true;
+#endif
+  }
+}
+
+static size_t clog_append(char *dst, size_t size, size_t len,
+                          const char *src, size_t n) {
+  if (len + 1 >= size)
+    return len;
+  if (n > size - len - 1)
+    n = size - len - 1;
+  memcpy(dst + len, src, n);
+  return len + n;
+}
+
+static size_t clog_append_str(char *dst, size_t size, size_t len,
+                              const char *src) {
+  return clog_append(dst, size, len, src, strlen(src));
+}
+
+/* Renders value right-aligned in width, padded with pad */
+static size_t clog_signal_put_number(char *dst, size_t cap, size_t len,
+                                     unsigned long long value, bool negative,
+                                     unsigned int base, bool upper, int width,
+                                     char pad) {
+  const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  char tmp[24];
+  size_t n = 0;
+  do {
+    tmp[n++] = digits[value % base];
+    value /= base;
+  } while (value);
+
+  size_t used = n + (negative ? 1 : 0);
+  if (negative && pad == '0' && len < cap)
+    dst[len++] = '-';
+  for (; (int)used < width && len < cap; used++)
+    dst[len++] = pad;
+  if (negative && pad != '0' && len < cap)
+    dst[len++] = '-';
+  while (n > 0 && len < cap)
+    dst[len++] = tmp[--n];
+  return len;
+}
+
+/* printf subset safe in signal handlers: %d %i %u %x %X %p %s %c %%, the
+ * l, ll and z length modifiers, and a width with an optional 0 flag */
+static size_t clog_signal_vformat(char *dst, size_t cap, size_t len,
+                                  const char *format, va_list args) {
+  for (const char *p = format; *p && len < cap; p++) {
+    if (*p != '%') {
+      dst[len++] = *p;
+      continue;
+    }
+    const char *spec = p++;
+    char pad = ' ';
+    int width = 0;
+    int longs = 0;
+    bool size = false;
+    if (*p == '0') {
+      pad = '0';
+      p++;
+    }
+    while (*p >= '0' && *p <= '9')
+      width = width * 10 + (*p++ - '0');
+    while (*p == 'l') {
+      longs++;
+      p++;
+    }
+    if (*p == 'z') {
+      size = true;
+      p++;
+    }
+
+    switch (*p) {
+    case 'd':
+    case 'i': {
+      long long v = longs >= 2  ? va_arg(args, long long)
+                    : longs     ? va_arg(args, long)
+                    : size      ? (long long)va_arg(args, ptrdiff_t)
+                                : va_arg(args, int);
+      unsigned long long mag =
+          v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+      len = clog_signal_put_number(dst, cap, len, mag, v < 0, 10, false,
+                                   width, pad);
+      break;
+    }
+    case 'u':
+    case 'x':
+    case 'X': {
+      unsigned long long v = longs >= 2 ? va_arg(args, unsigned long long)
+                             : longs    ? va_arg(args, unsigned long)
+                             : size     ? va_arg(args, size_t)
+                                        : va_arg(args, unsigned int);
+      len = clog_signal_put_number(dst, cap, len, v, false,
+                                   *p == 'u' ? 10 : 16, *p == 'X', width, pad);
+      break;
+    }
+    case 'p': {
+      uintptr_t v = (uintptr_t)va_arg(args, void *);
+      len = clog_append(dst, cap, len, "0x", 2);
+      len = clog_signal_put_number(dst, cap, len, v, false, 16, false, 0, ' ');
+      break;
+    }
+    case 's': {
+      const char *str = va_arg(args, const char *);
+      len = clog_append_str(dst, cap, len, str ? str : "(null)");
+      break;
+    }
+    case 'c':
+      dst[len++] = (char)va_arg(args, int);
+      break;
+    case '%':
+      dst[len++] = '%';
+      break;
+    default:
+      /* Unsupported conversions are copied through unchanged */
+      len = clog_append(dst, cap, len, spec, (size_t)(p - spec) + (*p != 0));
+      if (!*p)
+        return len;
+      break;
+    }
+  }
+  return len;
+}
+
+/* clog_signal_vformat into dst, NUL-terminated; returns the length */
+static size_t clog_signal_format(char *dst, size_t size, const char *format,
+                                 ...) ATTRIBUTE_PRINTF(3, 4);
+static size_t clog_signal_format(char *dst, size_t size, const char *format,
+                                 ...) {
+  va_list args;
+  va_start(args, format);
+  size_t len = clog_signal_vformat(dst, size - 1, 0, format, args);
+  va_end(args);
+  dst[len] = '\0';
+  return len;
+}
+
+/* clog_format_timespec without the per-thread cache or localtime: the
+ * offset is the one last computed by clog_utc_offset */
+static size_t clog_signal_time(char *dst, const struct timespec *ts) {
+  static const char fallback[] = "0000-00-00 00:00:00";
+  bool iso = atomic_load_explicit(&clog_time_format, memory_order_relaxed) ==
+             CLOG_TIME_FORMAT_ISO8601;
+  bool utc = atomic_load_explicit(&clog_time_utc, memory_order_relaxed);
+  long offset =
+      utc ? 0 : atomic_load_explicit(&clog_tz_offset, memory_order_relaxed);
+  char *p = clog_put_datetime(dst, (long long)ts->tv_sec + offset, iso);
+  if (!p) {
+    memcpy(dst, fallback, sizeof(fallback) - 1);
+    return sizeof(fallback) - 1;
+  }
+  p = clog_put_fraction(
+      p, ts->tv_nsec,
+      atomic_load_explicit(&clog_time_precision, memory_order_relaxed));
+  p = clog_put_zone(p, offset, iso, utc);
+  return (size_t)(p - dst);
+}
+
+/* Descriptor the main output writes to, or stderr when the output is not a
+ * plain byte stream (binary mode, memory-mapped sink) */
+static int clog_signal_fd(void) {
+#if CLOG_POSIX
+  if (atomic_load_explicit(&clog_mmap_current, memory_order_relaxed))
+    return STDERR_FILENO;
+#endif
+  if (atomic_load_explicit(&clog_binary_output, memory_order_relaxed))
+    return 2;
+  int fd = atomic_load_explicit(&clog_output_fd, memory_order_relaxed);
+  return fd >= 0 ? fd
+                 : atomic_load_explicit(&clog_output_fileno,
+                                        memory_order_relaxed);
+}
+
+CLOG_API void clog_signal_logf(clog_level_t level, const char *format, ...) {
+  char line[CLOG_MAX_TIME_SIZE + CLOG_MAX_MESSAGE_SIZE + 16];
+  /* Keep one byte for the newline */
+  size_t cap = sizeof(line) - 1;
+  size_t len = 0;
+
+  if ((int)level <
+      atomic_load_explicit(&clog_output_level, memory_order_relaxed))
+    return;
+
+  if (atomic_load_explicit(&clog_show_timestamp, memory_order_relaxed)) {
+    struct timespec ts;
+    if (clog_clock_now(&ts)) {
+      len = clog_signal_time(line, &ts);
+      line[len++] = ' ';
+    }
+  }
+  line[len++] = '[';
+  len = clog_append_str(line, cap, len, clog_level_string(level));
+  len = clog_append(line, cap, len, "] ", 2);
+
+  va_list args;
+  va_start(args, format);
+  len = clog_signal_vformat(line, cap, len, format, args);
+  va_end(args);
+  line[len++] = '\n';
+  clog_fd_write(clog_signal_fd(), line, len);
+}
+
+/* Integer to text, table-driven: writes the digits of v so they end just
+ * before end, and returns where they start */
+static char *clog_put_u64_rev(char *end, unsigned long long v) {
+  while (v >= 100) {
+    unsigned int pair = (unsigned int)(v % 100);
+    v /= 100;
+    end -= 2;
+    memcpy(end, &clog_digit_pairs[pair * 2], 2);
+  }
+  if (v >= 10) {
+    end -= 2;
+    memcpy(end, &clog_digit_pairs[v * 2], 2);
+  } else {
+    *--end = (char)('0' + v);
+  }
+  return end;
+}
+
+static size_t clog_append_int(char *dst, size_t size, size_t len,
+                              long long value) {
+  char buf[24];
+  char *end = buf + sizeof(buf);
+  unsigned long long mag = value < 0 ? 0ULL - (unsigned long long)value
+                                     : (unsigned long long)value;
+  char *start = clog_put_u64_rev(end, mag);
+  if (value < 0)
+    *--start = '-';
+  return clog_append(dst, size, len, start, (size_t)(end - start));
+}
+
+#if CLOG_FAST_FORMAT
+/* Output cursor of clog_vformat: counts every byte like vsnprintf, but
+ * stores only the first cap */
+typedef struct {
+  char *dst;
+  size_t cap;
+  size_t pos;
+} clog_fmt_out_t;
+
+static inline void clog_fmt_put(clog_fmt_out_t *out, const char *src,
+                                size_t n) {
+  if (n && out->pos < out->cap) {
+    size_t room = out->cap - out->pos;
+    memcpy(out->dst + out->pos, src, n < room ? n : room);
+  }
+  out->pos += n;
+}
+
+static inline void clog_fmt_fill(clog_fmt_out_t *out, char c, size_t n) {
+  if (n && out->pos < out->cap) {
+    size_t room = out->cap - out->pos;
+    memset(out->dst + out->pos, c, n < room ? n : room);
+  }
+  out->pos += n;
+}
+
+/* Emits a sign or 0x prefix (at most two characters), leading zeros and
+ * body, padded to width */
+static void clog_fmt_field(clog_fmt_out_t *out, const char *prefix,
+                           const char *body, size_t body_len, size_t zeros,
+                           size_t width, bool left, bool zero_pad) {
+  size_t prefix_len = prefix[0] ? (prefix[1] ? 2 : 1) : 0;
+  size_t total = prefix_len + zeros + body_len;
+  size_t pad = width > total ? width - total : 0;
+  if (pad && !left && !zero_pad)
+    clog_fmt_fill(out, ' ', pad);
+  clog_fmt_put(out, prefix, prefix_len);
+  clog_fmt_fill(out, '0', zeros + (!left && zero_pad ? pad : 0));
+  clog_fmt_put(out, body, body_len);
+  if (pad && left)
+    clog_fmt_fill(out, ' ', pad);
+}
+
+static void clog_fmt_int(clog_fmt_out_t *out, unsigned long long v,
+                         unsigned int base, bool upper, const char *prefix,
+                         size_t width, int prec, bool left, bool zero) {
+  const char *digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+  char buf[24];
+  char *end = buf + sizeof(buf);
+  char *start = end;
+  if (base == 10) {
+    if (prec != 0 || v != 0)
+      start = clog_put_u64_rev(end, v);
+  } else if (prec != 0 || v != 0) {
+    do {
+      *--start = digits[v & 15];
+      v >>= 4;
+    } while (v);
+  }
+  size_t n = (size_t)(end - start);
+  size_t zeros = prec > 0 && (size_t)prec > n ? (size_t)prec - n : 0;
+  clog_fmt_field(out, prefix, start, n, zeros, width, left,
+                 zero && prec < 0);
+}
+
+#if defined(__SIZEOF_INT128__)
+/* Spelled through __extension__ so -Wpedantic builds stay quiet */
+__extension__ typedef unsigned __int128 clog_u128_t;
+
+/* %f with correct rounding (half to even, as libc in the default rounding
+ * mode) for |value| < 2^127 and up to 19 decimals; anything else is left
+ * to vsnprintf by returning false */
+static bool clog_fmt_double(clog_fmt_out_t *out, double value, size_t width,
+                            int prec, bool left, bool zero,
+                            const char *sign) {
+  static const uint64_t pow10[20] = {1ULL,
+                                     10ULL,
+                                     100ULL,
+                                     1000ULL,
+                                     10000ULL,
+                                     100000ULL,
+                                     1000000ULL,
+                                     10000000ULL,
+                                     100000000ULL,
+                                     1000000000ULL,
+                                     10000000000ULL,
+                                     100000000000ULL,
+                                     1000000000000ULL,
+                                     10000000000000ULL,
+                                     100000000000000ULL,
+                                     1000000000000000ULL,
+                                     10000000000000000ULL,
+                                     100000000000000000ULL,
+                                     1000000000000000000ULL,
+                                     10000000000000000000ULL};
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  int biased = (int)((bits >> 52) & 0x7ff);
+  uint64_t mant = bits & ((1ULL << 52) - 1);
+  if (biased == 0x7ff || prec > 19)
+    return false;
+  int e = biased ? biased - 1075 : -1074;
+  if (biased)
+    mant |= 1ULL << 52;
+
+  /* value = mant * 2^e; scale by 10^prec and round to an integer */
+  clog_u128_t q;
+  if (e >= 0) {
+    if (e > 74)
+      return false;
+    q = ((clog_u128_t)mant << e) * pow10[prec];
+    if (prec && q / pow10[prec] != (clog_u128_t)mant << e)
+      return false;
+  } else if (-e >= 118) {
+    /* mant * 10^19 < 2^117: below half of the last digit */
+    q = 0;
+  } else {
+    int k = -e;
+    clog_u128_t scaled = (clog_u128_t)mant * pow10[prec];
+    q = scaled >> k;
+    clog_u128_t rem = scaled - (q << k);
+    clog_u128_t half = (clog_u128_t)1 << (k - 1);
+    if (rem > half || (rem == half && (q & 1)))
+      q++;
+  }
+
+  clog_u128_t ip;
+  uint64_t frac;
+  if ((q >> 64) == 0) {
+    ip = (uint64_t)q / pow10[prec];
+    frac = (uint64_t)q % pow10[prec];
+  } else {
+    ip = q / pow10[prec];
+    frac = (uint64_t)(q - ip * pow10[prec]);
+  }
+
+  char buf[64];
+  char *end = buf + sizeof(buf);
+  char *start = end;
+  if (prec > 0) {
+    for (int i = 0; i < prec; i++) {
+      *--start = (char)('0' + frac % 10);
+      frac /= 10;
+    }
+    *--start = '.';
+  }
+  while (ip > UINT64_MAX) {
+    uint64_t chunk = (uint64_t)(ip % pow10[19]);
+    ip /= pow10[19];
+    for (int i = 0; i < 19; i++) {
+      *--start = (char)('0' + chunk % 10);
+      chunk /= 10;
+    }
+  }
+  start = clog_put_u64_rev(start, (uint64_t)ip);
+  clog_fmt_field(out, (bits >> 63) ? "-" : sign, start,
+                 (size_t)(end - start), 0, width, left, zero);
+  return true;
+}
+#endif
+
+/* vsnprintf replacement for the common conversions: %d %i %u %x %X %c %s
+ * %p %f %% with the - 0 + space flags, width, precision (both may be *)
+ * and the hh h l ll z j t length modifiers. Anything else, including
+ * positional arguments, %n and NULL strings, formats the whole message
+ * with vsnprintf, so the output always matches libc */
+static int clog_vformat(char *dst, size_t size, const char *format,
+                        va_list args) {
+  clog_fmt_out_t out = {dst, size ? size - 1 : 0, 0};
+  va_list ap;
+  va_copy(ap, args);
+
+  const char *p = format;
+  for (;;) {
+    const char *literal = p;
+    p = strchr(p, '%');
+    if (!p)
+      p = literal + strlen(literal);
+    if (p > literal)
+      clog_fmt_put(&out, literal, (size_t)(p - literal));
+    if (!*p)
+      break;
+    const char *spec = p++;
+
+    bool left = false, zero = false, plus = false, space = false;
+    for (;; p++) {
+      if (*p == '-')
+        left = true;
+      else if (*p == '0')
+        zero = true;
+      else if (*p == '+')
+        plus = true;
+      else if (*p == ' ')
+        space = true;
+      else
+        break;
+    }
+
+    size_t width = 0;
+    if (*p == '*') {
+      int w = va_arg(ap, int);
+      if (w < 0) {
+        left = true;
+        width = 0U - (unsigned int)w;
+      } else {
+        width = (size_t)w;
+      }
+      p++;
+    } else {
+      while (*p >= '0' && *p <= '9')
+        width = width * 10 + (size_t)(*p++ - '0');
+    }
+
+    int prec = -1;
+    if (*p == '.') {
+      p++;
+      if (*p == '*') {
+        int v = va_arg(ap, int);
+        prec = v < 0 ? -1 : v;
+        p++;
+      } else {
+        prec = 0;
+        while (*p >= '0' && *p <= '9' && prec < 100000)
+          prec = prec * 10 + (*p++ - '0');
+      }
+    }
+    /* Positional arguments and absurd sizes go to libc */
+    if (*p == '$' || (*p >= '0' && *p <= '9') || width > 100000)
+      goto fallback;
+
+    char length = 0;
+    if (*p == 'h' || *p == 'l') {
+      length = *p++;
+      if (*p == length) {
+        length = length == 'h' ? 'H' : 'q';
+        p++;
+      }
+    } else if (*p == 'z' || *p == 'j' || *p == 't') {
+      length = *p++;
+    }
+
+    const char *sign = plus ? "+" : space ? " " : "";
+    switch (*p++) {
+    case 'd':
+    case 'i': {
+      long long v;
+      switch (length) {
+      case 'H':
+        v = (signed char)va_arg(ap, int);
+        break;
+      case 'h':
+        v = (short)va_arg(ap, int);
+        break;
+      case 'l':
+        v = va_arg(ap, long);
+        break;
+      case 'q':
+        v = va_arg(ap, long long);
+        break;
+      case 'z':
+      case 't':
+        v = va_arg(ap, ptrdiff_t);
+        break;
+      case 'j':
+        v = va_arg(ap, intmax_t);
+        break;
+      default:
+        v = va_arg(ap, int);
+        break;
+      }
+      unsigned long long mag =
+          v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+      clog_fmt_int(&out, mag, 10, false, v < 0 ? "-" : sign, width, prec,
+                   left, zero);
+      break;
+    }
+    case 'u':
+    case 'x':
+    case 'X': {
+      unsigned long long v;
+      switch (length) {
+      case 'H':
+        v = (unsigned char)va_arg(ap, unsigned int);
+        break;
+      case 'h':
+        v = (unsigned short)va_arg(ap, unsigned int);
+        break;
+      case 'l':
+        v = va_arg(ap, unsigned long);
+        break;
+      case 'q':
+        v = va_arg(ap, unsigned long long);
+        break;
+      case 'z':
+      case 't':
+        v = va_arg(ap, size_t);
+        break;
+      case 'j':
+        v = va_arg(ap, uintmax_t);
+        break;
+      default:
+        v = va_arg(ap, unsigned int);
+        break;
+      }
+      clog_fmt_int(&out, v, p[-1] == 'u' ? 10 : 16, p[-1] == 'X', "", width,
+                   prec, left, zero);
+      break;
+    }
+    case 'c': {
+      if (length || zero)
+        goto fallback;
+      char c = (char)va_arg(ap, int);
+      clog_fmt_field(&out, "", &c, 1, 0, width, left, false);
+      break;
+    }
+    case 's': {
+      const char *s = va_arg(ap, const char *);
+      if (length || zero || !s)
+        goto fallback;
+      size_t n;
+      if (prec < 0) {
+        n = strlen(s);
+      } else {
+        const char *nul = (const char *)memchr(s, '\0', (size_t)prec);
+        n = nul ? (size_t)(nul - s) : (size_t)prec;
+      }
+      clog_fmt_field(&out, "", s, n, 0, width, left, false);
+      break;
+    }
+    case 'p': {
+      void *ptr = va_arg(ap, void *);
+      if (length || zero || plus || space || prec >= 0 || !ptr)
+        goto fallback;
+      clog_fmt_int(&out, (uintptr_t)ptr, 16, false, "0x", width, -1, left,
+                   false);
+      break;
+    }
+    case 'f': {
+      double v = va_arg(ap, double);
+#if defined(__SIZEOF_INT128__)
+      if ((length && length != 'l') ||
+          !clog_fmt_double(&out, v, width, prec < 0 ? 6 : prec, left, zero,
+                           sign))
+        goto fallback;
+#else
+      (void)v;
+      goto fallback;
+#endif
+      break;
+    }
+    case '%':
+      if (p - spec != 2)
+        goto fallback;
+      clog_fmt_put(&out, "%", 1);
+      break;
+    default:
+      goto fallback;
+    }
+  }
+
+  va_end(ap);
+  if (size)
+    dst[out.pos < out.cap ? out.pos : out.cap] = '\0';
+  return out.pos > INT_MAX ? -1 : (int)out.pos;
+
+fallback:
+  va_end(ap);
+  return vsnprintf(dst, size, format, args);
+}
+#else
+#define clog_vformat vsnprintf
+#endif
+
+/* Index of the lowest set bit of a nonzero mask */
+static inline unsigned int clog_ctz32(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned int)__builtin_ctz(mask);
+#elif defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return (unsigned int)index;
+#else
+  unsigned int index = 0;
+  while (!(mask & 1u)) {
+    mask >>= 1;
+    index++;
+  }
+  return index;
+#endif
+}
+
+/* Returns the offset of the first byte of s that a JSON string must escape
+ * (quote, backslash, control), or n if there is none. For logfmt the space
+ * and '=' also count, since they force a value to be quoted */
+static size_t clog_escape_scan(const char *s, size_t n, bool logfmt) {
+  const unsigned char extra = logfmt ? '=' : '"';
+  const unsigned char ctrl_max = logfmt ? 0x20 : 0x1F;
+  size_t i = 0;
+#if CLOG_SIMD_AVX2
+  {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i other = _mm256_set1_epi8((char)extra);
+    const __m256i ctrl = _mm256_set1_epi8((char)ctrl_max);
+    for (; i + 32 <= n; i += 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+      /* min(v, ctrl) == v is an unsigned v <= ctrl */
+      __m256i hit = _mm256_or_si256(
+          _mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+                          _mm256_cmpeq_epi8(v, backslash)),
+          _mm256_or_si256(_mm256_cmpeq_epi8(v, other),
+                          _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctrl), v)));
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit);
+      if (mask)
+        return i + clog_ctz32(mask);
+    }
+  }
+#endif
+#if CLOG_SIMD_SSE2
+  {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i other = _mm_set1_epi8((char)extra);
+    const __m128i ctrl = _mm_set1_epi8((char)ctrl_max);
+    for (; i + 16 <= n; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+      __m128i hit = _mm_or_si128(
+          _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+          _mm_or_si128(_mm_cmpeq_epi8(v, other),
+                       _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v)));
+      uint32_t mask = (uint32_t)_mm_movemask_epi8(hit);
+      if (mask)
+        return i + clog_ctz32(mask);
+    }
+  }
+#endif
+  for (; i < n; i++) {
+    unsigned char c = (unsigned char)s[i];
+    if (c <= ctrl_max || c == '"' || c == '\\' || c == extra)
+      return i;
+  }
+  return n;
+}
+
+/* Appends src with JSON string escapes, copying clean runs in bulk. Stops
+ * before an escape that does not fit, so no sequence is cut in half */
+static size_t clog_append_escaped(char *dst, size_t size, size_t len,
+                                  const char *src, size_t n) {
+  static const char hex[] = "0123456789abcdef";
+  size_t i = 0;
+  while (i < n) {
+    size_t run = clog_escape_scan(src + i, n - i, false);
+    size_t start = len;
+    len = clog_append(dst, size, len, src + i, run);
+    if (len - start < run)
+      return len;
+    i += run;
+    if (i == n)
+      break;
+
+    unsigned char c = (unsigned char)src[i++];
+    char esc[6] = {'\\', (char)c, 0, 0, 0, 0};
+    size_t esc_len = 2;
+    switch (c) {
+    case '"':
+    case '\\':
+      break;
+    case '\n':
+      esc[1] = 'n';
+      break;
+    case '\r':
+      esc[1] = 'r';
+      break;
+    case '\t':
+      esc[1] = 't';
+      break;
+    case '\b':
+      esc[1] = 'b';
+      break;
+    case '\f':
+      esc[1] = 'f';
+      break;
+    default:
+      memcpy(esc + 1, "u00", 3);
+      esc[4] = hex[c >> 4];
+      esc[5] = hex[c & 15];
+      esc_len = 6;
+      break;
+    }
+    if (len + esc_len + 1 > size)
+      return len;
+    len = clog_append(dst, size, len, esc, esc_len);
+  }
+  return len;
+}
+
+/* Appends src as a quoted, escaped string; writes nothing if even the
+ * quotes do not fit */
+static size_t clog_append_quoted(char *dst, size_t size, size_t len,
+                                 const char *src, size_t n) {
+  if (len + 3 > size)
+    return len;
+  dst[len++] = '"';
+  len = clog_append_escaped(dst, size - 1, len, src, n);
+  dst[len++] = '"';
+  return len;
+}
+
+/* Appends a logfmt value, quoting it only when it holds a space, '=', a
+ * quote, a backslash or a control byte */
+static size_t clog_append_logfmt(char *dst, size_t size, size_t len,
+                                 const char *src, size_t n) {
+  if (n && clog_escape_scan(src, n, true) == n)
+    return clog_append(dst, size, len, src, n);
+  return clog_append_quoted(dst, size, len, src, n);
+}
+
+/* Shortest of %.15g and %.17g that reads back as the same double */
+static size_t clog_format_double(char *dst, size_t size, double value) {
+  int n = snprintf(dst, size, "%.15g", value);
+  if (n > 0 && strtod(dst, NULL) != value)
+    n = snprintf(dst, size, "%.17g", value);
+  return n > 0 ? ((size_t)n < size ? (size_t)n : size - 1) : 0;
+}
+
+/* Appends ",\"key\":value" for JSON or " key=value" otherwise. A field that
+ * does not fit is left out entirely */
+static size_t clog_append_field(char *dst, size_t size, size_t len,
+                                const clog_field_t *field, bool json) {
+  size_t start = len;
+  const char *key = field->key ? field->key : "";
+  char num[32];
+  const char *value = num;
+  size_t n = 0;
+
+  if (json) {
+    len = clog_append(dst, size, len, ",", 1);
+    len = clog_append_quoted(dst, size, len, key, strlen(key));
+    len = clog_append(dst, size, len, ":", 1);
+  } else {
+    len = clog_append(dst, size, len, " ", 1);
+    /* Keys with spaces, '=' or quotes would split the pair */
+    len = clog_append_logfmt(dst, size, len, key, strlen(key));
+    len = clog_append(dst, size, len, "=", 1);
+  }
+
+  switch (field->type) {
+  case CLOG_FIELD_INT:
+    len = clog_append_int(dst, size, len, field->value.i);
+    return len + 2 > size ? start : len;
+  case CLOG_FIELD_DOUBLE:
+    if (field->value.d != field->value.d ||
+        field->value.d - field->value.d != 0) {
+      /* JSON has no literal for NaN or infinity */
+      value = json ? "null" : field->value.d != field->value.d ? "nan"
+              : field->value.d > 0                              ? "inf"
+                                                                : "-inf";
+      n = strlen(value);
+    } else {
+      n = clog_format_double(num, sizeof(num), field->value.d);
+    }
+    break;
+  case CLOG_FIELD_BOOL:
+    value = field->value.b ? "true" : "false";
+    n = strlen(value);
+    break;
+  case CLOG_FIELD_STRING:
+  default:
+    value = field->value.s;
+    if (!value) {
+      value = json ? "null" : "";
+      n = strlen(value);
+      break;
+    }
+    len = json ? clog_append_quoted(dst, size, len, value, strlen(value))
+               : clog_append_logfmt(dst, size, len, value, strlen(value));
+    return len + 2 > size ? start : len;
+  }
+
+  len = clog_append(dst, size, len, value, n);
+  return len + 2 > size ? start : len;
+}
+
+/* JSON lines and logfmt rendering behind clog_render */
+static size_t clog_format_structured(char *dst, size_t size, bool json,
+                                     clog_level_t level, const char *file,
+                                     int line, const char *func,
+                                     const clog_field_t *fields,
+                                     size_t nfields, const char *format,
+                                     va_list args, const struct timespec *when,
+                                     const clog_render_settings_t *settings) {
+  char message[CLOG_MAX_MESSAGE_SIZE];
+  char time_buf[CLOG_MAX_TIME_SIZE];
+  size_t len = 0;
+  /* Keep room for the newline and terminator, and for JSON the brace */
+  size_t cap = size - 1 - (json ? 1 : 0);
+
+  int n = clog_vformat(message, sizeof(message), format, args);
+  if (n > 0 && (size_t)n >= sizeof(message))
+    CLOG_STAT_TRUNCATED_MARK();
+  size_t message_len = n < 0 ? 0
+                       : (size_t)n < sizeof(message) ? (size_t)n
+                                                     : sizeof(message) - 1;
+
+  if (json)
+    len = clog_append(dst, cap, len, "{", 1);
+  if (settings ? settings->show_timestamp : clog_show_timestamp) {
+    size_t time_len =
+        when ? clog_format_timespec_as(when, time_buf, sizeof(time_buf),
+                                       settings)
+             : clog_format_time(time_buf, sizeof(time_buf));
+    if (json) {
+      len = clog_append_str(dst, cap, len, "\"ts\":");
+      len = clog_append_quoted(dst, cap, len, time_buf, time_len);
+      len = clog_append(dst, cap, len, ",", 1);
+    } else {
+      len = clog_append_str(dst, cap, len, "ts=");
+      len = clog_append_logfmt(dst, cap, len, time_buf, time_len);
+      len = clog_append(dst, cap, len, " ", 1);
+    }
+  }
+
+  len = clog_append_str(dst, cap, len, json ? "\"level\":\"" : "level=");
+  len = clog_append_str(dst, cap, len, clog_level_string(level));
+  len = clog_append_str(dst, cap, len, json ? "\",\"msg\":" : " msg=");
+  len = json ? clog_append_quoted(dst, cap, len, message, message_len)
+             : clog_append_logfmt(dst, cap, len, message, message_len);
+
+  if ((settings ? settings->show_location : clog_show_location) && file &&
+      line > 0 && func) {
+    const char *base = clog_basename(file);
+    clog_field_t location[3] = {clog_field_str("file", base),
+                                clog_field_int("line", line),
+                                clog_field_str("func", func)};
+    for (size_t i = 0; i < 3; i++)
+      len = clog_append_field(dst, cap, len, &location[i], json);
+  }
+  for (size_t i = 0; i < nfields; i++)
+    len = clog_append_field(dst, cap, len, &fields[i], json);
+
+  if (json)
+    dst[len++] = '}';
+  dst[len++] = '\n';
+  dst[len] = '\0';
+  return len;
+}
+
+/* Numeric id of the calling thread, shown in dump headers and patterns */
+static unsigned long clog_thread_id(void) {
+#if CLOG_WINDOWS
+  return (unsigned long)GetCurrentThreadId();
+#elif CLOG_HAS_SYSCALL
+  return (unsigned long)syscall(SYS_gettid);
+#else
+  return (unsigned long)(uintptr_t)pthread_self();
+#endif
+}
+
+/* Builder state of clog_pattern_compile for one variant */
+typedef struct {
+  clog_pattern_op_t *ops;
+  char *text;
+  size_t count;
+  size_t used;
+} clog_pattern_build_t;
+
+/* Appends literal text padded to op's width, extending the previous TEXT
+ * step when there is one */
+static bool clog_pattern_text(clog_pattern_build_t *b,
+                              const clog_pattern_op_t *op, const char *src,
+                              size_t n) {
+  size_t pad = op->width > n ? op->width - n : 0;
+  if (b->used + n + pad > CLOG_PATTERN_TEXT_SIZE)
+    return false;
+  char *dst = b->text + b->used;
+  memset(dst, ' ', pad);
+  memcpy(op->left ? dst : dst + pad, src, n);
+  if (op->left)
+    memset(dst + n, ' ', pad);
+  if (!b->count || b->ops[b->count - 1].kind != CLOG_PATTERN_TEXT) {
+    if (b->count == CLOG_PATTERN_MAX_OPS)
+      return false;
+    clog_pattern_op_t *text = &b->ops[b->count++];
+    memset(text, 0, sizeof(*text));
+    text->kind = CLOG_PATTERN_TEXT;
+    text->offset = (uint16_t)b->used;
+  }
+  b->ops[b->count - 1].len += (uint16_t)(n + pad);
+  b->used += n + pad;
+  return true;
+}
+
+/* Compiles pattern for one level and color setting */
+static bool clog_pattern_compile(clog_pattern_t *pattern, size_t variant,
+                                 const char *src) {
+  clog_level_t level = (clog_level_t)(variant / 2);
+  bool ansi = variant % 2;
+  bool message = false;
+  clog_pattern_build_t b = {pattern->ops[variant], pattern->text[variant], 0,
+                            0};
+
+  while (*src) {
+    clog_pattern_op_t op;
+    memset(&op, 0, sizeof(op));
+    const char *lit = src;
+    size_t n = 1;
+    if (*src++ == '%') {
+      if (*src == '-') {
+        op.left = 1;
+        src++;
+      }
+      while (*src >= '0' && *src <= '9') {
+        op.width = (uint16_t)(op.width * 10 + (*src++ - '0'));
+        if (op.width > CLOG_PATTERN_TEXT_SIZE)
+          return false;
+      }
+      lit = NULL;
+      switch (*src++) {
+      case '%':
+        lit = "%";
+        break;
+      case 'L':
+        lit = clog_level_string(level);
+        n = strlen(lit);
+        break;
+      case 'C':
+        lit = ansi ? clog_level_color_ansi(level) : "";
+        n = strlen(lit);
+        break;
+      case 'R':
+        lit = ansi ? CLOG_RESET : "";
+        n = strlen(lit);
+        break;
+      case 'T':
+        op.kind = CLOG_PATTERN_TIME;
+        break;
+      case 'm':
+        /* The arguments can only be consumed once */
+        if (message)
+          return false;
+        message = true;
+        op.kind = CLOG_PATTERN_MESSAGE;
+        break;
+      case 'f':
+        op.kind = CLOG_PATTERN_FILE;
+        break;
+      case 'l':
+        op.kind = CLOG_PATTERN_LINE;
+        break;
+      case 'F':
+        op.kind = CLOG_PATTERN_FUNC;
+        break;
+      case 't':
+        op.kind = CLOG_PATTERN_THREAD;
+        break;
+      case 'P':
+        op.kind = CLOG_PATTERN_PID;
+        break;
+      case 'e':
+        op.kind = CLOG_PATTERN_ELAPSED;
+        break;
+      case 'c':
+        op.kind = CLOG_PATTERN_CATEGORY;
+        break;
+      default:
+        return false;
+      }
+    }
+    if (lit) {
+      if (!clog_pattern_text(&b, &op, lit, n))
+        return false;
+    } else {
+      if (b.count == CLOG_PATTERN_MAX_OPS)
+        return false;
+      b.ops[b.count++] = op;
+    }
+  }
+  pattern->count[variant] = (uint8_t)b.count;
+  return true;
+}
+
+CLOG_API bool clog_set_pattern(const char *pattern) {
+  clog_pattern_t *compiled = NULL;
+  if (pattern) {
+    compiled = (clog_pattern_t *)calloc(1, sizeof(*compiled));
+    if (!compiled)
+      return false;
+    for (size_t v = 0; v < CLOG_PATTERN_VARIANTS; v++) {
+      if (!clog_pattern_compile(compiled, v, pattern)) {
+        free(compiled);
+        return false;
+      }
+    }
+  }
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  clog_pattern_t *old = atomic_exchange(&clog_pattern, compiled);
+  if (old) {
+    old->retired = clog_pattern_retired;
+    clog_pattern_retired = old;
+  }
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+  return true;
+}
+
+/* Pads the field at dst[start, len) to op's width */
+static size_t clog_pattern_pad(char *dst, size_t size, size_t start,
+                               size_t len, const clog_pattern_op_t *op) {
+  size_t n = len - start;
+  if (n >= op->width || len + 1 >= size)
+    return len;
+  size_t pad = op->width - n;
+  if (pad > size - len - 1)
+    pad = size - len - 1;
+  if (!op->left)
+    memmove(dst + start + pad, dst + start, n);
+  memset(op->left ? dst + len : dst + start, ' ', pad);
+  return len + pad;
+}
+
+/* Text layout of clog_render when a pattern is set: runs the steps
+ * compiled for the record's level and color setting */
+static size_t clog_pattern_render(const clog_pattern_t *pattern, char *dst,
+                                  size_t size, clog_level_t level,
+                                  const char *file, int line,
+                                  const char *func,
+                                  const clog_field_t *fields, size_t nfields,
+                                  const char *format, va_list args,
+                                  bool use_ansi, const struct timespec *when,
+                                  const clog_render_settings_t *settings) {
+  size_t variant = ((unsigned int)level <= CLOG_FATAL ? (size_t)level
+                                                      : CLOG_FATAL + 1) *
+                       2 +
+                   (use_ansi ? 1 : 0);
+  const clog_pattern_op_t *op = pattern->ops[variant];
+  const clog_pattern_op_t *end = op + pattern->count[variant];
+  const char *text = pattern->text[variant];
+  size_t len = 0;
+  /* Keep one byte for the trailing newline and one for the terminator */
+  size_t cap = size - 1;
+
+  for (; op < end; op++) {
+    size_t start = len;
+    switch (op->kind) {
+    case CLOG_PATTERN_TEXT:
+      len = clog_append(dst, cap, len, text + op->offset, op->len);
+      continue;
+    case CLOG_PATTERN_TIME: {
+      char time_buf[CLOG_MAX_TIME_SIZE];
+      size_t time_len =
+          when ? clog_format_timespec_as(when, time_buf, sizeof(time_buf),
+                                         settings)
+               : clog_format_time(time_buf, sizeof(time_buf));
+      len = clog_append(dst, cap, len, time_buf, time_len);
+      break;
+    }
+    case CLOG_PATTERN_MESSAGE:
+      if (len + 1 < cap) {
+        size_t room = cap - len;
+        if (room > CLOG_MAX_MESSAGE_SIZE)
+          room = CLOG_MAX_MESSAGE_SIZE;
+        int n = clog_vformat(dst + len, room, format, args);
+        if (n > 0)
+          len += (size_t)n < room ? (size_t)n : room - 1;
+        if (n > 0 && (size_t)n >= room)
+          CLOG_STAT_TRUNCATED_MARK();
+      }
+      for (size_t i = 0; i < nfields; i++)
+        len = clog_append_field(dst, cap, len, &fields[i], false);
+      break;
+    case CLOG_PATTERN_FILE:
+      len = clog_append_str(dst, cap, len, clog_basename(file));
+      break;
+    case CLOG_PATTERN_LINE:
+      len = clog_append_int(dst, cap, len, line);
+      break;
+    case CLOG_PATTERN_FUNC:
+      len = clog_append_str(dst, cap, len, func ? func : "");
+      break;
+    case CLOG_PATTERN_THREAD: {
+#if CLOG_HAS_TLS
+      static CLOG_THREAD_LOCAL unsigned long thread_id;
+      if (!thread_id)
+        thread_id = clog_thread_id();
+#else
+      unsigned long thread_id = clog_thread_id();
+#endif
+      len = clog_append_int(dst, cap, len, (long long)thread_id);
+      break;
+    }
+    case CLOG_PATTERN_PID:
+      len = clog_append_int(dst, cap, len, (long long)getpid());
+      break;
+    case CLOG_PATTERN_ELAPSED:
+      len = clog_append_int(
+          dst, cap, len,
+          (long long)((clog_now_ns() - clog_start_ns) / 1000000u));
+      break;
+    case CLOG_PATTERN_CATEGORY:
+#if CLOG_HAS_TLS
+      if (clog_current_category)
+        len = clog_append_str(dst, cap, len, clog_current_category);
+#endif
+      break;
+    }
+    if (op->width)
+      len = clog_pattern_pad(dst, cap, start, len, op);
+  }
+
+  dst[len++] = '\n';
+  dst[len] = '\0';
+  return len;
+}
+
+/* Renders one line in the given layout, with the display settings of
+ * settings or, if it is NULL, the current ones */
+static size_t clog_render(char *dst, size_t size, clog_output_format_t layout,
+                          clog_level_t level, const char *file, int line,
+                          const char *func, const clog_field_t *fields,
+                          size_t nfields, const char *format, va_list args,
+                          bool use_ansi, const struct timespec *when,
+                          const clog_render_settings_t *settings) {
+  if (layout == CLOG_FORMAT_JSON || layout == CLOG_FORMAT_LOGFMT)
+    return clog_format_structured(dst, size, layout == CLOG_FORMAT_JSON,
+                                  level, file, line, func, fields, nfields,
+                                  format, args, when, settings);
+
+  clog_pattern_t *pattern =
+      atomic_load_explicit(&clog_pattern, memory_order_acquire);
+  if (pattern)
+    return clog_pattern_render(pattern, dst, size, level, file, line, func,
+                               fields, nfields, format, args, use_ansi, when,
+                               settings);
+
+  size_t len = 0;
+  /* Keep one byte for the trailing newline and one for the terminator */
+  size_t cap = size - 1;
+
+  if (settings ? settings->show_timestamp : clog_show_timestamp) {
+    char time_buf[CLOG_MAX_TIME_SIZE];
+    size_t time_len =
+        when ? clog_format_timespec_as(when, time_buf, sizeof(time_buf),
+                                       settings)
+             : clog_format_time(time_buf, sizeof(time_buf));
+    if (use_ansi)
+      len = clog_append_str(dst, cap, len, CLOG_BOLD);
+    len = clog_append(dst, cap, len, time_buf, time_len);
+    if (use_ansi)
+      len = clog_append_str(dst, cap, len, CLOG_NO_BOLD);
+    len = clog_append(dst, cap, len, " ", 1);
+  }
+
+  if (use_ansi)
+    len = clog_append_str(dst, cap, len, clog_level_color_ansi(level));
+  len = clog_append(dst, cap, len, "[", 1);
+  len = clog_append_str(dst, cap, len, clog_level_string(level));
+  len = clog_append(dst, cap, len, "]", 1);
+  if (use_ansi)
+    len = clog_append_str(dst, cap, len, CLOG_RESET);
+  len = clog_append(dst, cap, len, " ", 1);
+
+  if (len + 1 < cap) {
+    size_t room = cap - len;
+    if (room > CLOG_MAX_MESSAGE_SIZE)
+      room = CLOG_MAX_MESSAGE_SIZE;
+    int n = clog_vformat(dst + len, room, format, args);
+    if (n > 0)
+      len += (size_t)n < room ? (size_t)n : room - 1;
+    if (n > 0 && (size_t)n >= room)
+      CLOG_STAT_TRUNCATED_MARK();
+  }
+  for (size_t i = 0; i < nfields; i++)
+    len = clog_append_field(dst, cap, len, &fields[i], false);
+
+  if ((settings ? settings->show_location : clog_show_location) && file &&
+      line > 0 && func && len + 1 < cap) {
+    len = clog_append(dst, cap, len, " ", 1);
+    if (use_ansi)
+      len = clog_append_str(dst, cap, len, CLOG_DIM);
+    size_t room = cap - len;
+    if (room > CLOG_MAX_LOCATION_SIZE)
+      room = CLOG_MAX_LOCATION_SIZE;
+    /* " (file:line in func)", cut to the location budget */
+    size_t end = len + room;
+    len = clog_append(dst, end, len, " (", 2);
+    len = clog_append_str(dst, end, len, clog_basename(file));
+    len = clog_append(dst, end, len, ":", 1);
+    len = clog_append_int(dst, end, len, line);
+    len = clog_append(dst, end, len, " in ", 4);
+    len = clog_append_str(dst, end, len, func);
+    len = clog_append(dst, end, len, ")", 1);
+    if (use_ansi)
+      len = clog_append_str(dst, cap, len, CLOG_RESET);
+  }
+
+  dst[len++] = '\n';
+  dst[len] = '\0';
+  return len;
+}
+
+CLOG_API size_t clog_format_record(char *dst, size_t size, clog_level_t level,
+                                   const char *file, int line, const char *func,
+                                   const clog_field_t *fields, size_t nfields,
+                                   const char *format, va_list args,
+                                   bool use_ansi, const struct timespec *when) {
+  return clog_render(dst, size, clog_output_format, level, file, line, func,
+                     fields, nfields, format, args, use_ansi, when, NULL);
+}
+
+#if CLOG_HAS_TLS
+/* A record being fanned out to several outputs. All of them share one
+ * timestamp, and each layout is rendered at most once */
+typedef struct {
+  clog_level_t level;
+  const char *file;
+  int line;
+  const char *func;
+  const clog_field_t *fields;
+  size_t nfields;
+  const char *format;
+  va_list args;
+  struct timespec when;
+  unsigned int rendered; /* Bit per layout already in its buffer */
+  size_t len[CLOG_LAYOUT_COUNT];
+} clog_record_t;
+
+/* Returns the record rendered in the given layout, rendering it on first
+ * use into a per-thread buffer */
+static const char *clog_record_line(clog_record_t *rec,
+                                    clog_output_format_t layout,
+                                    bool use_ansi, size_t *len) {
+  static CLOG_THREAD_LOCAL char bufs[CLOG_LAYOUT_COUNT][CLOG_MAX_LINE_SIZE];
+  if (layout != CLOG_FORMAT_JSON && layout != CLOG_FORMAT_LOGFMT)
+    layout = CLOG_FORMAT_TEXT;
+  /* Structured layouts never carry colors */
+  if (layout != CLOG_FORMAT_TEXT)
+    use_ansi = false;
+  unsigned int index = (unsigned int)layout * 2 + (use_ansi ? 1 : 0);
+
+  if (!(rec->rendered & (1u << index))) {
+    va_list copy;
+    va_copy(copy, rec->args);
+    rec->len[index] = clog_render(bufs[index], sizeof(bufs[index]), layout,
+                                  rec->level, rec->file, rec->line, rec->func,
+                                  rec->fields, rec->nfields, rec->format, copy,
+                                  use_ansi, &rec->when, NULL);
+    va_end(copy);
+    rec->rendered |= 1u << index;
+  }
+  *len = rec->len[index];
+  return bufs[index];
+}
+
+/* Writes the record to every sink that accepts its level. Lines are
+ * rendered outside the lock; a sink removed in the meantime is skipped */
+static void clog_sinks_write(clog_record_t *rec) {
+  clog_sink_t sinks[CLOG_MAX_SINKS];
+  const char *lines[CLOG_MAX_SINKS];
+  size_t lens[CLOG_MAX_SINKS];
+  bool any = false;
+
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  memcpy(sinks, clog_sinks, sizeof(sinks));
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+
+  for (int i = 0; i < CLOG_MAX_SINKS; i++) {
+    lines[i] = NULL;
+    if (!sinks[i].id || rec->level < sinks[i].level)
+      continue;
+    lines[i] = clog_record_line(rec, sinks[i].format, sinks[i].use_ansi,
+                                &lens[i]);
+    any = true;
+  }
+  if (!any)
+    return;
+
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  for (int i = 0; i < CLOG_MAX_SINKS; i++) {
+    if (!lines[i] || clog_sinks[i].id != sinks[i].id)
+      continue;
+#ifdef CLOG_STATS
+    uint64_t start = clog_now_ns();
+#endif
+    bool ok;
+    if (sinks[i].fp) {
+      ok = fwrite(lines[i], 1, lens[i], sinks[i].fp) == lens[i];
+      if (rec->level >= clog_flush_level)
+        fflush(sinks[i].fp);
+    } else {
+      ok = clog_fd_write(sinks[i].fd, lines[i], lens[i]);
+    }
+#ifdef CLOG_STATS
+    clog_stat_write(lens[i], ok, start);
+#else
+    (void)ok;
+#endif
+  }
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+}
+#endif
+
+/* Flushes the streams of all sinks */
+static void clog_sinks_flush(void) {
+  if (!atomic_load(&clog_sink_count))
+    return;
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  for (int i = 0; i < CLOG_MAX_SINKS; i++) {
+    if (clog_sinks[i].id && clog_sinks[i].fp)
+      fflush(clog_sinks[i].fp);
+  }
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+}
+
+CLOG_API int clog_add_sink(const clog_sink_config_t *config) {
+#if CLOG_HAS_TLS
+  if (!config || (!config->fp && config->fd < 0))
+    return -1;
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  bool use_ansi;
+  switch (config->color) {
+  case CLOG_COLOR_NEVER:
+  case CLOG_COLOR_WIN32: /* Console attributes only apply to the main output */
+    use_ansi = false;
+    break;
+  case CLOG_COLOR_ALWAYS:
+  case CLOG_COLOR_ANSI:
+    use_ansi = true;
+    break;
+  case CLOG_COLOR_AUTO:
+  default:
+#if CLOG_WINDOWS
+    use_ansi = config->fp ? clog_is_console_output(config->fp)
+                          : clog_is_console_fd(config->fd);
+#else
+    use_ansi = isatty(config->fp ? fileno(config->fp) : config->fd);
+#endif
+    break;
+  }
+
+  int id = -1;
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  for (int i = 0; i < CLOG_MAX_SINKS; i++) {
+    if (clog_sinks[i].id)
+      continue;
+    id = clog_sink_next_id++;
+    if (clog_sink_next_id <= 0)
+      clog_sink_next_id = 1;
+    clog_sinks[i].id = id;
+    clog_sinks[i].fp = config->fp;
+    clog_sinks[i].fd = config->fd;
+    clog_sinks[i].level = config->level;
+    clog_sinks[i].format = config->format;
+    clog_sinks[i].use_ansi = use_ansi;
+    atomic_fetch_add(&clog_sink_count, 1);
+    clog_update_min_level();
+    break;
+  }
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+  return id;
+#else
+  /* Fan-out renders into per-thread buffers */
+  (void)config;
+  return -1;
+#endif
+}
+
+CLOG_API bool clog_remove_sink(int id) {
+  bool found = false;
+  if (id <= 0 || !atomic_load(&clog_is_initialized))
+    return false;
+
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  for (int i = 0; i < CLOG_MAX_SINKS; i++) {
+    if (clog_sinks[i].id != id)
+      continue;
+    if (clog_sinks[i].fp)
+      fflush(clog_sinks[i].fp);
+    memset(&clog_sinks[i], 0, sizeof(clog_sinks[i]));
+    atomic_fetch_sub(&clog_sink_count, 1);
+    clog_update_min_level();
+    found = true;
+    break;
+  }
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+  return found;
+}
+
+/* Slot holding exactly this category's level, or -1; needs
+ * clog_sink_mutex */
+static int clog_category_find(const char *name) {
+  for (int i = 0; i < clog_category_count; i++) {
+    if (strcmp(clog_categories[i].name, name) == 0)
+      return i;
+  }
+  return -1;
+}
+
+/* Level of the longest configured name that is the category or one of
+ * its dotted parents, else the main output's; needs clog_sink_mutex */
+static clog_level_t clog_category_lookup(const char *name) {
+  clog_level_t level = (clog_level_t)atomic_load(&clog_output_level);
+  size_t best = 0;
+  for (int i = 0; i < clog_category_count; i++) {
+    const char *entry = clog_categories[i].name;
+    size_t len = strlen(entry);
+    if (len <= best || strncmp(entry, name, len) != 0 ||
+        (name[len] != '\0' && name[len] != '.'))
+      continue;
+    best = len;
+    level = clog_categories[i].level;
+  }
+  return level;
+}
+
+CLOG_API bool clog_set_category_level(const char *name, clog_level_t level) {
+  if (!name || !*name || strlen(name) >= CLOG_CATEGORY_NAME_SIZE)
+    return false;
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  bool stored = true;
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  int slot = clog_category_find(name);
+  if (slot < 0 && clog_category_count < CLOG_MAX_CATEGORIES) {
+    slot = clog_category_count++;
+    clog_safe_strcpy(clog_categories[slot].name, name,
+                     sizeof(clog_categories[slot].name));
+  }
+  if (slot >= 0) {
+    clog_categories[slot].level = level;
+    clog_update_min_level();
+  } else {
+    stored = false;
+  }
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+  return stored;
+}
+
+CLOG_API bool clog_clear_category_level(const char *name) {
+  if (!name || !atomic_load(&clog_is_initialized))
+    return false;
+
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  int slot = clog_category_find(name);
+  if (slot >= 0) {
+    clog_categories[slot] = clog_categories[--clog_category_count];
+    clog_update_min_level();
+  }
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+  return slot >= 0;
+}
+
+CLOG_API clog_level_t clog_get_category_level(const char *name) {
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  clog_level_t level = clog_category_lookup(name ? name : "");
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+  return level;
+}
+
+/* Levels fit the 3-bit fields of a site's state; anything past FATAL is
+ * off, as it is for the plain macros */
+static unsigned int clog_category_field(clog_level_t level) {
+  if ((int)level < (int)CLOG_TRACE)
+    return CLOG_TRACE;
+  if ((int)level > (int)CLOG_CATEGORY_OFF)
+    return CLOG_CATEGORY_OFF;
+  return (unsigned int)level;
+}
+
+CLOG_API unsigned int clog_category_resolve(clog_category_site_t *site) {
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  unsigned int generation = atomic_load(&clog_category_generation) &
+                            CLOG_CATEGORY_GENERATION_MASK;
+  clog_level_t output = clog_category_lookup(site->name);
+  clog_level_t gate =
+      output < clog_aux_min_level ? output : clog_aux_min_level;
+  unsigned int state = generation << 6 | clog_category_field(output) << 3 |
+                       clog_category_field(gate);
+  atomic_store_explicit(&site->state, state, memory_order_relaxed);
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+  return state;
+}
+
+#if CLOG_HAS_RECORDER
+#if CLOG_POSIX
+/* Thread exit: leaves the ring's lines for dumps until it is taken over */
+static void clog_recorder_retire(void *ring) {
+  atomic_store(&((clog_ring_t *)ring)->state, CLOG_RING_RETIRED);
+}
+#endif
+
+/* Gives the calling thread a ring: one an exited thread left behind, or a
+ * new one. Returns NULL once CLOG_RECORDER_THREADS rings are in use */
+static clog_ring_t *clog_recorder_claim(void) {
+  clog_ring_t *ring = NULL;
+  for (int i = 0; i < CLOG_RECORDER_THREADS && !ring; i++) {
+    clog_ring_t *old = atomic_load(&clog_recorder_rings[i]);
+    int retired = CLOG_RING_RETIRED;
+    if (old && atomic_compare_exchange_strong(&old->state, &retired,
+                                              CLOG_RING_OWNED)) {
+      atomic_store(&old->dumped, 0);
+      atomic_store(&old->head, 0);
+      ring = old;
+    }
+  }
+  for (int i = 0; i < CLOG_RECORDER_THREADS && !ring; i++) {
+    if (atomic_load(&clog_recorder_rings[i]))
+      continue;
+    clog_ring_t *fresh = (clog_ring_t *)calloc(1, sizeof(clog_ring_t));
+    if (!fresh)
+      return NULL;
+    atomic_store(&fresh->state, CLOG_RING_OWNED);
+    clog_ring_t *expected = NULL;
+    if (atomic_compare_exchange_strong(&clog_recorder_rings[i], &expected,
+                                       fresh))
+      ring = fresh;
+    else
+      free(fresh);
+  }
+  if (!ring)
+    return NULL;
+  ring->thread_id = clog_thread_id();
+#if CLOG_POSIX
+  if (clog_recorder_key_ready)
+    pthread_setspecific(clog_recorder_key, ring);
+#endif
+  return ring;
+}
+
+/* Renders a record the main output drops into the calling thread's ring,
+ * in place unless the line could run past the end of the ring */
+static void clog_recorder_capture(clog_level_t level, const char *file,
+                                  int line, const char *func,
+                                  const clog_field_t *fields, size_t nfields,
+                                  const char *format, va_list args) {
+  static CLOG_THREAD_LOCAL char wrap_buf[CLOG_MAX_LINE_SIZE];
+  static CLOG_THREAD_LOCAL bool refused;
+  clog_ring_t *ring = clog_recorder_ring;
+  if (!ring) {
+    if (refused)
+      return;
+    ring = clog_recorder_ring = clog_recorder_claim();
+    refused = !ring;
+    if (!ring)
+      return;
+  }
+
+  uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  size_t pos = (size_t)(head % CLOG_RECORDER_SIZE);
+  size_t room = CLOG_RECORDER_SIZE - pos;
+  char *dst = room >= CLOG_MAX_LINE_SIZE ? ring->data + pos : wrap_buf;
+  size_t len = clog_render(dst, CLOG_MAX_LINE_SIZE, CLOG_FORMAT_TEXT, level,
+                           file, line, func, fields, nfields, format, args,
+                           false, NULL, NULL);
+  if (dst == wrap_buf) {
+    size_t first = len < room ? len : room;
+    memcpy(ring->data + pos, wrap_buf, first);
+    memcpy(ring->data, wrap_buf + first, len - first);
+  }
+  atomic_store_explicit(&ring->head, head + len, memory_order_release);
+}
+
+#endif
+
+CLOG_API bool clog_set_flight_recorder(clog_level_t level, const char *path) {
+#if CLOG_HAS_RECORDER
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  int fd = 2;
+  if (level != CLOG_RECORDER_OFF && path) {
+#if CLOG_WINDOWS
+    fd = _open(path, _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY,
+               _S_IREAD | _S_IWRITE);
+#else
+    fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+    if (fd < 0)
+      return false;
+  }
+
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  int old_fd = clog_recorder_fd;
+  clog_recorder_fd = fd;
+  clog_recorder_level = level;
+#if CLOG_POSIX
+  if (!clog_recorder_key_ready &&
+      pthread_key_create(&clog_recorder_key, clog_recorder_retire) == 0)
+    clog_recorder_key_ready = true;
+#endif
+  clog_update_min_level();
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+
+  if (old_fd != 2) {
+#if CLOG_WINDOWS
+    _close(old_fd);
+#else
+    close(old_fd);
+#endif
+  }
+  return true;
+#else
+  (void)level;
+  (void)path;
+  return false;
+#endif
+}
+
+CLOG_API void clog_dump_flight_recorder(int fd) {
+#if CLOG_HAS_RECORDER
+  if (fd < 0)
+    fd = clog_recorder_fd;
+  for (int i = 0; i < CLOG_RECORDER_THREADS; i++) {
+    clog_ring_t *ring = atomic_load(&clog_recorder_rings[i]);
+    if (!ring)
+      continue;
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint64_t from = atomic_load(&ring->dumped);
+    if (from >= head)
+      continue;
+    /* Older lines were overwritten: start at the first whole line */
+    if (head - from > CLOG_RECORDER_SIZE) {
+      from = head - CLOG_RECORDER_SIZE;
+      while (from < head && ring->data[from % CLOG_RECORDER_SIZE] != '\n')
+        from++;
+      if (++from >= head)
+        continue;
+    }
+
+    char header[96];
+    size_t len = clog_signal_format(header, sizeof(header),
+                                    "--- clog flight recorder: thread %lu, "
+                                    "%llu bytes ---\n",
+                                    ring->thread_id,
+                                    (unsigned long long)(head - from));
+    clog_fd_write(fd, header, len);
+
+    size_t start = (size_t)(from % CLOG_RECORDER_SIZE);
+    size_t total = (size_t)(head - from);
+    size_t first = CLOG_RECORDER_SIZE - start;
+    if (first > total)
+      first = total;
+    clog_fd_write(fd, ring->data + start, first);
+    if (total > first)
+      clog_fd_write(fd, ring->data, total - first);
+    atomic_store(&ring->dumped, head);
+  }
+#else
+  (void)fd;
+#endif
+}
+
+#if CLOG_POSIX && CLOG_HAS_RECORDER
+static const int clog_crash_signals[CLOG_CRASH_SIGNAL_COUNT] = {
+    SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+/* Dumps the rings, then restores the previous disposition and re-raises;
+ * the signal stays blocked until this returns */
+static void clog_crash_handler(int sig) {
+  int saved_errno = errno;
+  char msg[64];
+  size_t len = clog_signal_format(msg, sizeof(msg), "clog: fatal signal %d\n",
+                                  sig);
+  clog_fd_write(clog_recorder_fd, msg, len);
+  clog_dump_flight_recorder(-1);
+
+  for (int i = 0; i < CLOG_CRASH_SIGNAL_COUNT; i++) {
+    if (clog_crash_signals[i] == sig)
+      sigaction(sig, &clog_crash_previous[i], NULL);
+  }
+  errno = saved_errno;
+  raise(sig);
+}
+#endif
+
+CLOG_API bool clog_install_crash_handlers(void) {
+#if CLOG_POSIX && CLOG_HAS_RECORDER
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  bool ok = true;
+  if (!clog_crash_installed) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = clog_crash_handler;
+    sigemptyset(&action.sa_mask);
+    /* Runs on an alternate stack if the thread set one up; SA_ONSTACK is
+     * an XSI flag that strict POSIX modes leave out */
+#ifdef SA_ONSTACK
+    action.sa_flags = SA_ONSTACK;
+#endif
+    for (int i = 0; i < CLOG_CRASH_SIGNAL_COUNT && ok; i++)
+      ok = sigaction(clog_crash_signals[i], &action,
+                     &clog_crash_previous[i]) == 0;
+    clog_crash_installed = ok;
+  }
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+  return ok;
+#else
+  return false;
+#endif
+}
+
+CLOG_API void clog_write_record(clog_level_t level, const char *str,
+                                size_t len) {
+#if CLOG_WINDOWS
+  bool console_colors = !clog_use_ansi_colors() && clog_should_use_colors();
+  if (console_colors) {
+    /* Console attributes apply to what is flushed while they are set */
+    clog_set_console_color(level);
+    clog_safe_write(str, len);
+    fflush(clog_output ? clog_output : stdout);
+    clog_reset_console_color();
+    return;
+  }
+#else
+  (void)level;
+#endif
+  clog_safe_write(str, len);
+}
+
+CLOG_API void clog_flush_output(void) {
+  FILE *output = clog_output ? clog_output : stdout;
+  if (clog_out_len) {
+    clog_safe_write(clog_out_buf, clog_out_len);
+    clog_out_len = 0;
+  }
+  if (clog_output_fd < 0)
+    fflush(output);
+  if (clog_flush_interval_ms)
+    clog_out_last_flush = clog_now_ns();
+}
+
+/* True when buffered output has waited longer than the flush interval */
+static bool clog_flush_interval_due(void) {
+  return clog_flush_interval_ms && clog_out_len &&
+         clog_now_ns() - clog_out_last_flush >=
+             (uint64_t)clog_flush_interval_ms * 1000000u;
+}
+
+CLOG_API bool clog_buffer_line(clog_level_t level, const char *str,
+                               size_t len) {
+#if CLOG_WINDOWS
+  /* Console attributes cannot be buffered across records */
+  if (!clog_use_ansi_colors() && clog_should_use_colors()) {
+    clog_write_record(level, str, len);
+    return true;
+  }
+#endif
+  if (!clog_out_buf) {
+    clog_write_record(level, str, len);
+    return true;
+  }
+
+  if (clog_out_len + len > CLOG_OUTPUT_BUFFER_SIZE)
+    clog_flush_output();
+  if (len > CLOG_OUTPUT_BUFFER_SIZE) {
+    clog_safe_write(str, len);
+    return true;
+  }
+  memcpy(clog_out_buf + clog_out_len, str, len);
+  clog_out_len += len;
+
+  return level >= clog_flush_level ||
+         (clog_flush_bytes && clog_out_len >= clog_flush_bytes) ||
+         clog_flush_interval_due();
+}
+
+CLOG_API void clog_set_flush_policy(clog_level_t level, size_t bytes,
+                                    unsigned int interval_ms) {
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  clog_flush_output();
+  clog_flush_level = level;
+  clog_flush_bytes = bytes;
+  clog_flush_interval_ms = interval_ms;
+  clog_out_last_flush = clog_now_ns();
+
+  /* Flushing every line needs no buffer of our own */
+  bool buffered = level > CLOG_TRACE;
+  if (buffered && !clog_out_buf)
+    clog_out_buf = (char *)malloc(CLOG_OUTPUT_BUFFER_SIZE);
+  if (!buffered || !clog_out_buf) {
+    free(clog_out_buf);
+    clog_out_buf = NULL;
+    clog_flush_level = CLOG_TRACE;
+  }
+  CLOG_MUTEX_UNLOCK(&clog_mutex);
+}
+
+/* One printf conversion as seen by the binary encoder and decoder */
+typedef struct {
+  size_t spec_len;     /* Bytes from '%' through the conversion character */
+  int stars;           /* '*' width/precision arguments before the value */
+  int precision;       /* Literal precision, or -1 */
+  bool has_width;      /* A field width is present */
+  bool star_precision; /* The precision comes from an argument */
+  char length;         /* 0, H (hh), h, l, q (ll), j, z, t or L */
+  char conversion;
+} clog_binary_spec_t;
+
+enum {
+  CLOG_BINARY_ARG_NONE,
+  CLOG_BINARY_ARG_INT,
+  CLOG_BINARY_ARG_INT64,
+  CLOG_BINARY_ARG_DOUBLE,
+  CLOG_BINARY_ARG_LDOUBLE,
+  CLOG_BINARY_ARG_STRING,
+  CLOG_BINARY_ARG_PTR
+};
+
+/* Parses the conversion at fmt (which points at '%'); false if the
+ * conversion cannot be deferred (positional, %n, wide strings...) */
+static bool clog_binary_parse_spec(const char *fmt, clog_binary_spec_t *spec) {
+  const char *p = fmt + 1;
+  memset(spec, 0, sizeof(*spec));
+  spec->precision = -1;
+
+  while (*p && strchr("-+ #0'", *p))
+    p++;
+  if (*p == '*') {
+    spec->stars++;
+    spec->has_width = true;
+    p++;
+  } else {
+    const char *digits = p;
+    while (*p >= '0' && *p <= '9')
+      p++;
+    if (*p == '$')
+      return false;
+    spec->has_width = p != digits;
+  }
+  if (*p == '.') {
+    p++;
+    if (*p == '*') {
+      spec->stars++;
+      spec->star_precision = true;
+      p++;
+    } else {
+      spec->precision = 0;
+      while (*p >= '0' && *p <= '9')
+        spec->precision = spec->precision * 10 + (*p++ - '0');
+    }
+  }
+
+  if (p[0] == 'h' && p[1] == 'h') {
+    spec->length = 'H';
+    p += 2;
+  } else if (p[0] == 'l' && p[1] == 'l') {
+    spec->length = 'q';
+    p += 2;
+  } else if (*p && strchr("hljztLq", *p)) {
+    spec->length = *p++;
+  }
+
+  spec->conversion = *p;
+  if (!*p || !strchr("diouxXcfFeEgGaAsp%", *p))
+    return false;
+  if ((*p == 'c' || *p == 's') && spec->length)
+    return false;
+  spec->spec_len = (size_t)(p - fmt) + 1;
+  return true;
+}
+
+static int clog_binary_arg_kind(const clog_binary_spec_t *spec) {
+  switch (spec->conversion) {
+  case 'd': case 'i': case 'o': case 'u': case 'x': case 'X': case 'c':
+    return spec->length == 0 || spec->length == 'H' || spec->length == 'h'
+               ? CLOG_BINARY_ARG_INT
+               : CLOG_BINARY_ARG_INT64;
+  case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a':
+  case 'A':
+    return spec->length == 'L' ? CLOG_BINARY_ARG_LDOUBLE
+                               : CLOG_BINARY_ARG_DOUBLE;
+  case 's':
+    return CLOG_BINARY_ARG_STRING;
+  case 'p':
+    return CLOG_BINARY_ARG_PTR;
+  default:
+    return CLOG_BINARY_ARG_NONE;
+  }
+}
+
+/* Fixed-capacity byte buffer used to encode a record payload */
+typedef struct {
+  unsigned char *data;
+  size_t len;
+  size_t cap;
+  bool overflow;
+} clog_binary_buf_t;
+
+static void clog_binary_put(clog_binary_buf_t *buf, const void *src,
+                            size_t n) {
+  if (buf->overflow || n > buf->cap - buf->len) {
+    buf->overflow = true;
+    return;
+  }
+  memcpy(buf->data + buf->len, src, n);
+  buf->len += n;
+}
+
+/* Copies the raw printf arguments; false if the message must be formatted
+ * on the spot instead */
+static bool clog_binary_encode_args(clog_binary_buf_t *buf, const char *format,
+                                    va_list args) {
+  for (const char *f = format; *f; f++) {
+    if (*f != '%')
+      continue;
+    clog_binary_spec_t spec;
+    if (!clog_binary_parse_spec(f, &spec))
+      return false;
+    f += spec.spec_len - 1;
+
+    int32_t stars[2] = {0, 0};
+    for (int i = 0; i < spec.stars; i++) {
+      stars[i] = (int32_t)va_arg(args, int);
+      clog_binary_put(buf, &stars[i], sizeof(stars[i]));
+    }
+
+    switch (clog_binary_arg_kind(&spec)) {
+    case CLOG_BINARY_ARG_INT: {
+      int32_t v = (int32_t)va_arg(args, int);
+      clog_binary_put(buf, &v, sizeof(v));
+      break;
+    }
+    case CLOG_BINARY_ARG_INT64: {
+      uint64_t v;
+      switch (spec.length) {
+      case 'l':
+        v = (uint64_t)va_arg(args, long);
+        break;
+      case 'j':
+        v = (uint64_t)va_arg(args, intmax_t);
+        break;
+      case 'z':
+        v = (uint64_t)va_arg(args, size_t);
+        break;
+      case 't':
+        v = (uint64_t)va_arg(args, ptrdiff_t);
+        break;
+      default:
+        v = (uint64_t)va_arg(args, long long);
+        break;
+      }
+      clog_binary_put(buf, &v, sizeof(v));
+      break;
+    }
+    case CLOG_BINARY_ARG_DOUBLE: {
+      double v = va_arg(args, double);
+      clog_binary_put(buf, &v, sizeof(v));
+      break;
+    }
+    case CLOG_BINARY_ARG_LDOUBLE: {
+      long double v = va_arg(args, long double);
+      clog_binary_put(buf, &v, sizeof(v));
+      break;
+    }
+    case CLOG_BINARY_ARG_PTR: {
+      uint64_t v = (uint64_t)(uintptr_t)va_arg(args, void *);
+      clog_binary_put(buf, &v, sizeof(v));
+      break;
+    }
+    case CLOG_BINARY_ARG_STRING: {
+      const char *str = va_arg(args, const char *);
+      uint32_t n = CLOG_BINARY_NULL_STR;
+      if (str) {
+        int precision = spec.star_precision ? stars[spec.stars - 1]
+                                            : spec.precision;
+        size_t len = clog_safe_strlen(
+            str, precision >= 0 ? (size_t)precision : (size_t)-1);
+        /* Text output never shows more than a message's worth of it, but a
+         * field width would pad differently once truncated */
+        if (len >= CLOG_MAX_MESSAGE_SIZE) {
+          if (spec.has_width)
+            return false;
+          len = CLOG_MAX_MESSAGE_SIZE - 1;
+        }
+        n = (uint32_t)len;
+      }
+      clog_binary_put(buf, &n, sizeof(n));
+      if (str)
+        clog_binary_put(buf, str, n);
+      break;
+    }
+    default:
+      break;
+    }
+  }
+  return !buf->overflow;
+}
+
+static void clog_binary_write_str(FILE *out, const char *str) {
+  uint32_t n = str ? (uint32_t)strlen(str) : CLOG_BINARY_NULL_STR;
+  fwrite(&n, sizeof(n), 1, out);
+  if (str)
+    fwrite(str, 1, n, out);
+}
+
+/* Finds or registers the call site, describing new ones in the stream;
+ * needs clog_mutex */
+static bool clog_binary_site_id(FILE *out, const char *format,
+                                const char *file, int line, const char *func,
+                                uint32_t *id) {
+  uintptr_t hash = (uintptr_t)format ^ ((uintptr_t)file * 31u) ^
+                   ((uintptr_t)(unsigned int)line * 2654435761u);
+  hash ^= hash >> 15;
+  for (uint32_t probe = 0; probe < CLOG_BINARY_MAX_SITES; probe++) {
+    uint32_t index = (uint32_t)(hash + probe) & (CLOG_BINARY_MAX_SITES - 1);
+    clog_binary_site_t *site = &clog_binary_sites[index];
+    if (site->format == format && site->file == file && site->line == line) {
+      *id = index;
+      return true;
+    }
+    if (!site->format) {
+      site->format = format;
+      site->file = file;
+      site->line = line;
+      unsigned char type = CLOG_BINARY_SITE;
+      int32_t site_line = line;
+      fwrite(&type, 1, 1, out);
+      fwrite(&index, sizeof(index), 1, out);
+      fwrite(&site_line, sizeof(site_line), 1, out);
+      clog_binary_write_str(out, format);
+      clog_binary_write_str(out, file);
+      clog_binary_write_str(out, func);
+      *id = index;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void clog_binary_log(clog_level_t level, const char *file, int line,
+                            const char *func, const clog_field_t *fields,
+                            size_t nfields, const char *format,
+                            va_list args) {
+  static CLOG_THREAD_LOCAL unsigned char payload[CLOG_BINARY_MAX_PAYLOAD];
+  static CLOG_THREAD_LOCAL char message[CLOG_MAX_MESSAGE_SIZE];
+
+  struct timespec ts;
+  if (!clog_clock_now(&ts))
+    memset(&ts, 0, sizeof(ts));
+
+  /* Only the raw arguments are copied here; formatting happens offline.
+   * Records with fields go out as text with the fields appended */
+  clog_binary_buf_t buf = {payload, 0, sizeof(payload), false};
+  va_list copy;
+  va_copy(copy, args);
+  bool deferred = !nfields && clog_binary_encode_args(&buf, format, copy);
+  va_end(copy);
+  if (!deferred) {
+    if (clog_vformat(message, sizeof(message), format, args) >=
+        (int)sizeof(message))
+      CLOG_STAT_TRUNCATED_MARK();
+    size_t len = strlen(message);
+    for (size_t i = 0; i < nfields; i++)
+      len = clog_append_field(message, sizeof(message), len, &fields[i],
+                              false);
+    message[len] = '\0';
+  }
+
+  int64_t sec = (int64_t)ts.tv_sec;
+  uint32_t nsec = (uint32_t)ts.tv_nsec;
+  unsigned char head[2] = {CLOG_BINARY_RECORD, (unsigned char)level};
+
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  FILE *out = clog_binary_output;
+  if (out) {
+    uint32_t id;
+    if (deferred && clog_binary_site_id(out, format, file, line, func, &id)) {
+      uint32_t size = (uint32_t)buf.len;
+      fwrite(head, 1, 2, out);
+      fwrite(&id, sizeof(id), 1, out);
+      fwrite(&sec, sizeof(sec), 1, out);
+      fwrite(&nsec, sizeof(nsec), 1, out);
+      fwrite(&size, sizeof(size), 1, out);
+      fwrite(payload, 1, buf.len, out);
+    } else {
+      if (deferred && clog_vformat(message, sizeof(message), format, args) >=
+                          (int)sizeof(message))
+        CLOG_STAT_TRUNCATED_MARK();
+      int32_t site_line = line;
+      head[0] = CLOG_BINARY_TEXT;
+      fwrite(head, 1, 2, out);
+      fwrite(&sec, sizeof(sec), 1, out);
+      fwrite(&nsec, sizeof(nsec), 1, out);
+      fwrite(&site_line, sizeof(site_line), 1, out);
+      clog_binary_write_str(out, message);
+      clog_binary_write_str(out, file);
+      clog_binary_write_str(out, func);
+    }
+    if (level >= clog_flush_level)
+      fflush(out);
+  }
+  CLOG_MUTEX_UNLOCK(&clog_mutex);
+}
+
+CLOG_API bool clog_set_binary_output(FILE *fp) {
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  clog_flush();
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  if (clog_binary_output)
+    fflush(clog_binary_output);
+  clog_binary_output = NULL;
+
+  if (!fp) {
+    free(clog_binary_sites);
+    clog_binary_sites = NULL;
+    CLOG_MUTEX_UNLOCK(&clog_mutex);
+    return true;
+  }
+
+  /* A new stream starts with an empty dictionary */
+  free(clog_binary_sites);
+  clog_binary_sites = (clog_binary_site_t *)calloc(CLOG_BINARY_MAX_SITES,
+                                                   sizeof(clog_binary_site_t));
+  if (!clog_binary_sites) {
+    CLOG_MUTEX_UNLOCK(&clog_mutex);
+    return false;
+  }
+
+  uint32_t bom = 0x01020304u;
+  unsigned char header[8] = {
+      CLOG_BINARY_VERSION,
+      (unsigned char)clog_show_timestamp,
+      (unsigned char)clog_show_location,
+      (unsigned char)atomic_load(&clog_time_precision),
+      (unsigned char)atomic_load(&clog_time_format),
+      (unsigned char)atomic_load(&clog_time_utc),
+      (unsigned char)sizeof(long double),
+      0};
+  fwrite(CLOG_BINARY_MAGIC, 1, 8, fp);
+  fwrite(&bom, sizeof(bom), 1, fp);
+  fwrite(header, 1, sizeof(header), fp);
+  clog_binary_output = fp;
+  CLOG_MUTEX_UNLOCK(&clog_mutex);
+  return true;
+}
+
+/* Growable text buffer used while decoding */
+typedef struct {
+  char *data;
+  size_t len;
+  size_t cap;
+} clog_binary_text_t;
+
+static bool clog_binary_reserve(clog_binary_text_t *text, size_t extra) {
+  if (text->len + extra + 1 <= text->cap)
+    return true;
+  size_t cap = text->cap ? text->cap : 256;
+  while (cap < text->len + extra + 1)
+    cap *= 2;
+  char *data = (char *)realloc(text->data, cap);
+  if (!data)
+    return false;
+  text->data = data;
+  text->cap = cap;
+  return true;
+}
+
+static void clog_binary_appendf(clog_binary_text_t *text, const char *spec,
+                                ...) {
+  va_list args, copy;
+  va_start(args, spec);
+  va_copy(copy, args);
+  int n = vsnprintf(NULL, 0, spec, copy);
+  va_end(copy);
+  if (n > 0 && clog_binary_reserve(text, (size_t)n)) {
+    vsnprintf(text->data + text->len, (size_t)n + 1, spec, args);
+    text->len += (size_t)n;
+  }
+  va_end(args);
+}
+
+/* Pulls n bytes of payload; zero-fills if the record is short */
+static void clog_binary_take(const unsigned char **p, const unsigned char *end,
+                             void *dst, size_t n) {
+  size_t avail = (size_t)(end - *p);
+  if (n > avail) {
+    memset(dst, 0, n);
+    n = avail;
+  }
+  memcpy(dst, *p, n);
+  *p += n;
+}
+
+/* Replays format against the recorded arguments, one conversion at a time */
+static void clog_binary_render(clog_binary_text_t *text, const char *format,
+                               const unsigned char *payload, size_t size) {
+  const unsigned char *p = payload;
+  const unsigned char *end = payload + size;
+  char spec_str[64];
+  text->len = 0;
+  clog_binary_reserve(text, 0);
+
+  for (const char *f = format; *f; f++) {
+    if (*f != '%') {
+      if (clog_binary_reserve(text, 1))
+        text->data[text->len++] = *f;
+      continue;
+    }
+    clog_binary_spec_t spec;
+    if (!clog_binary_parse_spec(f, &spec) ||
+        spec.spec_len >= sizeof(spec_str))
+      break;
+    memcpy(spec_str, f, spec.spec_len);
+    spec_str[spec.spec_len] = '\0';
+    f += spec.spec_len - 1;
+
+    int32_t stars[2] = {0, 0};
+    for (int i = 0; i < spec.stars; i++)
+      clog_binary_take(&p, end, &stars[i], sizeof(stars[i]));
+
+#define CLOG_BINARY_EMIT(value)                                                \
+  do {                                                                         \
+    if (spec.stars == 0)                                                       \
+      clog_binary_appendf(text, spec_str, value);                              \
+    else if (spec.stars == 1)                                                  \
+      clog_binary_appendf(text, spec_str, (int)stars[0], value);               \
+    else                                                                       \
+      clog_binary_appendf(text, spec_str, (int)stars[0], (int)stars[1],        \
+                          value);                                              \
+  } while (0)
+
+    bool is_signed = spec.conversion == 'd' || spec.conversion == 'i';
+    switch (clog_binary_arg_kind(&spec)) {
+    case CLOG_BINARY_ARG_INT: {
+      int32_t v;
+      clog_binary_take(&p, end, &v, sizeof(v));
+      CLOG_BINARY_EMIT((int)v);
+      break;
+    }
+    case CLOG_BINARY_ARG_INT64: {
+      uint64_t v;
+      clog_binary_take(&p, end, &v, sizeof(v));
+      switch (spec.length) {
+      case 'l':
+        if (is_signed)
+          CLOG_BINARY_EMIT((long)v);
+        else
+          CLOG_BINARY_EMIT((unsigned long)v);
+        break;
+      case 'j':
+        if (is_signed)
+          CLOG_BINARY_EMIT((intmax_t)v);
+        else
+          CLOG_BINARY_EMIT((uintmax_t)v);
+        break;
+      case 'z':
+        CLOG_BINARY_EMIT((size_t)v);
+        break;
+      case 't':
+        CLOG_BINARY_EMIT((ptrdiff_t)v);
+        break;
+      default:
+        if (is_signed)
+          CLOG_BINARY_EMIT((long long)v);
+        else
+          CLOG_BINARY_EMIT((unsigned long long)v);
+        break;
+      }
+      break;
+    }
+    case CLOG_BINARY_ARG_DOUBLE: {
+      double v;
+      clog_binary_take(&p, end, &v, sizeof(v));
+      CLOG_BINARY_EMIT(v);
+      break;
+    }
+    case CLOG_BINARY_ARG_LDOUBLE: {
+      long double v;
+      clog_binary_take(&p, end, &v, sizeof(v));
+      CLOG_BINARY_EMIT(v);
+      break;
+    }
+    case CLOG_BINARY_ARG_PTR: {
+      uint64_t v;
+      clog_binary_take(&p, end, &v, sizeof(v));
+      CLOG_BINARY_EMIT((void *)(uintptr_t)v);
+      break;
+    }
+    case CLOG_BINARY_ARG_STRING: {
+      uint32_t n;
+      clog_binary_take(&p, end, &n, sizeof(n));
+      if (n == CLOG_BINARY_NULL_STR) {
+        CLOG_BINARY_EMIT((const char *)NULL);
+        break;
+      }
+      if (n > (size_t)(end - p))
+        n = (uint32_t)(end - p);
+      char *str = (char *)malloc((size_t)n + 1);
+      if (!str)
+        break;
+      memcpy(str, p, n);
+      str[n] = '\0';
+      p += n;
+      CLOG_BINARY_EMIT(str);
+      free(str);
+      break;
+    }
+    default:
+      if (clog_binary_reserve(text, 1))
+        text->data[text->len++] = '%';
+      break;
+    }
+#undef CLOG_BINARY_EMIT
+  }
+  text->data[text->len] = '\0';
+}
+
+static bool clog_binary_read_str(FILE *in, char **out) {
+  uint32_t n;
+  *out = NULL;
+  if (fread(&n, sizeof(n), 1, in) != 1)
+    return false;
+  if (n == CLOG_BINARY_NULL_STR)
+    return true;
+  *out = (char *)malloc((size_t)n + 1);
+  if (!*out || fread(*out, 1, n, in) != n)
+    return false;
+  (*out)[n] = '\0';
+  return true;
+}
+
+static size_t clog_binary_format_line(char *dst, size_t size,
+                                      const clog_render_settings_t *settings,
+                                      clog_level_t level, const char *file,
+                                      int line, const char *func,
+                                      const struct timespec *when,
+                                      const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  size_t len = clog_render(dst, size, clog_output_format, level, file, line,
+                           func, NULL, 0, format, args, false, when, settings);
+  va_end(args);
+  return len;
+}
+
+CLOG_API bool clog_binary_decode(FILE *in, FILE *out) {
+  char magic[8];
+  uint32_t bom;
+  unsigned char header[8];
+  if (fread(magic, 1, 8, in) != 8 ||
+      memcmp(magic, CLOG_BINARY_MAGIC, 8) != 0 ||
+      fread(&bom, sizeof(bom), 1, in) != 1 || bom != 0x01020304u ||
+      fread(header, 1, sizeof(header), in) != sizeof(header) ||
+      header[0] != CLOG_BINARY_VERSION ||
+      header[6] != (unsigned char)sizeof(long double))
+    return false;
+
+  /* Render with the settings the stream was written with */
+  clog_render_settings_t settings;
+  settings.show_timestamp = header[1] != 0;
+  settings.show_location = header[2] != 0;
+  settings.time_precision = header[3];
+  settings.time_format = header[4];
+  settings.time_utc = header[5] != 0;
+
+  typedef struct {
+    char *format;
+    char *file;
+    char *func;
+    int line;
+  } decoded_site_t;
+  decoded_site_t *sites = NULL;
+  size_t site_count = 0;
+  clog_binary_text_t message = {NULL, 0, 0};
+  unsigned char *payload = NULL;
+  size_t payload_cap = 0;
+  char line_buf[CLOG_MAX_LINE_SIZE];
+  bool ok = true;
+  int type;
+
+  while (ok && (type = fgetc(in)) != EOF) {
+    if (type == CLOG_BINARY_SITE) {
+      uint32_t id;
+      int32_t line;
+      /* Writers never hand out ids past the site table; a larger one is
+       * corrupt and would wrap or balloon the table below */
+      ok = fread(&id, sizeof(id), 1, in) == 1 &&
+           fread(&line, sizeof(line), 1, in) == 1 &&
+           id < CLOG_BINARY_MAX_SITES;
+      if (ok && id >= site_count) {
+        decoded_site_t *grown =
+            (decoded_site_t *)realloc(sites, (id + 1) * sizeof(*sites));
+        ok = grown != NULL;
+        if (ok) {
+          memset(grown + site_count, 0, (id + 1 - site_count) * sizeof(*sites));
+          sites = grown;
+          site_count = id + 1;
+        }
+      }
+      if (ok) {
+        decoded_site_t *site = &sites[id];
+        free(site->format);
+        free(site->file);
+        free(site->func);
+        site->line = line;
+        ok = clog_binary_read_str(in, &site->format) &&
+             clog_binary_read_str(in, &site->file) &&
+             clog_binary_read_str(in, &site->func);
+      }
+    } else if (type == CLOG_BINARY_RECORD || type == CLOG_BINARY_TEXT) {
+      int level = fgetc(in);
+      struct timespec when;
+      int64_t sec;
+      uint32_t nsec;
+      ok = level != EOF;
+      if (ok && type == CLOG_BINARY_RECORD) {
+        uint32_t id, size;
+        ok = fread(&id, sizeof(id), 1, in) == 1 &&
+             fread(&sec, sizeof(sec), 1, in) == 1 &&
+             fread(&nsec, sizeof(nsec), 1, in) == 1 &&
+             fread(&size, sizeof(size), 1, in) == 1 && id < site_count &&
+             sites[id].format;
+        if (ok && size > payload_cap) {
+          unsigned char *grown = (unsigned char *)realloc(payload, size);
+          ok = grown != NULL;
+          if (ok) {
+            payload = grown;
+            payload_cap = size;
+          }
+        }
+        if (ok)
+          ok = fread(payload, 1, size, in) == size;
+        if (ok) {
+          when.tv_sec = (time_t)sec;
+          when.tv_nsec = (long)nsec;
+          clog_binary_render(&message, sites[id].format, payload, size);
+          size_t len = clog_binary_format_line(
+              line_buf, sizeof(line_buf), &settings, (clog_level_t)level,
+              sites[id].file, sites[id].line, sites[id].func, &when, "%s",
+              message.data);
+          fwrite(line_buf, 1, len, out);
+        }
+      } else if (ok) {
+        int32_t line;
+        char *text = NULL, *file = NULL, *func = NULL;
+        ok = fread(&sec, sizeof(sec), 1, in) == 1 &&
+             fread(&nsec, sizeof(nsec), 1, in) == 1 &&
+             fread(&line, sizeof(line), 1, in) == 1 &&
+             clog_binary_read_str(in, &text) &&
+             clog_binary_read_str(in, &file) &&
+             clog_binary_read_str(in, &func);
+        if (ok) {
+          when.tv_sec = (time_t)sec;
+          when.tv_nsec = (long)nsec;
+          size_t len = clog_binary_format_line(
+              line_buf, sizeof(line_buf), &settings, (clog_level_t)level,
+              file, line, func, &when, "%s", text ? text : "");
+          fwrite(line_buf, 1, len, out);
+        }
+        free(text);
+        free(file);
+        free(func);
+      }
+    } else {
+      ok = false;
+    }
+  }
+
+  for (size_t i = 0; i < site_count; i++) {
+    free(sites[i].format);
+    free(sites[i].file);
+    free(sites[i].func);
+  }
+  free(sites);
+  free(message.data);
+  free(payload);
+  return ok;
+}
+
+#if CLOG_HAS_BACKTRACE
+/* Keeps the return addresses above caller, the address a public entry
+ * point returns to, so the trace starts in the code that logged. A log
+ * call in tail position is compiled to a jump when optimizing, and the
+ * logging function then has no frame: the trace starts at its caller */
+static void clog_backtrace_capture(void *caller) {
+  void *frames[CLOG_BACKTRACE_DEPTH + 8];
+  int depth = backtrace(frames, CLOG_BACKTRACE_DEPTH + 8);
+  int skip = 0;
+  while (skip < depth && frames[skip] != caller)
+    skip++;
+  if (skip == depth)
+    skip = 0;
+  depth -= skip;
+  if (depth > CLOG_BACKTRACE_DEPTH)
+    depth = CLOG_BACKTRACE_DEPTH;
+  memcpy(clog_backtrace.frames, frames + skip,
+         (size_t)depth * sizeof(void *));
+  clog_backtrace.depth = depth;
+}
+
+#define CLOG_BACKTRACE_CAPTURE(level)                                          \
+  do {                                                                         \
+    if ((level) >= clog_backtrace_level)                                       \
+      clog_backtrace_capture(__builtin_return_address(0));                     \
+  } while (0)
+
+/* Renders one indented line per frame into dst, truncated at whole lines;
+ * resolved addresses come from the cache, and only misses call
+ * backtrace_symbols */
+static size_t clog_backtrace_render(char *dst, size_t size,
+                                    void *const *frames, int depth) {
+  size_t len = 0;
+  for (int i = 0; i < depth; i++) {
+    clog_backtrace_entry_t *entry =
+        &clog_backtrace_cache[((uintptr_t)frames[i] >> 4) &
+                              (CLOG_BACKTRACE_CACHE_SIZE - 1)];
+    char text[CLOG_BACKTRACE_FRAME_SIZE];
+    CLOG_MUTEX_LOCK(&clog_backtrace_mutex);
+    bool hit = entry->addr == frames[i];
+    if (hit)
+      memcpy(text, entry->text, sizeof(text));
+    CLOG_MUTEX_UNLOCK(&clog_backtrace_mutex);
+    if (!hit) {
+      char **names = backtrace_symbols(&frames[i], 1);
+      if (names)
+        snprintf(text, sizeof(text), "%s", names[0]);
+      else
+        snprintf(text, sizeof(text), "%p", frames[i]);
+      free(names);
+      CLOG_MUTEX_LOCK(&clog_backtrace_mutex);
+      entry->addr = frames[i];
+      memcpy(entry->text, text, sizeof(text));
+      CLOG_MUTEX_UNLOCK(&clog_backtrace_mutex);
+    }
+    int n = snprintf(dst + len, size - len, "    #%d %s\n", i, text);
+    if (n < 0 || (size_t)n >= size - len)
+      break;
+    len += (size_t)n;
+  }
+  return len;
+}
+
+/* Renders the main output's line followed by its trace into the thread's
+ * trace buffer; rendered, if not NULL, is the line already formatted */
+static size_t clog_backtrace_attach(clog_level_t level, const char *file,
+                                    int line, const char *func,
+                                    const clog_field_t *fields,
+                                    size_t nfields, const char *format,
+                                    va_list args, const char *rendered,
+                                    size_t rendered_len,
+                                    const struct timespec *when) {
+  char *dst = clog_backtrace.text;
+  size_t len = rendered_len;
+  if (rendered) {
+    memcpy(dst, rendered, rendered_len);
+  } else {
+    va_list copy;
+    va_copy(copy, args);
+    len = clog_format_record(dst, CLOG_MAX_LINE_SIZE, level, file, line, func,
+                             fields, nfields, format, copy,
+                             clog_use_ansi_colors(), when);
+    va_end(copy);
+  }
+  return len + clog_backtrace_render(dst + len,
+                                     sizeof(clog_backtrace.text) - len,
+                                     clog_backtrace.frames,
+                                     clog_backtrace.depth);
+}
+#else
+#define CLOG_BACKTRACE_CAPTURE(level) ((void)0)
+#endif
+
+CLOG_API bool clog_set_backtrace(clog_level_t level) {
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+#if CLOG_HAS_BACKTRACE
+  /* The first backtrace() call loads the unwinder: pay for it here */
+  void *frame;
+  backtrace(&frame, 1);
+  clog_backtrace_level = level;
+  return true;
+#else
+  return level == CLOG_BACKTRACE_OFF;
+#endif
+}
+
+#if CLOG_HAS_ASYNC
+#if CLOG_WINDOWS
+static DWORD WINAPI clog_async_writer(LPVOID arg);
+#else
+static void *clog_async_writer(void *arg);
+#endif
+
+static void clog_sleep_us(unsigned int us) {
+#if CLOG_WINDOWS
+  Sleep(us < 1000 ? 1 : us / 1000);
+#else
+  struct timespec ts;
+  ts.tv_sec = us / 1000000;
+  ts.tv_nsec = (long)(us % 1000000) * 1000;
+  nanosleep(&ts, NULL);
+#endif
+}
+
+static void clog_async_signal(void) {
+#if CLOG_WINDOWS
+  EnterCriticalSection(&clog_async.park_mutex);
+  WakeConditionVariable(&clog_async.park_cond);
+  LeaveCriticalSection(&clog_async.park_mutex);
+#else
+  pthread_mutex_lock(&clog_async.park_mutex);
+  pthread_cond_signal(&clog_async.park_cond);
+  pthread_mutex_unlock(&clog_async.park_mutex);
+#endif
+}
+
+/* Wakes the writer only if it is parked, so producers stay syscall-free */
+static void clog_async_wake(void) {
+  /* Pairs with the fence in clog_async_park: either the writer sees our
+   * record or we see that it is about to park, so no wakeup is lost */
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&clog_async.sleeping, memory_order_relaxed))
+    clog_async_signal();
+}
+
+/* Claims the slot at the head of the queue, or NULL when it is full */
+static clog_async_slot_t *clog_async_reserve(size_t *out_pos) {
+  size_t mask = CLOG_ASYNC_QUEUE_SIZE - 1;
+  size_t pos =
+      atomic_load_explicit(&clog_async.enqueue_pos, memory_order_relaxed);
+  for (;;) {
+    clog_async_slot_t *slot = &clog_async.slots[pos & mask];
+    size_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)pos;
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(
+              &clog_async.enqueue_pos, &pos, pos + 1, memory_order_relaxed,
+              memory_order_relaxed)) {
+        *out_pos = pos;
+        return slot;
+      }
+    } else if (diff < 0) {
+      return NULL;
+    } else {
+      pos = atomic_load_explicit(&clog_async.enqueue_pos,
+                                 memory_order_relaxed);
+    }
+  }
+}
+
+/* Claims the oldest published slot, or NULL when none is ready */
+static clog_async_slot_t *clog_async_claim(size_t *out_pos) {
+  size_t mask = CLOG_ASYNC_QUEUE_SIZE - 1;
+  size_t pos =
+      atomic_load_explicit(&clog_async.dequeue_pos, memory_order_relaxed);
+  for (;;) {
+    clog_async_slot_t *slot = &clog_async.slots[pos & mask];
+    size_t seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    ptrdiff_t diff = (ptrdiff_t)seq - (ptrdiff_t)(pos + 1);
+    if (diff == 0) {
+      if (atomic_compare_exchange_weak_explicit(
+              &clog_async.dequeue_pos, &pos, pos + 1, memory_order_relaxed,
+              memory_order_relaxed)) {
+        *out_pos = pos;
+        return slot;
+      }
+    } else if (diff < 0) {
+      return NULL;
+    } else {
+      pos = atomic_load_explicit(&clog_async.dequeue_pos,
+                                 memory_order_relaxed);
+    }
+  }
+}
+
+/* Hands a claimed slot back to producers */
+static void clog_async_release(clog_async_slot_t *slot, size_t pos) {
+  atomic_store_explicit(&slot->sequence, pos + CLOG_ASYNC_QUEUE_SIZE,
+                        memory_order_release);
+  atomic_fetch_add_explicit(&clog_async.completed, 1, memory_order_release);
+}
+
+/* Queues a record; rendered, if not NULL, is the line already formatted */
+static bool clog_async_push(clog_level_t level, const char *file, int line,
+                            const char *func, const clog_field_t *fields,
+                            size_t nfields, const char *format, va_list args,
+                            const char *rendered, size_t rendered_len) {
+  /* A line that already carries its trace doesn't fit a slot */
+  if (rendered_len > CLOG_MAX_LINE_SIZE)
+    return false;
+  atomic_fetch_add(&clog_async.producers, 1);
+  if (!atomic_load(&clog_async.active)) {
+    atomic_fetch_sub(&clog_async.producers, 1);
+    return false;
+  }
+
+  size_t pos;
+  unsigned int spins = 0;
+  clog_async_slot_t *slot;
+  while ((slot = clog_async_reserve(&pos)) == NULL) {
+    clog_overflow_t policy = (clog_overflow_t)atomic_load_explicit(
+        &clog_async.overflow, memory_order_relaxed);
+    if (policy == CLOG_OVERFLOW_DROP_NEWEST) {
+      atomic_fetch_add_explicit(&clog_async.dropped_newest, 1,
+                                memory_order_relaxed);
+      atomic_fetch_sub(&clog_async.producers, 1);
+      return true;
+    }
+    if (policy == CLOG_OVERFLOW_DROP_OLDEST) {
+      size_t old_pos;
+      clog_async_slot_t *old = clog_async_claim(&old_pos);
+      if (old) {
+        clog_async_release(old, old_pos);
+        atomic_fetch_add_explicit(&clog_async.dropped_oldest, 1,
+                                  memory_order_relaxed);
+        continue;
+      }
+    }
+    /* Blocking, or the oldest record is still being written: back off */
+    if (spins++ == 0)
+      atomic_fetch_add_explicit(&clog_async.blocked, 1, memory_order_relaxed);
+    clog_async_wake();
+    if (spins < 16) {
+#if CLOG_WINDOWS
+      SwitchToThread();
+#else
+      sched_yield();
+#endif
+    } else {
+      clog_sleep_us(50);
+    }
+  }
+
+  slot->level = level;
+  if (rendered) {
+    memcpy(slot->data, rendered, rendered_len);
+    slot->len = rendered_len;
+  } else {
+    slot->len = clog_format_record(slot->data, sizeof(slot->data), level,
+                                   file, line, func, fields, nfields, format,
+                                   args, clog_use_ansi_colors(), NULL);
+  }
+#if CLOG_HAS_BACKTRACE
+  slot->depth = clog_output_format == CLOG_FORMAT_TEXT ? clog_backtrace.depth
+                                                       : 0;
+  memcpy(slot->frames, clog_backtrace.frames,
+         (size_t)slot->depth * sizeof(void *));
+#endif
+  atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+  atomic_fetch_add_explicit(&clog_async.enqueued, 1, memory_order_relaxed);
+  clog_async_wake();
+  atomic_fetch_sub(&clog_async.producers, 1);
+  return true;
+}
+
+/* Writes up to one batch of queued records with a single flush */
+static size_t clog_async_drain(void) {
+  size_t count = 0;
+  size_t pos;
+  clog_async_slot_t *slot;
+  bool flush = false;
+#if CLOG_HAS_BACKTRACE
+  /* Traces are symbolized here, off the logging threads */
+  static CLOG_THREAD_LOCAL char trace[CLOG_BACKTRACE_TEXT_SIZE];
+#endif
+
+  CLOG_MUTEX_LOCK(&clog_mutex);
+#if CLOG_POSIX
+  /* Raw fd without buffering: hand the queued slots to one writev */
+  if (clog_output_fd >= 0 && !clog_out_buf &&
+      !atomic_load_explicit(&clog_mmap_current, memory_order_relaxed)) {
+    struct iovec iov[CLOG_ASYNC_BATCH_SIZE + 1];
+    clog_async_slot_t *claimed[CLOG_ASYNC_BATCH_SIZE];
+    size_t positions[CLOG_ASYNC_BATCH_SIZE];
+    size_t total = 0;
+    int niov = 0;
+    while (count < CLOG_ASYNC_BATCH_SIZE &&
+           (slot = clog_async_claim(&positions[count])) != NULL) {
+      claimed[count] = slot;
+      iov[niov].iov_base = slot->data;
+      iov[niov].iov_len = slot->len;
+      total += slot->len;
+      niov++;
+      count++;
+#if CLOG_HAS_BACKTRACE
+      /* One trace per writev, since they share the buffer */
+      if (slot->depth) {
+        iov[niov].iov_base = trace;
+        iov[niov].iov_len = clog_backtrace_render(trace, sizeof(trace),
+                                                  slot->frames, slot->depth);
+        total += iov[niov].iov_len;
+        niov++;
+        break;
+      }
+#endif
+    }
+#if CLOG_HAS_ROTATE
+    if (count)
+      clog_rotate_account(total);
+#endif
+    if (count) {
+#ifdef CLOG_STATS
+      uint64_t start = clog_now_ns();
+      bool ok = clog_fd_writev(clog_output_fd, iov, niov);
+      clog_stat_write(total, ok, start);
+#else
+      clog_fd_writev(clog_output_fd, iov, niov);
+#endif
+    }
+    for (size_t i = 0; i < count; i++)
+      clog_async_release(claimed[i], positions[i]);
+  }
+#endif
+  while (count < CLOG_ASYNC_BATCH_SIZE &&
+         (slot = clog_async_claim(&pos)) != NULL) {
+    flush |= clog_buffer_line(slot->level, slot->data, slot->len);
+#if CLOG_HAS_BACKTRACE
+    if (slot->depth)
+      flush |= clog_buffer_line(
+          slot->level, trace,
+          clog_backtrace_render(trace, sizeof(trace), slot->frames,
+                                slot->depth));
+#endif
+    clog_async_release(slot, pos);
+    count++;
+  }
+  /* Even in flush-every-line mode the writer only flushes once per batch */
+  if (flush || (!count && clog_flush_interval_due()))
+    clog_flush_output();
+  CLOG_MUTEX_UNLOCK(&clog_mutex);
+
+  if (count)
+    atomic_fetch_add_explicit(&clog_async.written, count,
+                              memory_order_relaxed);
+  return count;
+}
+
+static void clog_async_park(void) {
+  size_t mask = CLOG_ASYNC_QUEUE_SIZE - 1;
+#if CLOG_WINDOWS
+  EnterCriticalSection(&clog_async.park_mutex);
+#else
+  pthread_mutex_lock(&clog_async.park_mutex);
+#endif
+  atomic_store_explicit(&clog_async.sleeping, true, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+
+  size_t pos =
+      atomic_load_explicit(&clog_async.dequeue_pos, memory_order_relaxed);
+  size_t seq = atomic_load_explicit(&clog_async.slots[pos & mask].sequence,
+                                    memory_order_acquire);
+  if (seq != pos + 1 && !atomic_load(&clog_async.stop)) {
+#if CLOG_WINDOWS
+    SleepConditionVariableCS(&clog_async.park_cond, &clog_async.park_mutex,
+                             CLOG_ASYNC_IDLE_MS);
+#else
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += (long)CLOG_ASYNC_IDLE_MS * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+    pthread_cond_timedwait(&clog_async.park_cond, &clog_async.park_mutex,
+                           &deadline);
+#endif
+  }
+
+  atomic_store_explicit(&clog_async.sleeping, false, memory_order_relaxed);
+#if CLOG_WINDOWS
+  LeaveCriticalSection(&clog_async.park_mutex);
+#else
+  pthread_mutex_unlock(&clog_async.park_mutex);
+#endif
+}
+
+#if CLOG_WINDOWS
+static DWORD WINAPI clog_async_writer(LPVOID arg) {
+#else
+static void *clog_async_writer(void *arg) {
+#endif
+  (void)arg;
+  for (;;) {
+    if (clog_async_drain())
+      continue;
+    if (atomic_load(&clog_async.stop) &&
+        atomic_load(&clog_async.completed) ==
+            atomic_load(&clog_async.enqueue_pos))
+      break;
+    /* A short yield loop catches bursts without paying for a park */
+    bool ready = false;
+    for (int i = 0; i < 8 && !ready; i++) {
+#if CLOG_WINDOWS
+      SwitchToThread();
+#else
+      sched_yield();
+#endif
+      size_t pos =
+          atomic_load_explicit(&clog_async.dequeue_pos, memory_order_relaxed);
+      ready = atomic_load_explicit(
+                  &clog_async.slots[pos & (CLOG_ASYNC_QUEUE_SIZE - 1)].sequence,
+                  memory_order_acquire) == pos + 1;
+    }
+    if (!ready)
+      clog_async_park();
+  }
+#if CLOG_WINDOWS
+  return 0;
+#else
+  return NULL;
+#endif
+}
+
+CLOG_API bool clog_set_async(bool enable) {
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  if (enable) {
+    if (atomic_load(&clog_async.active))
+      return true;
+
+    clog_async_slot_t *slots =
+        (clog_async_slot_t *)calloc(CLOG_ASYNC_QUEUE_SIZE, sizeof(*slots));
+    if (!slots)
+      return false;
+    for (size_t i = 0; i < CLOG_ASYNC_QUEUE_SIZE; i++)
+      atomic_init(&slots[i].sequence, i);
+    clog_async.slots = slots;
+    atomic_store(&clog_async.enqueue_pos, 0);
+    atomic_store(&clog_async.dequeue_pos, 0);
+    atomic_store(&clog_async.completed, 0);
+    atomic_store(&clog_async.stop, false);
+    atomic_store(&clog_async.sleeping, false);
+
+#if CLOG_WINDOWS
+    InitializeCriticalSection(&clog_async.park_mutex);
+    InitializeConditionVariable(&clog_async.park_cond);
+    clog_async.thread = CreateThread(NULL, 0, clog_async_writer, NULL, 0, NULL);
+    bool started = clog_async.thread != NULL;
+#else
+    pthread_mutex_init(&clog_async.park_mutex, NULL);
+    pthread_cond_init(&clog_async.park_cond, NULL);
+    bool started =
+        pthread_create(&clog_async.thread, NULL, clog_async_writer, NULL) == 0;
+#endif
+    if (!started) {
+      free(slots);
+      clog_async.slots = NULL;
+      return false;
+    }
+    atomic_store(&clog_async.active, true);
     return true;
-  case CLOG_COLOR_AUTO:
-  default:
+  }
+
+  if (!atomic_load(&clog_async.active))
+    return true;
+
+  /* New records go through the synchronous path from here on; wait for the
+   * producers already inside the queue, then let the writer drain it */
+  atomic_store(&clog_async.active, false);
+  while (atomic_load(&clog_async.producers) != 0)
+    clog_sleep_us(50);
+  atomic_store(&clog_async.stop, true);
+  clog_async_signal();
 #if CLOG_WINDOWS
-    return clog_is_console_output(output);
+  WaitForSingleObject(clog_async.thread, INFINITE);
+  CloseHandle(clog_async.thread);
+  DeleteCriticalSection(&clog_async.park_mutex);
 #else
-    return isatty(fileno(output));
+  pthread_join(clog_async.thread, NULL);
+  pthread_mutex_destroy(&clog_async.park_mutex);
+  pthread_cond_destroy(&clog_async.park_cond);
 #endif
+  free(clog_async.slots);
+  clog_async.slots = NULL;
+  return true;
+}
+
+CLOG_API void clog_set_async_overflow(clog_overflow_t policy) {
+  atomic_store(&clog_async.overflow, (int)policy);
+}
+
+CLOG_API void clog_get_async_stats(clog_async_stats_t *stats) {
+  if (!stats)
+    return;
+  stats->enqueued = atomic_load(&clog_async.enqueued);
+  stats->written = atomic_load(&clog_async.written);
+  stats->dropped_newest = atomic_load(&clog_async.dropped_newest);
+  stats->dropped_oldest = atomic_load(&clog_async.dropped_oldest);
+  stats->blocked = atomic_load(&clog_async.blocked);
+}
+
+/* Waits until the writer thread has written every record queued so far */
+static void clog_async_settle(void) {
+  atomic_fetch_add(&clog_async.producers, 1);
+  if (atomic_load(&clog_async.active)) {
+    size_t target = atomic_load(&clog_async.enqueue_pos);
+    while (atomic_load_explicit(&clog_async.completed, memory_order_acquire) <
+           target) {
+      clog_async_wake();
+      clog_sleep_us(100);
+    }
   }
+  atomic_fetch_sub(&clog_async.producers, 1);
 }
 
-static bool clog_use_ansi_colors(void) {
-  if (!clog_should_use_colors())
+CLOG_API void clog_flush(void) {
+  if (!atomic_load(&clog_is_initialized))
+    return;
+
+  clog_async_settle();
+
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  clog_flush_output();
+  CLOG_MUTEX_UNLOCK(&clog_mutex);
+  clog_sinks_flush();
+}
+#else
+CLOG_API bool clog_set_async(bool enable) { return !enable; }
+
+CLOG_API void clog_set_async_overflow(clog_overflow_t policy) { (void)policy; }
+
+CLOG_API void clog_get_async_stats(clog_async_stats_t *stats) {
+  if (stats)
+    memset(stats, 0, sizeof(*stats));
+}
+
+CLOG_API void clog_flush(void) {
+  if (!atomic_load(&clog_is_initialized))
+    return;
+
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  clog_flush_output();
+  CLOG_MUTEX_UNLOCK(&clog_mutex);
+  clog_sinks_flush();
+}
+#endif
+
+#if CLOG_HAS_BATCH
+/* Writes the collected lines with one lock and one write, leaving the
+ * batch open and empty */
+static void clog_batch_publish(void) {
+  if (!clog_batch.len)
+    return;
+#if CLOG_HAS_ASYNC
+  /* Records this thread queued before the batch go out first */
+  clog_async_settle();
+#endif
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  if (clog_buffer_line(clog_batch.level, clog_batch.data, clog_batch.len))
+    clog_flush_output();
+  CLOG_MUTEX_UNLOCK(&clog_mutex);
+  clog_batch.len = 0;
+  clog_batch.level = CLOG_TRACE;
+}
+
+/* Adds a record for the main output to the open batch; rendered, if not
+ * NULL, is the line already formatted with the batch's timestamp */
+static void clog_batch_append(clog_level_t level, const char *file, int line,
+                              const char *func, const clog_field_t *fields,
+                              size_t nfields, const char *format,
+                              va_list args, const char *rendered,
+                              size_t rendered_len) {
+  size_t need = rendered ? rendered_len : CLOG_MAX_LINE_SIZE;
+  if (CLOG_BATCH_SIZE - clog_batch.len < need)
+    clog_batch_publish();
+  /* A line with a long trace may not fit even an empty arena */
+  if (need > CLOG_BATCH_SIZE) {
+    CLOG_MUTEX_LOCK(&clog_mutex);
+    if (clog_buffer_line(level, rendered, rendered_len))
+      clog_flush_output();
+    CLOG_MUTEX_UNLOCK(&clog_mutex);
+    return;
+  }
+  char *dst = clog_batch.data + clog_batch.len;
+  if (rendered) {
+    memcpy(dst, rendered, rendered_len);
+    clog_batch.len += rendered_len;
+  } else {
+    clog_batch.len += clog_format_record(
+        dst, CLOG_MAX_LINE_SIZE, level, file, line, func, fields, nfields,
+        format, args, clog_use_ansi_colors(), &clog_batch.when);
+  }
+  if (level > clog_batch.level)
+    clog_batch.level = level;
+  /* FATAL usually precedes an exit: don't leave it in the batch */
+  if (level == CLOG_FATAL)
+    clog_batch_publish();
+}
+#endif
+
+CLOG_API bool clog_batch_begin(void) {
+#if CLOG_HAS_BATCH
+  if (clog_batch.open)
     return false;
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+  if (!clog_clock_now(&clog_batch.when))
+    memset(&clog_batch.when, 0, sizeof(clog_batch.when));
+  clog_batch.len = 0;
+  clog_batch.level = CLOG_TRACE;
+  clog_batch.open = true;
+  return true;
+#else
+  return false;
+#endif
+}
 
-  switch (clog_color_mode) {
-  case CLOG_COLOR_ANSI:
-    return true;
-  case CLOG_COLOR_WIN32:
+CLOG_API void clog_batch_add(clog_level_t level, const char *file, int line,
+                             const char *func, const char *format, ...) {
+  if (!CLOG_ENABLED(level)) {
+    CLOG_STAT_LEVEL(CLOG_STAT_FILTERED, level);
+    return;
+  }
+  CLOG_BACKTRACE_CAPTURE(level);
+
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  va_list args;
+  va_start(args, format);
+  clog_log_impl(level, file, line, func, NULL, 0, format, args);
+  va_end(args);
+}
+
+CLOG_API bool clog_batch_commit(void) {
+#if CLOG_HAS_BATCH
+  if (!clog_batch.open)
     return false;
-  case CLOG_COLOR_AUTO:
-  case CLOG_COLOR_ALWAYS:
-  default:
-#if CLOG_WINDOWS
-    return true;
+  clog_batch_publish();
+  clog_batch.open = false;
+  return true;
 #else
-    return true;
+  return false;
+#endif
+}
+
+CLOG_API void clog_get_stats(clog_stats_t *stats) {
+  if (!stats)
+    return;
+  memset(stats, 0, sizeof(*stats));
+#ifdef CLOG_STATS
+  for (int level = 0; level <= CLOG_FATAL; level++) {
+    stats->emitted[level] = clog_stat_sum(CLOG_STAT_EMITTED + level);
+    stats->filtered[level] = clog_stat_sum(CLOG_STAT_FILTERED + level);
+  }
+  stats->bytes_written = clog_stat_sum(CLOG_STAT_BYTES);
+  stats->truncated = clog_stat_sum(CLOG_STAT_TRUNCATED);
+  stats->writes = clog_stat_sum(CLOG_STAT_WRITES);
+  stats->write_errors = clog_stat_sum(CLOG_STAT_WRITE_ERRORS);
+  stats->write_ns = clog_stat_sum(CLOG_STAT_WRITE_NS);
+#endif
+  clog_get_lock_stats(&stats->lock);
+}
+
+CLOG_API void clog_reset_stats(void) {
+#ifdef CLOG_LOCK_STATS
+  for (int i = 0; i < CLOG_STATS_SHARDS; i++) {
+    for (int counter = 0; counter < CLOG_STAT_COUNT; counter++)
+      atomic_store_explicit(&clog_stats_shards[i].counters[counter], 0,
+                            memory_order_relaxed);
+  }
+#endif
+}
+
+CLOG_API void clog_get_lock_stats(clog_lock_stats_t *stats) {
+  if (!stats)
+    return;
+#ifdef CLOG_LOCK_STATS
+  stats->acquisitions = clog_stat_sum(CLOG_STAT_LOCK_ACQUISITIONS);
+  stats->spins = clog_stat_sum(CLOG_STAT_LOCK_SPINS);
+  stats->parks = clog_stat_sum(CLOG_STAT_LOCK_PARKS);
+  stats->wait_ns = clog_stat_sum(CLOG_STAT_LOCK_WAIT_NS);
+#else
+  memset(stats, 0, sizeof(*stats));
 #endif
+}
+
+#if CLOG_HAS_CONTROL
+/* Copies the pipeline and async counters into the control block */
+static void clog_control_publish(clog_control_t *block) {
+  clog_stats_t stats;
+  clog_async_stats_t async;
+  clog_get_stats(&stats);
+  clog_get_async_stats(&async);
+  for (int level = 0; level <= CLOG_FATAL; level++) {
+    atomic_store_explicit(&block->emitted[level], stats.emitted[level],
+                          memory_order_relaxed);
+    atomic_store_explicit(&block->filtered[level], stats.filtered[level],
+                          memory_order_relaxed);
   }
+  atomic_store_explicit(&block->bytes_written, stats.bytes_written,
+                        memory_order_relaxed);
+  atomic_store_explicit(&block->truncated, stats.truncated,
+                        memory_order_relaxed);
+  atomic_store_explicit(&block->write_errors, stats.write_errors,
+                        memory_order_relaxed);
+  atomic_store_explicit(&block->dropped,
+                        async.dropped_newest + async.dropped_oldest,
+                        memory_order_relaxed);
+  atomic_store_explicit(&block->blocked, async.blocked, memory_order_relaxed);
+  atomic_fetch_add_explicit(&block->publishes, 1, memory_order_release);
 }
 
-static void clog_log_impl(clog_level_t level, const char *file, int line,
-                          const char *func, const char *format, va_list args) {
-  static char time_buf[CLOG_MAX_TIME_SIZE];
-  static char message_buf[CLOG_MAX_MESSAGE_SIZE];
-  static char location_buf[CLOG_MAX_LOCATION_SIZE];
-  static char final_buf[CLOG_MAX_MESSAGE_SIZE + CLOG_MAX_TIME_SIZE +
-                        CLOG_MAX_LOCATION_SIZE + 256];
+/* Applies level requests and refreshes the counters every
+ * CLOG_CONTROL_INTERVAL_MS; the log path never touches the block */
+static void *clog_control_thread(void *arg) {
+  clog_control_t *block = (clog_control_t *)arg;
+  pthread_mutex_lock(&clog_control.park_mutex);
+  while (!clog_control.stop) {
+    pthread_mutex_unlock(&clog_control.park_mutex);
+    int requested =
+        atomic_exchange(&block->requested_level, CLOG_CONTROL_NO_REQUEST);
+    if (requested >= CLOG_TRACE && requested <= CLOG_FATAL)
+      clog_set_level((clog_level_t)requested);
+    clog_control_publish(block);
 
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += (long)CLOG_CONTROL_INTERVAL_MS * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+    pthread_mutex_lock(&clog_control.park_mutex);
+    if (!clog_control.stop)
+      pthread_cond_timedwait(&clog_control.park_cond, &clog_control.park_mutex,
+                             &deadline);
+  }
+  pthread_mutex_unlock(&clog_control.park_mutex);
+  return NULL;
+}
+
+CLOG_API bool clog_set_control(bool enable) {
   if (!atomic_load(&clog_is_initialized))
     clog_init();
 
-  CLOG_MUTEX_LOCK(&clog_mutex);
+  clog_control_t *block = clog_control.block;
+  if (!enable) {
+    if (!block)
+      return true;
+    CLOG_MUTEX_LOCK(&clog_sink_mutex);
+    clog_control.block = NULL;
+    CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
 
-  clog_format_time(time_buf, sizeof(time_buf));
+    pthread_mutex_lock(&clog_control.park_mutex);
+    clog_control.stop = true;
+    pthread_cond_signal(&clog_control.park_cond);
+    pthread_mutex_unlock(&clog_control.park_mutex);
+    pthread_join(clog_control.thread, NULL);
+    pthread_mutex_destroy(&clog_control.park_mutex);
+    pthread_cond_destroy(&clog_control.park_cond);
 
-  vsnprintf(message_buf, sizeof(message_buf), format, args);
+    /* Readers that still map the file see it as gone */
+    atomic_store(&block->magic, 0);
+    munmap(block, sizeof(*block));
+    unlink(clog_control.path);
+    return true;
+  }
+  if (block)
+    return true;
 
-  location_buf[0] = '\0';
-  if (clog_show_location && file && line > 0 && func) {
-    snprintf(location_buf, sizeof(location_buf), " (%s:%d in %s)",
-             clog_basename(file), line, func);
+  snprintf(clog_control.path, sizeof(clog_control.path), "%s/clog.%ld",
+           CLOG_CONTROL_DIR, (long)getpid());
+  int fd = open(clog_control.path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                0600);
+  if (fd < 0)
+    return false;
+  if (ftruncate(fd, (off_t)sizeof(*block)) != 0) {
+    close(fd);
+    unlink(clog_control.path);
+    return false;
+  }
+  void *map = mmap(NULL, sizeof(*block), PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    unlink(clog_control.path);
+    return false;
   }
+  block = (clog_control_t *)map;
+  block->version = CLOG_CONTROL_VERSION;
+  block->pid = (int64_t)getpid();
+  atomic_store(&block->requested_level, CLOG_CONTROL_NO_REQUEST);
+  clog_control_publish(block);
 
-  bool use_ansi = clog_use_ansi_colors();
+  clog_control.stop = false;
+  pthread_mutex_init(&clog_control.park_mutex, NULL);
+  pthread_cond_init(&clog_control.park_cond, NULL);
+  CLOG_MUTEX_LOCK(&clog_sink_mutex);
+  clog_control.block = block;
+  clog_update_min_level();
+  CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+  if (pthread_create(&clog_control.thread, NULL, clog_control_thread, block) !=
+      0) {
+    CLOG_MUTEX_LOCK(&clog_sink_mutex);
+    clog_control.block = NULL;
+    CLOG_MUTEX_UNLOCK(&clog_sink_mutex);
+    pthread_mutex_destroy(&clog_control.park_mutex);
+    pthread_cond_destroy(&clog_control.park_cond);
+    munmap(block, sizeof(*block));
+    unlink(clog_control.path);
+    return false;
+  }
+  /* clogctl ignores the block until the magic number is in place */
+  atomic_store_explicit(&block->magic, CLOG_CONTROL_MAGIC,
+                        memory_order_release);
+  return true;
+}
+#else
+CLOG_API bool clog_set_control(bool enable) { return !enable; }
+#endif
 
-  size_t len = 0;
+CLOG_API void clog_log(clog_level_t level, const char *file, int line,
+                       const char *func, const char *format, ...) {
+  if (!CLOG_ENABLED(level)) {
+    CLOG_STAT_LEVEL(CLOG_STAT_FILTERED, level);
+    return;
+  }
+  CLOG_BACKTRACE_CAPTURE(level);
 
-  if (clog_show_timestamp) {
-    if (use_ansi) {
-      len += snprintf(final_buf + len, sizeof(final_buf) - len, "%s%s%s ",
-                      CLOG_BOLD, time_buf, CLOG_NO_BOLD);
-    } else {
-      len +=
-          snprintf(final_buf + len, sizeof(final_buf) - len, "%s ", time_buf);
-    }
+  if (!atomic_load(&clog_is_initialized)) {
+    clog_init();
   }
 
-  if (use_ansi) {
-    len += snprintf(final_buf + len, sizeof(final_buf) - len, "%s[%s]%s ",
-                    clog_level_color_ansi(level), clog_level_string(level),
-                    CLOG_RESET);
-  } else {
-    len += snprintf(final_buf + len, sizeof(final_buf) - len, "[%s] ",
-                    clog_level_string(level));
+  va_list args;
+  va_start(args, format);
+  clog_log_impl(level, file, line, func, NULL, 0, format, args);
+  va_end(args);
+}
+
+CLOG_API void clog_log_fields(clog_level_t level, const char *file, int line,
+                              const char *func, const clog_field_t *fields,
+                              size_t nfields, const char *format, ...) {
+  if (!CLOG_ENABLED(level)) {
+    CLOG_STAT_LEVEL(CLOG_STAT_FILTERED, level);
+    return;
   }
+  CLOG_BACKTRACE_CAPTURE(level);
 
-  len += snprintf(final_buf + len, sizeof(final_buf) - len, "%s", message_buf);
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
 
-  if (clog_show_location && location_buf[0] != '\0') {
-    if (use_ansi) {
-      len += snprintf(final_buf + len, sizeof(final_buf) - len, " %s%s%s",
-                      CLOG_DIM, location_buf, CLOG_RESET);
-    } else {
-      len += snprintf(final_buf + len, sizeof(final_buf) - len, " %s",
-                      location_buf);
-    }
+  va_list args;
+  va_start(args, format);
+  clog_log_impl(level, file, line, func, fields, nfields, format, args);
+  va_end(args);
+}
+
+/* Renders the record and hands it to the outputs; output_level stands in
+ * for the main output's level, which a category may override */
+static void clog_log_write(clog_level_t level, clog_level_t output_level,
+                           const char *file, int line, const char *func,
+                           const clog_field_t *fields, size_t nfields,
+                           const char *format, va_list args) {
+  /* Each thread renders into its own buffer, so only the write is locked */
+  static CLOG_THREAD_LOCAL char final_buf[CLOG_MAX_LINE_SIZE];
+  /* The main output's line when the sinks already rendered its layout */
+  const char *rendered = NULL;
+  size_t rendered_len = 0;
+
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+#if CLOG_HAS_TLS
+  if (atomic_load_explicit(&clog_sink_count, memory_order_relaxed)) {
+    clog_record_t rec;
+    rec.level = level;
+    rec.file = file;
+    rec.line = line;
+    rec.func = func;
+    rec.fields = fields;
+    rec.nfields = nfields;
+    rec.format = format;
+    rec.rendered = 0;
+#if CLOG_HAS_BATCH
+    if (clog_batch.open)
+      rec.when = clog_batch.when;
+    else if (!clog_clock_now(&rec.when))
+      memset(&rec.when, 0, sizeof(rec.when));
+#else
+    if (!clog_clock_now(&rec.when))
+      memset(&rec.when, 0, sizeof(rec.when));
+#endif
+    va_copy(rec.args, args);
+    clog_sinks_write(&rec);
+    if (level >= output_level && !clog_binary_output)
+      rendered = clog_record_line(&rec, clog_output_format,
+                                  clog_use_ansi_colors(), &rendered_len);
+    va_end(rec.args);
+  }
+#endif
+  if (level < output_level) {
+#if CLOG_HAS_RECORDER
+    if (level >= clog_recorder_level)
+      clog_recorder_capture(level, file, line, func, fields, nfields, format,
+                            args);
+#endif
+    return;
   }
 
-  len += snprintf(final_buf + len, sizeof(final_buf) - len, "\n");
+  if (clog_binary_output) {
+    clog_binary_log(level, file, line, func, fields, nfields, format, args);
+    return;
+  }
 
-#if CLOG_WINDOWS
-  if (!use_ansi && clog_should_use_colors()) {
-    clog_set_console_color(level);
+#if CLOG_HAS_BACKTRACE
+  /* Without the writer thread the trace is symbolized now and goes out in
+   * the same write as its line */
+  if (clog_backtrace.depth && clog_output_format == CLOG_FORMAT_TEXT
+#if CLOG_HAS_ASYNC
+      && !atomic_load_explicit(&clog_async.active, memory_order_relaxed)
+#endif
+  ) {
+    rendered_len = clog_backtrace_attach(
+        level, file, line, func, fields, nfields, format, args, rendered,
+        rendered_len, clog_batch.open ? &clog_batch.when : NULL);
+    rendered = clog_backtrace.text;
   }
 #endif
 
-  clog_safe_write(final_buf, len);
+#if CLOG_HAS_BATCH
+  if (clog_batch.open) {
+    clog_batch_append(level, file, line, func, fields, nfields, format, args,
+                      rendered, rendered_len);
+    return;
+  }
+#endif
 
-#if CLOG_WINDOWS
-  if (!use_ansi && clog_should_use_colors()) {
-    clog_reset_console_color();
+#if CLOG_POSIX && CLOG_HAS_TLS
+  /* The mapped sink needs neither the queue nor the lock */
+  if (atomic_load_explicit(&clog_mmap_current, memory_order_relaxed)) {
+    size_t len = rendered_len;
+    if (!rendered) {
+      va_list copy;
+      va_copy(copy, args);
+      len = clog_format_record(final_buf, sizeof(final_buf), level, file,
+                               line, func, fields, nfields, format, copy,
+                               clog_use_ansi_colors(), NULL);
+      va_end(copy);
+    }
+#ifdef CLOG_STATS
+    uint64_t start = clog_now_ns();
+    if (clog_mmap_write(rendered ? rendered : final_buf, len, false)) {
+      clog_stat_write(len, true, start);
+      return;
+    }
+#else
+    if (clog_mmap_write(rendered ? rendered : final_buf, len, false))
+      return;
+#endif
+  }
+#endif
+
+#if CLOG_HAS_ASYNC
+  if (clog_async_push(level, file, line, func, fields, nfields, format, args,
+                      rendered, rendered_len)) {
+    /* FATAL usually precedes an exit: make sure it and its history land */
+    if (level == CLOG_FATAL)
+      clog_flush();
+    return;
   }
 #endif
 
+#if CLOG_HAS_TLS
+  size_t len = rendered_len;
+  if (!rendered)
+    len = clog_format_record(final_buf, sizeof(final_buf), level, file, line,
+                             func, fields, nfields, format, args,
+                             clog_use_ansi_colors(), NULL);
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  if (clog_buffer_line(level, rendered ? rendered : final_buf, len))
+    clog_flush_output();
+#else
+  CLOG_MUTEX_LOCK(&clog_mutex);
+  size_t len = clog_format_record(final_buf, sizeof(final_buf), level, file,
+                                  line, func, fields, nfields, format, args,
+                                  clog_use_ansi_colors(), NULL);
+  if (clog_buffer_line(level, final_buf, len))
+    clog_flush_output();
+#endif
+
   CLOG_MUTEX_UNLOCK(&clog_mutex);
 }
 
+/* Shared tail of clog_log_impl and clog_log_category: counts the record
+ * and dumps the flight recorder after a FATAL one */
+static void clog_log_record(clog_level_t level, clog_level_t output_level,
+                            const char *file, int line, const char *func,
+                            const clog_field_t *fields, size_t nfields,
+                            const char *format, va_list args) {
+#ifdef CLOG_STATS
+  CLOG_STAT_LEVEL(CLOG_STAT_EMITTED, level);
+  clog_stats_truncated = false;
+  clog_log_write(level, output_level, file, line, func, fields, nfields,
+                 format, args);
+  if (clog_stats_truncated)
+    clog_stat_add(CLOG_STAT_TRUNCATED, 1);
+#else
+  clog_log_write(level, output_level, file, line, func, fields, nfields,
+                 format, args);
+#endif
+#if CLOG_HAS_BACKTRACE
+  clog_backtrace.depth = 0;
+#endif
+#if CLOG_HAS_RECORDER
+  /* The history leading up to a FATAL record goes out right after it */
+  if (level == CLOG_FATAL && clog_recorder_level != CLOG_RECORDER_OFF) {
+    clog_flush();
+    clog_dump_flight_recorder(-1);
+  }
+#endif
+}
+
+CLOG_API void clog_log_impl(clog_level_t level, const char *file, int line,
+                            const char *func, const clog_field_t *fields,
+                            size_t nfields, const char *format,
+                            va_list args) {
+  clog_level_t output = (clog_level_t)atomic_load_explicit(
+      &clog_output_level, memory_order_relaxed);
+  clog_log_record(level, output, file, line, func, fields, nfields, format,
+                  args);
+}
+
+CLOG_API void clog_log_category(clog_category_site_t *site,
+                                clog_level_t level, const char *file, int line,
+                                const char *func, const char *format, ...) {
+  if (!atomic_load(&clog_is_initialized))
+    clog_init();
+
+  unsigned int state = atomic_load_explicit(&site->state,
+                                            memory_order_relaxed);
+  CLOG_BACKTRACE_CAPTURE(level);
+  va_list args;
+  va_start(args, format);
+#if CLOG_HAS_TLS
+  clog_current_category = site->name;
+#endif
+  clog_log_record(level, (clog_level_t)((state >> 3) & 7), file, line, func,
+                  NULL, 0, format, args);
+#if CLOG_HAS_TLS
+  clog_current_category = NULL;
+#endif
+  va_end(args);
+}
+
+#endif /* CLOG_DEFINE_IMPL */
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,11 +20,33 @@ extern void test_long_messages(void);
 extern void test_special_characters(void);
 extern void test_invalid_levels(void);
 extern void test_thread_safety(void);
+extern void test_throughput_scaling(void);
+extern void test_lock(void);
 extern void test_signal_safety(void);
 extern void test_performance(void);
 extern void test_configuration(void);
 extern void test_unicode(void);
 extern void test_integration(void);
+extern void test_async(void);
+extern void test_timestamp(void);
+extern void test_fd_sink(void);
+extern void test_binary(void);
+extern void test_compile_level(void);
+extern void test_rate_limit(void);
+extern void test_shared(void);
+extern void test_mmap(void);
+extern void test_rotate(void);
+extern void test_structured(void);
+extern void test_sinks(void);
+extern void test_stats(void);
+extern void test_flight_recorder(void);
+extern void test_format(void);
+extern void test_categories(void);
+extern void test_lazy_args(void);
+extern void test_batch(void);
+extern void test_pattern(void);
+extern void test_control(void);
+extern void test_backtrace(void);
 
 int main(void) {
   printf("🚀 CLOG Library Test Suite\n");
@@ -39,6 +61,8 @@ int main(void) {
   test_invalid_levels();
 #if HAS_THREADS
   test_thread_safety();
+  test_throughput_scaling();
+  test_lock();
 #else
   printf("⚠️  Thread safety test skipped (pthread not available)\n");
 #endif
@@ -47,6 +71,26 @@ int main(void) {
   test_configuration();
   test_unicode();
   test_integration();
+  test_async();
+  test_timestamp();
+  test_fd_sink();
+  test_binary();
+  test_compile_level();
+  test_rate_limit();
+  test_shared();
+  test_mmap();
+  test_rotate();
+  test_structured();
+  test_sinks();
+  test_stats();
+  test_flight_recorder();
+  test_format();
+  test_categories();
+  test_lazy_args();
+  test_batch();
+  test_pattern();
+  test_control();
+  test_backtrace();
 
   printf("\n🎉 All tests completed successfully!\n");
   printf("=====================================\n");
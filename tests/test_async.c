@@ -0,0 +1,120 @@
+#define CLOG_ASYNC_QUEUE_SIZE 16
+#include "../clog.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <string.h>
+#ifdef _POSIX_THREADS
+#include <pthread.h>
+#define HAS_THREADS 1
+#else
+#define HAS_THREADS 0
+#endif
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+#define ASYNC_THREADS 4
+#define ASYNC_MESSAGES 2000
+
+#if HAS_THREADS
+static void *async_log_function(void *arg) {
+  int thread_id = *(int *)arg;
+  for (int i = 0; i < ASYNC_MESSAGES; i++) {
+    INFO("Async thread %d message %d", thread_id, i);
+  }
+  return NULL;
+}
+#endif
+
+extern void test_async(void) {
+  TEST_START("Async Logging");
+  clog_async_stats_t stats;
+
+  FILE *file = fopen("test_async.log", "w");
+  TEST_ASSERT(file != NULL, "Open log file");
+  clog_set_output(file);
+  clog_set_show_timestamp(0);
+  TEST_ASSERT(clog_set_async(true), "Enable async mode");
+
+#if HAS_THREADS
+  pthread_t threads[ASYNC_THREADS];
+  int ids[ASYNC_THREADS];
+  for (int i = 0; i < ASYNC_THREADS; i++) {
+    ids[i] = i;
+    TEST_ASSERT(
+        pthread_create(&threads[i], NULL, async_log_function, &ids[i]) == 0,
+        "Producer thread creation");
+  }
+  for (int i = 0; i < ASYNC_THREADS; i++)
+    pthread_join(threads[i], NULL);
+  const int expected = ASYNC_THREADS * ASYNC_MESSAGES;
+#else
+  int id = 0;
+  for (int i = 0; i < ASYNC_THREADS; i++)
+    async_log_function(&id);
+  const int expected = ASYNC_THREADS * ASYNC_MESSAGES;
+#endif
+  clog_flush();
+  TEST_ASSERT(count_lines("test_async.log", "[INFO] Async thread") == expected,
+              "Blocking overflow keeps every record");
+  clog_get_async_stats(&stats);
+  TEST_ASSERT(stats.written == (size_t)expected &&
+                  stats.dropped_newest == 0 && stats.dropped_oldest == 0,
+              "Writer accounted for every record");
+
+  FATAL("Fatal drains the queue");
+  TEST_ASSERT(count_lines("test_async.log", "Fatal drains the queue") == 1,
+              "FATAL is written before returning");
+
+  clog_set_async_overflow(CLOG_OVERFLOW_DROP_NEWEST);
+  for (int i = 0; i < ASYNC_MESSAGES; i++)
+    INFO("Drop newest %d", i);
+  clog_flush();
+  clog_get_async_stats(&stats);
+  TEST_ASSERT(count_lines("test_async.log", "Drop newest") +
+                      (int)stats.dropped_newest ==
+                  ASYNC_MESSAGES,
+              "Drop-newest writes or counts every record");
+
+  clog_set_async_overflow(CLOG_OVERFLOW_DROP_OLDEST);
+  for (int i = 0; i < ASYNC_MESSAGES; i++)
+    INFO("Drop oldest %d", i);
+  clog_flush();
+  clog_get_async_stats(&stats);
+  TEST_ASSERT(count_lines("test_async.log", "Drop oldest") +
+                      (int)stats.dropped_oldest ==
+                  ASYNC_MESSAGES,
+              "Drop-oldest writes or counts every record");
+  TEST_ASSERT(count_lines("test_async.log", "Drop oldest 1999") == 1,
+              "Drop-oldest keeps the newest record");
+
+  clog_set_async_overflow(CLOG_OVERFLOW_BLOCK);
+  INFO("Last queued record");
+  TEST_ASSERT(clog_set_async(false), "Disable async mode drains the queue");
+  TEST_ASSERT(count_lines("test_async.log", "Last queued record") == 1,
+              "Queued record written on disable");
+  INFO("Synchronous again");
+  TEST_ASSERT(count_lines("test_async.log", "Synchronous again") == 1,
+              "Synchronous path restored");
+
+  fclose(file);
+  clog_set_output(NULL);
+  clog_set_show_timestamp(1);
+  remove("test_async.log");
+  TEST_END("Async Logging");
+}
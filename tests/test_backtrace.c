@@ -0,0 +1,129 @@
+#include "../clog.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if CLOG_HAS_BACKTRACE
+#define HAS_BACKTRACE_TEST 1
+#else
+#define HAS_BACKTRACE_TEST 0
+#endif
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+#if HAS_BACKTRACE_TEST
+/* Exported and never inlined, so -rdynamic gives the trace its name */
+__attribute__((noinline)) void test_backtrace_site(int round);
+__attribute__((noinline)) void test_backtrace_site(int round) {
+  ERROR("Traced %d", round);
+  WARN("Untraced %d", round);
+}
+
+/* Returns the trace lines under the line holding needle, or "" */
+static const char *trace_after(const char *text, const char *needle,
+                               char *trace, size_t size) {
+  const char *start = strstr(text, needle);
+  trace[0] = '\0';
+  if (!start || !(start = strchr(start, '\n')))
+    return trace;
+  const char *end = ++start;
+  while (strncmp(end, "    #", 5) == 0 && strchr(end, '\n'))
+    end = strchr(end, '\n') + 1;
+  size_t len = (size_t)(end - start) < size ? (size_t)(end - start) : size - 1;
+  memcpy(trace, start, len);
+  trace[len] = '\0';
+  return trace;
+}
+
+extern void test_backtrace(void) {
+  TEST_START("Backtrace Capture");
+  static char text[65536];
+  char first[CLOG_BACKTRACE_TEXT_SIZE], second[CLOG_BACKTRACE_TEXT_SIZE];
+  char other[CLOG_BACKTRACE_TEXT_SIZE];
+
+  FILE *file = fopen("test_backtrace.log", "w");
+  TEST_ASSERT(file != NULL, "Open log file");
+  clog_set_output(file);
+  clog_set_show_timestamp(0);
+  TEST_ASSERT(clog_set_backtrace(CLOG_ERROR), "Trace ERROR and FATAL");
+  /* One call site, so both records have the same return addresses; the
+   * volatile bound keeps the compiler from unrolling it into two */
+  volatile int rounds = 2;
+  for (int round = 1; round <= rounds; round++)
+    test_backtrace_site(round);
+  clog_flush();
+  slurp("test_backtrace.log", text, sizeof(text));
+
+  trace_after(text, "] Traced 1 ", first, sizeof(first));
+  TEST_ASSERT(strncmp(first, "    #0 ", 7) == 0 &&
+                  count_matches(first, "    #") <= CLOG_BACKTRACE_DEPTH,
+              "Frames written under the location");
+  TEST_ASSERT(strstr(first, "test_backtrace_site") &&
+                  strstr(first, "test_backtrace_site") <
+                      strstr(first, "    #1 ") &&
+                  strstr(first, "test_backtrace+"),
+              "Trace starts at the logging function");
+  TEST_ASSERT(!strstr(first, "clog_"), "Library frames left out");
+  trace_after(text, "] Untraced 1 ", other, sizeof(other));
+  TEST_ASSERT(other[0] == '\0', "WARN records get no trace");
+  trace_after(text, "] Traced 2 ", second, sizeof(second));
+  TEST_ASSERT(strcmp(first, second) == 0,
+              "Cached frames render the same trace");
+
+  /* The writer thread symbolizes in async mode */
+  clog_set_async(true);
+  test_backtrace_site(3);
+  clog_flush();
+  clog_set_async(false);
+  slurp("test_backtrace.log", text, sizeof(text));
+  trace_after(text, "] Traced 3 ", other, sizeof(other));
+  TEST_ASSERT(count_matches(other, "    #") == count_matches(first, "    #") &&
+                  strstr(other, "test_backtrace_site"),
+              "Async mode writes the trace too");
+
+  clog_batch_begin();
+  test_backtrace_site(4);
+  clog_batch_commit();
+  slurp("test_backtrace.log", text, sizeof(text));
+  trace_after(text, "] Traced 4 ", other, sizeof(other));
+  TEST_ASSERT(count_matches(other, "    #") == count_matches(first, "    #"),
+              "Batched records keep their trace");
+
+  clog_set_output_format(CLOG_FORMAT_JSON);
+  test_backtrace_site(5);
+  clog_set_output_format(CLOG_FORMAT_TEXT);
+  clog_set_backtrace(CLOG_BACKTRACE_OFF);
+  test_backtrace_site(6);
+  clog_flush();
+  slurp("test_backtrace.log", text, sizeof(text));
+  TEST_ASSERT(strstr(text, "Traced 5") &&
+                  !strstr(strstr(text, "Traced 5"), "    #"),
+              "JSON output and CLOG_BACKTRACE_OFF write no trace");
+
+  clog_set_show_timestamp(1);
+  clog_set_output(NULL);
+  fclose(file);
+  remove("test_backtrace.log");
+  TEST_END("Backtrace Capture");
+}
+#else
+void test_backtrace(void) {
+  printf("⚠️  Backtrace test skipped (needs glibc or macOS)\n");
+}
+#endif
@@ -0,0 +1,211 @@
+#include "../clog.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _POSIX_THREADS
+#include <pthread.h>
+#define HAS_THREADS 1
+#else
+#define HAS_THREADS 0
+#endif
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+#define BATCH_THREADS 4
+#define BATCH_ROUNDS 50
+#define BATCH_LINES 30
+
+/* True if every line containing tag carries the same timestamp */
+static bool same_timestamps(const char *text, const char *tag) {
+  char first[64] = {0};
+  for (const char *line = text; *line;) {
+    const char *end = strchr(line, '\n');
+    size_t len = end ? (size_t)(end - line) : strlen(line);
+    const char *bracket = memchr(line, '[', len);
+    const char *found = strstr(line, tag);
+    if (bracket && found && found < line + len) {
+      size_t stamp = (size_t)(bracket - line);
+      if (stamp >= sizeof(first))
+        return false;
+      if (!first[0])
+        memcpy(first, line, stamp);
+      else if (strncmp(first, line, stamp) != 0)
+        return false;
+    }
+    line += len + (end ? 1 : 0);
+  }
+  return first[0] != '\0';
+}
+
+#if HAS_THREADS
+/* Logs whole batches while another thread logs single lines */
+static void *batch_thread(void *arg) {
+  int id = (int)(intptr_t)arg;
+  for (int round = 0; round < BATCH_ROUNDS; round++) {
+    if (id == 0) {
+      for (int i = 0; i < BATCH_LINES; i++)
+        INFO("Loose line %d", i);
+      continue;
+    }
+    clog_batch_begin();
+    for (int i = 0; i < BATCH_LINES; i++)
+      INFO("Batch %d.%d line %d", id, round, i);
+    clog_batch_commit();
+  }
+  return NULL;
+}
+
+/* True if each batch's lines appear together and in order */
+static bool batches_contiguous(const char *text) {
+  for (int id = 1; id < BATCH_THREADS; id++) {
+    for (int round = 0; round < BATCH_ROUNDS; round++) {
+      char needle[64];
+      snprintf(needle, sizeof(needle), "Batch %d.%d line 0\n", id, round);
+      const char *p = strstr(text, needle);
+      for (int i = 1; p && i < BATCH_LINES; i++) {
+        p = strchr(p, '\n') + 1;
+        const char *end = strchr(p, '\n');
+        snprintf(needle, sizeof(needle), "Batch %d.%d line %d\n", id, round,
+                 i);
+        size_t len = strlen(needle);
+        /* The line after a timestamp must end with the next message */
+        if (!end || (size_t)(end + 1 - p) < len ||
+            strncmp(end + 1 - len, needle, len) != 0)
+          return false;
+      }
+      if (!p)
+        return false;
+    }
+  }
+  return true;
+}
+#endif
+
+extern void test_batch(void) {
+  TEST_START("Batch Logging");
+  static char text[1 << 20], sink_text[65536];
+
+  FILE *file = fopen("test_batch.log", "w");
+  FILE *sink_file = fopen("test_batch_sink.log", "w");
+  TEST_ASSERT(file && sink_file, "Open log files");
+  clog_set_output(file);
+  clog_set_show_location(0);
+  clog_set_time_precision(CLOG_TIME_NANOS);
+  clog_set_level(CLOG_INFO);
+
+  TEST_ASSERT(!clog_batch_commit(), "Commit without a batch fails");
+  TEST_ASSERT(clog_batch_begin(), "Begin a batch");
+  TEST_ASSERT(!clog_batch_begin(), "Nested begin fails");
+  for (int i = 0; i < 20; i++) {
+    INFO("Shared stamp %d", i);
+    clog_batch_add(CLOG_WARN, __FILE__, __LINE__, __func__, "Added %d", i);
+  }
+  DEBUG("Filtered in batch");
+  fflush(file);
+  TEST_ASSERT(slurp("test_batch.log", text, sizeof(text)) == 0,
+              "Nothing written before the commit");
+  TEST_ASSERT(clog_batch_commit(), "Commit the batch");
+  slurp("test_batch.log", text, sizeof(text));
+  TEST_ASSERT(count_matches(text, "] Shared stamp ") == 20 &&
+                  count_matches(text, "[WARN] Added ") == 20 &&
+                  !strstr(text, "Filtered in batch"),
+              "Committed lines written, filtered lines skipped");
+  TEST_ASSERT(strstr(text, "[INFO] Shared stamp 0\n") &&
+                  strstr(text, "[INFO] Shared stamp 0\n") <
+                      strstr(text, "[WARN] Added 0\n") &&
+                  strstr(text, "[WARN] Added 0\n") <
+                      strstr(text, "[INFO] Shared stamp 1\n"),
+              "Lines keep their order");
+  TEST_ASSERT(same_timestamps(text, "] Shared stamp ") &&
+                  same_timestamps(text, "] Added "),
+              "Batch lines share one timestamp");
+
+  /* Sinks are written as records arrive, with the batch's timestamp */
+  clog_sink_config_t config = {sink_file, -1, CLOG_INFO, CLOG_COLOR_NEVER,
+                               CLOG_FORMAT_TEXT};
+  int sink = clog_add_sink(&config);
+  clog_batch_begin();
+  for (int i = 0; i < 5; i++)
+    INFO("Sink stamp %d", i);
+  fflush(sink_file);
+  slurp("test_batch_sink.log", sink_text, sizeof(sink_text));
+  TEST_ASSERT(count_matches(sink_text, "Sink stamp") == 5 &&
+                  same_timestamps(sink_text, "] Sink stamp "),
+              "Sinks receive batch records right away");
+  clog_batch_commit();
+  clog_remove_sink(sink);
+  slurp("test_batch.log", text, sizeof(text));
+  TEST_ASSERT(count_matches(text, "] Sink stamp ") == 5 &&
+                  same_timestamps(text, "] Sink stamp "),
+              "Main output shares the sinks' timestamp");
+
+  /* More than CLOG_BATCH_SIZE: full blocks go out while the batch is open */
+  int big = 2 * CLOG_BATCH_SIZE / 64;
+  clog_batch_begin();
+  for (int i = 0; i < big; i++)
+    INFO("Overflow line %d padded to about sixty-four bytes", i);
+  fflush(file);
+  slurp("test_batch.log", text, sizeof(text));
+  TEST_ASSERT(count_matches(text, "Overflow line") > 0 &&
+                  count_matches(text, "Overflow line") < big,
+              "Full arena is written before the commit");
+  clog_batch_commit();
+  slurp("test_batch.log", text, sizeof(text));
+  TEST_ASSERT(count_matches(text, "Overflow line") == big,
+              "Every overflowing line arrives");
+
+  clog_batch_begin();
+  INFO("Before fatal");
+  FATAL("Fatal in batch");
+  INFO("After fatal");
+  fflush(file);
+  slurp("test_batch.log", text, sizeof(text));
+  TEST_ASSERT(strstr(text, "Before fatal") && strstr(text, "Fatal in batch") &&
+                  !strstr(text, "After fatal"),
+              "FATAL writes the batch out at once");
+  clog_batch_commit();
+
+#if HAS_THREADS
+  fclose(file);
+  file = fopen("test_batch.log", "w");
+  clog_set_output(file);
+  pthread_t threads[BATCH_THREADS];
+  for (int i = 0; i < BATCH_THREADS; i++)
+    pthread_create(&threads[i], NULL, batch_thread, (void *)(intptr_t)i);
+  for (int i = 0; i < BATCH_THREADS; i++)
+    pthread_join(threads[i], NULL);
+  clog_flush();
+  slurp("test_batch.log", text, sizeof(text));
+  TEST_ASSERT(count_matches(text, "Loose line") == BATCH_ROUNDS * BATCH_LINES,
+              "Unbatched lines all written");
+  TEST_ASSERT(batches_contiguous(text),
+              "Concurrent batches are never interleaved");
+#endif
+
+  clog_set_level(CLOG_TRACE);
+  clog_set_time_precision(CLOG_TIME_SECONDS);
+  clog_set_show_location(1);
+  clog_set_output(NULL);
+  fclose(file);
+  fclose(sink_file);
+  remove("test_batch.log");
+  remove("test_batch_sink.log");
+  TEST_END("Batch Logging");
+}
@@ -0,0 +1,137 @@
+#include "../clog.h"
+#include "test_util.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+/* Same call sites for both runs so locations match */
+static void log_sample_messages(void) {
+  static char long_text[3 * CLOG_MAX_MESSAGE_SIZE];
+  memset(long_text, 'x', sizeof(long_text) - 1);
+  long_text[sizeof(long_text) - 1] = '\0';
+
+  INFO("Plain message");
+  DEBUG("Integers %d %u %x %hhd %hd", -42, 42u, 0xbeefu, (signed char)-3,
+        (short)1234);
+  INFO("Wide integers %ld %lu %lld %llx %zu %td %jd", -1L, 2UL, -3LL, 4ULL,
+       (size_t)5, (ptrdiff_t)-6, (intmax_t)7);
+  WARN("Floats %.3f %e %g %10.2Lf", 3.14159, 1e-9, 0.5, (long double)2.25);
+  ERROR("Strings [%s] [%-8s] [%.3s] [%*s] [%.*s] %s", "abc", "left", "truncate",
+        6, "wide", 2, "precision", (const char *)NULL);
+  INFO("Char %c and percent %% and pointer %p", 'z', (void *)0x1234);
+  INFO("Long string %s", long_text);
+  INFO("Padded long string %5000s", long_text);
+  INFO("Positional %1$d %1$d", 9);
+  for (int i = 0; i < 3; i++) {
+    INFO("Repeated site %d", i);
+  }
+  FATAL("Fatal %s", "done");
+}
+
+extern void test_binary(void) {
+  TEST_START("Binary Deferred Formatting");
+
+  static char text[64 * 1024];
+  static char decoded[64 * 1024];
+
+  clog_set_show_timestamp(0);
+  FILE *text_file = fopen("test_binary.txt", "w");
+  TEST_ASSERT(text_file != NULL, "Open text log");
+  clog_set_output(text_file);
+  log_sample_messages();
+  clog_set_output(stderr);
+  fclose(text_file);
+
+  FILE *bin_file = fopen("test_binary.bin", "wb");
+  TEST_ASSERT(bin_file != NULL, "Open binary log");
+  TEST_ASSERT(clog_set_binary_output(bin_file), "Enable binary mode");
+  log_sample_messages();
+  TEST_ASSERT(clog_set_binary_output(NULL), "Disable binary mode");
+  fclose(bin_file);
+
+  bin_file = fopen("test_binary.bin", "rb");
+  FILE *out_file = fopen("test_binary.out", "w");
+  TEST_ASSERT(bin_file && out_file, "Open decoder streams");
+  TEST_ASSERT(clog_binary_decode(bin_file, out_file), "Decode binary log");
+  fclose(bin_file);
+  fclose(out_file);
+
+  size_t text_len = slurp("test_binary.txt", text, sizeof(text));
+  size_t decoded_len = slurp("test_binary.out", decoded, sizeof(decoded));
+  TEST_ASSERT(text_len > 0 && text_len == decoded_len &&
+                  memcmp(text, decoded, text_len) == 0,
+              "Decoded output matches text mode byte for byte");
+
+  /* Timestamps are taken at log time and rendered by the decoder */
+  clog_set_show_timestamp(1);
+  clog_set_time_format(CLOG_TIME_FORMAT_ISO8601);
+  clog_set_time_utc(true);
+  clog_set_time_precision(CLOG_TIME_MICROS);
+  bin_file = fopen("test_binary.bin", "wb");
+  TEST_ASSERT(clog_set_binary_output(bin_file), "Enable timestamped binary");
+  INFO("Timestamped %d", 1);
+  clog_set_binary_output(NULL);
+  fclose(bin_file);
+  clog_set_time_precision(CLOG_TIME_SECONDS);
+  clog_set_time_utc(false);
+  clog_set_time_format(CLOG_TIME_FORMAT_DEFAULT);
+
+  bin_file = fopen("test_binary.bin", "rb");
+  out_file = fopen("test_binary.out", "w");
+  TEST_ASSERT(clog_binary_decode(bin_file, out_file), "Decode timestamps");
+  fclose(bin_file);
+  fclose(out_file);
+  slurp("test_binary.out", decoded, sizeof(decoded));
+  TEST_ASSERT(strlen(decoded) > 27 && decoded[10] == 'T' &&
+                  decoded[19] == '.' && decoded[26] == 'Z' &&
+                  strstr(decoded, "Z [INFO] Timestamped 1") == decoded + 26,
+              "Recorded time rendered with the stream's settings");
+
+  /* Garbage is rejected rather than misread */
+  bin_file = fopen("test_binary.bin", "wb");
+  fputs("not a clog stream", bin_file);
+  fclose(bin_file);
+  bin_file = fopen("test_binary.bin", "rb");
+  TEST_ASSERT(!clog_binary_decode(bin_file, stdout), "Reject bad header");
+  fclose(bin_file);
+
+  /* A valid header followed by a site id past the table */
+  bin_file = fopen("test_binary.bin", "wb");
+  clog_set_binary_output(bin_file);
+  clog_set_binary_output(NULL);
+  unsigned char type = CLOG_BINARY_SITE;
+  uint32_t bad_id = UINT32_MAX;
+  int32_t bad_line = 1;
+  fwrite(&type, 1, 1, bin_file);
+  fwrite(&bad_id, sizeof(bad_id), 1, bin_file);
+  fwrite(&bad_line, sizeof(bad_line), 1, bin_file);
+  fclose(bin_file);
+  bin_file = fopen("test_binary.bin", "rb");
+  TEST_ASSERT(!clog_binary_decode(bin_file, stdout),
+              "Reject out-of-range site id");
+  fclose(bin_file);
+
+  remove("test_binary.txt");
+  remove("test_binary.bin");
+  remove("test_binary.out");
+
+  TEST_END("Binary Deferred Formatting");
+}
@@ -0,0 +1,146 @@
+#include "../clog.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+/* One call site per category, so the cached state is reused across calls */
+static void log_all(int round) {
+  CLOG_CAT_DEBUG("net", "net debug %d", round);
+  CLOG_CAT_DEBUG("net.http", "net.http debug %d", round);
+  CLOG_CAT_INFO("net.http", "net.http info %d", round);
+  CLOG_CAT_DEBUG("net.http.tls", "net.http.tls debug %d", round);
+  CLOG_CAT_DEBUG("network", "network debug %d", round);
+  CLOG_CAT_WARN("db", "db warn %d", round);
+  CLOG_CAT_ERROR("db", "db error %d", round);
+}
+
+extern void test_categories(void) {
+  TEST_START("Log Categories");
+  static char main_log[65536], sink_log[65536];
+
+  FILE *main_out = fopen("test_categories.log", "w");
+  FILE *sink_out = fopen("test_categories_sink.log", "w");
+  TEST_ASSERT(main_out && sink_out, "Open category logs");
+  clog_set_output(main_out);
+  clog_set_show_timestamp(0);
+  clog_set_show_location(0);
+  clog_set_level(CLOG_INFO);
+
+  TEST_ASSERT(clog_get_category_level("net.http") == CLOG_INFO,
+              "Unconfigured category follows the main output");
+  log_all(0);
+
+  TEST_ASSERT(clog_set_category_level("net", CLOG_DEBUG), "Set net level");
+  TEST_ASSERT(clog_set_category_level("db", CLOG_ERROR), "Set db level");
+  TEST_ASSERT(clog_get_category_level("net.http.tls") == CLOG_DEBUG,
+              "Grandchild inherits the parent's level");
+  TEST_ASSERT(clog_get_category_level("network") == CLOG_INFO,
+              "Prefix match stops at a dot boundary");
+  log_all(1);
+
+  TEST_ASSERT(clog_set_category_level("net.http", CLOG_WARN),
+              "Child overrides its parent");
+  log_all(2);
+
+  TEST_ASSERT(clog_clear_category_level("net.http"), "Clear child level");
+  TEST_ASSERT(!clog_clear_category_level("net.http"),
+              "Clearing twice reports no level");
+  TEST_ASSERT(clog_set_category_level("db", CLOG_CATEGORY_OFF),
+              "Turn db off");
+  log_all(3);
+
+  clog_sink_config_t config = {sink_out, -1, CLOG_TRACE, CLOG_COLOR_NEVER,
+                               CLOG_FORMAT_TEXT};
+  int sink = clog_add_sink(&config);
+  TEST_ASSERT(sink > 0, "Add a TRACE sink");
+  log_all(4);
+  /* Past FATAL the main output takes nothing, categories included */
+  clog_set_level((clog_level_t)9);
+  CLOG_CAT_WARN("jobs", "jobs warn 5");
+  WARN("plain warn 5");
+  clog_set_level(CLOG_INFO);
+  clog_remove_sink(sink);
+  clog_flush();
+
+  slurp("test_categories.log", main_log, sizeof(main_log));
+  slurp("test_categories_sink.log", sink_log, sizeof(sink_log));
+
+  TEST_ASSERT(!strstr(main_log, "net debug 0") &&
+                  strstr(main_log, "[INFO] net.http info 0\n") &&
+                  strstr(main_log, "[WARN] db warn 0\n"),
+              "Categories default to the main output's level");
+  TEST_ASSERT(strstr(main_log, "[DEBUG] net debug 1\n") &&
+                  strstr(main_log, "net.http debug 1\n") &&
+                  strstr(main_log, "net.http.tls debug 1\n"),
+              "Lowering a parent enables its subcategories");
+  TEST_ASSERT(!strstr(main_log, "network debug 1") &&
+                  !strstr(main_log, "db warn 1") &&
+                  strstr(main_log, "db error 1"),
+              "Other categories keep their own levels");
+  TEST_ASSERT(!strstr(main_log, "net.http info 2") &&
+                  !strstr(main_log, "net.http.tls debug 2") &&
+                  strstr(main_log, "net debug 2"),
+              "Cached call sites see a changed level");
+  TEST_ASSERT(strstr(main_log, "net.http.tls debug 3") &&
+                  !strstr(main_log, "db error 3"),
+              "Cleared and disabled categories take effect");
+  TEST_ASSERT(!strstr(main_log, "network debug 4") &&
+                  strstr(sink_log, "network debug 4") &&
+                  strstr(sink_log, "db error 4"),
+              "Sinks keep their own level for categories");
+  TEST_ASSERT(!strstr(main_log, "jobs warn 5") &&
+                  !strstr(main_log, "plain warn 5") &&
+                  strstr(sink_log, "jobs warn 5"),
+              "Out-of-range levels turn categories off");
+
+  char name[CLOG_CATEGORY_NAME_SIZE];
+  int set = 0;
+  for (int i = 0; i < CLOG_MAX_CATEGORIES + 1; i++) {
+    snprintf(name, sizeof(name), "fill.%d", i);
+    set += clog_set_category_level(name, CLOG_WARN);
+  }
+  TEST_ASSERT(set == CLOG_MAX_CATEGORIES - 2,
+              "Table holds CLOG_MAX_CATEGORIES categories");
+  memset(name, 'x', sizeof(name));
+  name[sizeof(name) - 1] = '\0';
+  TEST_ASSERT(!clog_set_category_level(name, CLOG_WARN) &&
+                  !clog_set_category_level("", CLOG_WARN),
+              "Overlong and empty names are rejected");
+  for (int i = 0; i < CLOG_MAX_CATEGORIES + 1; i++) {
+    snprintf(name, sizeof(name), "fill.%d", i);
+    clog_clear_category_level(name);
+  }
+  clog_clear_category_level("net");
+  clog_clear_category_level("db");
+  TEST_ASSERT(clog_get_category_level("db") == CLOG_INFO,
+              "Cleared table falls back to the main output");
+
+  clog_set_level(CLOG_TRACE);
+  clog_set_show_timestamp(1);
+  clog_set_show_location(1);
+  clog_set_output(NULL);
+  fclose(main_out);
+  fclose(sink_out);
+  remove("test_categories.log");
+  remove("test_categories_sink.log");
+  TEST_END("Log Categories");
+}
@@ -0,0 +1,74 @@
+/* Everything below WARN is compiled out of this file */
+#define CLOG_COMPILE_MIN_LEVEL CLOG_LEVEL_WARN
+#include "../clog.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+/* Deliberately never defined: a stripped call that still emitted code would
+ * reference it and the test suite would fail to link */
+extern int clog_stripped_call_must_not_link(void);
+
+static int side_effects = 0;
+
+static int count_side_effect(void) { return ++side_effects; }
+
+extern void test_compile_level(void) {
+  TEST_START("Compile-Time Minimum Level");
+
+  FILE *file = fopen("test_compile_level.log", "w");
+  TEST_ASSERT(file != NULL, "Open log file");
+  clog_set_output(file);
+  clog_set_show_timestamp(0);
+  clog_set_show_location(0);
+  clog_set_level(CLOG_TRACE);
+
+  TRACE("Stripped %d", clog_stripped_call_must_not_link());
+  DEBUG("Stripped %d", clog_stripped_call_must_not_link());
+  INFO("Stripped %d", clog_stripped_call_must_not_link());
+  for (int i = 0; i < 1000; i++) {
+    TRACE("Hot loop %d %d", i, count_side_effect());
+  }
+  TEST_ASSERT(side_effects == 0, "Stripped arguments are never evaluated");
+
+  WARN("Kept %d", count_side_effect());
+  ERROR("Kept %d", count_side_effect());
+  TEST_ASSERT(side_effects == 2, "Enabled levels still evaluate arguments");
+
+  LOG(CLOG_DEBUG, 0, "Runtime level below the build minimum");
+  clog_set_output(stderr);
+  clog_set_show_timestamp(1);
+  clog_set_show_location(1);
+  fclose(file);
+
+  file = fopen("test_compile_level.log", "r");
+  TEST_ASSERT(file != NULL, "Reopen log file");
+  char buf[256] = {0};
+  fgets(buf, sizeof(buf), file);
+  TEST_ASSERT(strcmp(buf, "[WARN] Kept 1\n") == 0, "WARN is compiled in");
+  fgets(buf, sizeof(buf), file);
+  TEST_ASSERT(strcmp(buf, "[ERROR] Kept 2\n") == 0, "ERROR is compiled in");
+  TEST_ASSERT(fgets(buf, sizeof(buf), file) == NULL,
+              "Nothing below WARN reached the output");
+  fclose(file);
+  remove("test_compile_level.log");
+
+  TEST_END("Compile-Time Minimum Level");
+}
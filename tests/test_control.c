@@ -0,0 +1,103 @@
+#include "../clog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if !defined(_WIN32) && defined(_POSIX_THREADS)
+#include <unistd.h>
+#define HAS_CONTROL_TEST 1
+#else
+#define HAS_CONTROL_TEST 0
+#endif
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+#if HAS_CONTROL_TEST
+/* Waits up to two seconds for the control thread to pick up a request */
+static bool wait_applied(clog_control_t *block) {
+  for (int i = 0; i < 200; i++) {
+    if (atomic_load(&block->requested_level) == CLOG_CONTROL_NO_REQUEST)
+      return true;
+    usleep(10000);
+  }
+  return false;
+}
+
+extern void test_control(void) {
+  TEST_START("Shared-Memory Control Block");
+  char path[256];
+  snprintf(path, sizeof(path), "%s/clog.%ld", CLOG_CONTROL_DIR,
+           (long)getpid());
+
+  clog_set_level(CLOG_INFO);
+  if (!clog_set_control(true)) {
+    printf("⚠️  %s not writable, control block test skipped\n",
+           CLOG_CONTROL_DIR);
+    clog_set_level(CLOG_TRACE);
+    return;
+  }
+  TEST_ASSERT(clog_set_control(true), "Enabling twice succeeds");
+
+  /* Map the block the way clogctl does */
+  int fd = open(path, O_RDWR);
+  TEST_ASSERT(fd >= 0, "Control block file created");
+  clog_control_t *block =
+      (clog_control_t *)mmap(NULL, sizeof(clog_control_t),
+                             PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  TEST_ASSERT(block != MAP_FAILED, "Map the control block");
+  TEST_ASSERT(atomic_load(&block->magic) == CLOG_CONTROL_MAGIC &&
+                  block->version == CLOG_CONTROL_VERSION &&
+                  block->pid == (int64_t)getpid(),
+              "Header identifies the process");
+  TEST_ASSERT(atomic_load(&block->level) == CLOG_INFO &&
+                  atomic_load(&block->min_level) == CLOG_INFO,
+              "Block shows the current level");
+
+  clog_set_level(CLOG_WARN);
+  TEST_ASSERT(atomic_load(&block->level) == CLOG_WARN,
+              "Level changes are mirrored at once");
+
+  atomic_store(&block->requested_level, CLOG_DEBUG);
+  TEST_ASSERT(wait_applied(block), "Control thread takes the request");
+  TEST_ASSERT(CLOG_ENABLED(CLOG_DEBUG) && !CLOG_ENABLED(CLOG_TRACE) &&
+                  atomic_load(&block->level) == CLOG_DEBUG,
+              "Requested level applied to the running process");
+
+  atomic_store(&block->requested_level, 42);
+  TEST_ASSERT(wait_applied(block) && atomic_load(&block->level) == CLOG_DEBUG,
+              "Invalid request ignored");
+
+  unsigned int publishes = atomic_load(&block->publishes);
+  usleep(3 * CLOG_CONTROL_INTERVAL_MS * 1000);
+  TEST_ASSERT(atomic_load(&block->publishes) > publishes,
+              "Counters republished periodically");
+
+  TEST_ASSERT(clog_set_control(false), "Disable the control block");
+  TEST_ASSERT(access(path, F_OK) != 0 && atomic_load(&block->magic) == 0,
+              "Block removed and invalidated");
+  munmap(block, sizeof(clog_control_t));
+
+  clog_set_level(CLOG_TRACE);
+  TEST_END("Shared-Memory Control Block");
+}
+#else
+void test_control(void) {
+  printf("⚠️  Control block test skipped (POSIX only)\n");
+}
+#endif
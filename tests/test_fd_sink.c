@@ -0,0 +1,142 @@
+#include "../clog.h"
+#include <stdio.h>
+#include <string.h>
+#if !defined(_WIN32) && defined(_POSIX_THREADS)
+#include <fcntl.h>
+#include <pthread.h>
+#define HAS_FD_SINK_TEST 1
+#else
+#define HAS_FD_SINK_TEST 0
+#endif
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+#define PIPE_MESSAGES 4000
+
+#if HAS_FD_SINK_TEST
+typedef struct {
+  int fd;
+  int lines;
+  int in_order;
+} pipe_reader_t;
+
+/* Reads slowly so the non-blocking writer hits a full pipe */
+static void *pipe_reader_function(void *arg) {
+  pipe_reader_t *reader = (pipe_reader_t *)arg;
+  char buf[4096];
+  char line[256];
+  size_t line_len = 0;
+  ssize_t n;
+  reader->in_order = 1;
+  while ((n = read(reader->fd, buf, sizeof(buf))) > 0) {
+    for (ssize_t i = 0; i < n; i++) {
+      if (buf[i] != '\n') {
+        if (line_len < sizeof(line) - 1)
+          line[line_len++] = buf[i];
+        continue;
+      }
+      line[line_len] = '\0';
+      int value = -1;
+      const char *p = strstr(line, "Pipe message ");
+      if (p)
+        value = atoi(p + strlen("Pipe message "));
+      if (value != reader->lines)
+        reader->in_order = 0;
+      reader->lines++;
+      line_len = 0;
+    }
+    usleep(200);
+  }
+  return NULL;
+}
+
+static int count_fd_lines(const char *path, const char *needle) {
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return -1;
+  char buf[256];
+  int lines = 0;
+  while (fgets(buf, sizeof(buf), file)) {
+    if (strstr(buf, needle))
+      lines++;
+  }
+  fclose(file);
+  return lines;
+}
+
+extern void test_fd_sink(void) {
+  TEST_START("File Descriptor Sink");
+
+  int fd = open("test_fd_sink.log", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  TEST_ASSERT(fd >= 0, "Open log descriptor");
+  clog_set_output_fd(fd);
+  clog_set_show_timestamp(0);
+  clog_set_show_location(0);
+  INFO("Raw descriptor message");
+  clog_set_show_location(1);
+  WARN("With location");
+  TEST_ASSERT(clog_set_async(true), "Enable async mode");
+  for (int i = 0; i < 500; i++) {
+    INFO("Async writev message %d", i);
+  }
+  clog_flush();
+  TEST_ASSERT(clog_set_async(false), "Disable async mode");
+  clog_set_output_fd(-1);
+  clog_set_show_timestamp(1);
+  close(fd);
+
+  FILE *file = fopen("test_fd_sink.log", "r");
+  TEST_ASSERT(file != NULL, "Reopen log file");
+  char buf[256] = {0};
+  fgets(buf, sizeof(buf), file);
+  TEST_ASSERT(strcmp(buf, "[INFO] Raw descriptor message\n") == 0,
+              "Line written without stdio");
+  fgets(buf, sizeof(buf), file);
+  TEST_ASSERT(strstr(buf, "[WARN] With location  (test_fd_sink.c:") == buf,
+              "Location rendered on descriptor sink");
+  fclose(file);
+  TEST_ASSERT(count_fd_lines("test_fd_sink.log", "Async writev message") ==
+                  500,
+              "Async writer batches records with writev");
+  remove("test_fd_sink.log");
+
+  int fds[2];
+  TEST_ASSERT(pipe(fds) == 0, "Create pipe");
+  fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+  pipe_reader_t reader = {fds[0], 0, 0};
+  pthread_t thread;
+  pthread_create(&thread, NULL, pipe_reader_function, &reader);
+  clog_set_output_fd(fds[1]);
+  for (int i = 0; i < PIPE_MESSAGES; i++) {
+    INFO("Pipe message %d padded to make the pipe fill up quickly", i);
+  }
+  clog_set_output_fd(-1);
+  close(fds[1]);
+  pthread_join(thread, NULL);
+  close(fds[0]);
+  TEST_ASSERT(reader.lines == PIPE_MESSAGES,
+              "Full non-blocking pipe loses no lines");
+  TEST_ASSERT(reader.in_order, "Lines arrive whole and in order");
+  TEST_END("File Descriptor Sink");
+}
+#else
+void test_fd_sink(void) {
+  printf("⚠️  File descriptor sink test skipped (POSIX only)\n");
+}
+#endif
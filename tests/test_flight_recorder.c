@@ -0,0 +1,145 @@
+#include "../clog.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <string.h>
+#if !defined(_WIN32) && defined(_POSIX_THREADS)
+#include <pthread.h>
+#include <signal.h>
+#include <sys/wait.h>
+#define HAS_RECORDER_TEST 1
+#else
+#define HAS_RECORDER_TEST 0
+#endif
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+#define RECORDER_DUMP "test_recorder.dump"
+#define RECORDER_LOG "test_recorder.log"
+
+#if HAS_RECORDER_TEST
+static char recorder_text[4 * CLOG_RECORDER_SIZE];
+
+/* Reads a file into recorder_text */
+static size_t read_recorder(const char *path) {
+  return slurp(path, recorder_text, sizeof(recorder_text));
+}
+
+static int count_text(const char *needle) {
+  return count_matches(recorder_text, needle);
+}
+
+/* Logs more than a ring holds, then exits and leaves its ring behind */
+static void *recorder_thread_function(void *arg) {
+  (void)arg;
+  for (int i = 0; i < 2000; i++)
+    DEBUG("Wrapping line %d", i);
+  return NULL;
+}
+
+extern void test_flight_recorder(void) {
+  TEST_START("Flight Recorder");
+  remove(RECORDER_DUMP);
+
+  FILE *out = fopen(RECORDER_LOG, "w");
+  TEST_ASSERT(out != NULL, "Open log file");
+  clog_set_output(out);
+  clog_set_level(CLOG_INFO);
+  TEST_ASSERT(clog_set_flight_recorder(CLOG_DEBUG, RECORDER_DUMP),
+              "Enable the flight recorder");
+
+  TRACE("Below the recorder level");
+  DEBUG("Recorded debug line %d", 1);
+  INFO("Written info line");
+  clog_flush();
+  clog_dump_flight_recorder(-1);
+
+  read_recorder(RECORDER_LOG);
+  TEST_ASSERT(count_text("Written info line") == 1 &&
+                  count_text("Recorded debug line") == 0,
+              "Main output only gets its own level");
+  read_recorder(RECORDER_DUMP);
+  TEST_ASSERT(count_text("--- clog flight recorder: thread ") == 1,
+              "Dump names the recording thread");
+  TEST_ASSERT(count_text("[DEBUG] Recorded debug line 1") == 1,
+              "Dropped record kept in the ring");
+  TEST_ASSERT(count_text("Below the recorder level") == 0 &&
+                  count_text("Written info line") == 0,
+              "Ring holds only dropped records at its level");
+
+  size_t before = read_recorder(RECORDER_DUMP);
+  clog_dump_flight_recorder(-1);
+  TEST_ASSERT(read_recorder(RECORDER_DUMP) == before, "Dumped lines are not repeated");
+
+  pthread_t thread;
+  pthread_create(&thread, NULL, recorder_thread_function, NULL);
+  pthread_join(thread, NULL);
+  clog_dump_flight_recorder(-1);
+  size_t total = read_recorder(RECORDER_DUMP);
+  const char *wrapped = recorder_text + before;
+  TEST_ASSERT(total - before <= CLOG_RECORDER_SIZE + 96,
+              "A full ring dumps at most its size");
+  TEST_ASSERT(strstr(wrapped, "Wrapping line 1999 ") != NULL &&
+                  strstr(wrapped, "Wrapping line 0 ") == NULL,
+              "Oldest lines overwritten, newest kept");
+  const char *first_line = strchr(wrapped, '\n') + 1;
+  TEST_ASSERT(strncmp(first_line, "20", 2) == 0,
+              "Dump of a wrapped ring starts at a whole line");
+
+  DEBUG("History before the fatal record");
+  FATAL("Fatal record");
+  read_recorder(RECORDER_DUMP);
+  TEST_ASSERT(count_text("History before the fatal record") == 1,
+              "FATAL dumps the rings");
+
+  /* The child crashes; the parent checks what its handler dumped */
+  fflush(stdout);
+  pid_t pid = fork();
+  if (pid == 0) {
+    clog_install_crash_handlers();
+    DEBUG("Last words before the crash");
+    abort();
+  }
+  int status = 0;
+  waitpid(pid, &status, 0);
+  TEST_ASSERT(WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT,
+              "Crash handler re-raises the signal");
+  read_recorder(RECORDER_DUMP);
+  TEST_ASSERT(count_text("clog: fatal signal 6\n") == 1 &&
+                  count_text("Last words before the crash") == 1,
+              "SIGABRT dumps the rings");
+
+  TEST_ASSERT(clog_set_flight_recorder(CLOG_RECORDER_OFF, NULL),
+              "Disable the flight recorder");
+  DEBUG("Not recorded");
+  before = read_recorder(RECORDER_DUMP);
+  clog_dump_flight_recorder(-1);
+  TEST_ASSERT(read_recorder(RECORDER_DUMP) == before, "Nothing recorded when off");
+
+  clog_set_output(NULL);
+  fclose(out);
+  clog_set_level(CLOG_TRACE);
+  remove(RECORDER_LOG);
+  remove(RECORDER_DUMP);
+  TEST_END("Flight Recorder");
+}
+#else
+void test_flight_recorder(void) {
+  printf("⚠️  Flight recorder test skipped (POSIX only)\n");
+}
+#endif
@@ -0,0 +1,258 @@
+#include "../clog.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+#define FORMAT_CASES 200000
+
+static uint64_t format_rng = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t next_random(void) {
+  format_rng ^= format_rng << 13;
+  format_rng ^= format_rng >> 7;
+  format_rng ^= format_rng << 17;
+  return format_rng;
+}
+
+static unsigned int pick(unsigned int n) {
+  return (unsigned int)(next_random() % n);
+}
+
+static int fast_format(char *dst, size_t size, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int n = clog_vformat(dst, size, format, args);
+  va_end(args);
+  return n;
+}
+
+static int libc_format(char *dst, size_t size, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(dst, size, format, args);
+  va_end(args);
+  return n;
+}
+
+/* Doubles around the edges of the exact %f path: ties, tiny, huge */
+static double random_double(void) {
+  static const double specials[] = {0.0,     -0.0,     0.5,     1.5,
+                                    2.5,     0.125,    0.0625,  1e-7,
+                                    5e-7,    0.999999, 9.9999995, 1e15,
+                                    1e20,    1e30,     1.7e38,  1e300,
+                                    5e-324,  2.2250738585072014e-308,
+                                    123.456, -987.654321};
+  uint64_t bits;
+  switch (pick(4)) {
+  case 0:
+    return specials[pick(sizeof(specials) / sizeof(specials[0]))];
+  case 1:
+    /* Random bits, infinities and NaNs included */
+    bits = next_random();
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+  case 2:
+    /* Exact multiples of powers of two produce rounding ties */
+    return ((double)(int64_t)(next_random() % 2000001) - 1000000) /
+           (double)(1ULL << pick(30));
+  default: {
+    double scale = 1e-5;
+    for (int i = pick(20); i > 0; i--)
+      scale *= 10;
+    return (double)(int64_t)next_random() / 1e9 / scale;
+  }
+  }
+}
+
+static void random_spec(char *spec, char conv, bool star_width,
+                        bool star_prec) {
+  static const char *const lengths_int[] = {"", "", "hh", "h", "l", "ll",
+                                            "z", "j", "t"};
+  size_t n = 0;
+  spec[n++] = '%';
+  for (int i = pick(3); i > 0; i--)
+    spec[n++] = "-0+ "[pick(4)];
+  if (star_width)
+    spec[n++] = '*';
+  else if (pick(2))
+    n += (size_t)sprintf(spec + n, "%u", pick(30));
+  if (star_prec) {
+    spec[n++] = '.';
+    spec[n++] = '*';
+  } else if (pick(2)) {
+    spec[n++] = '.';
+    if (pick(4))
+      n += (size_t)sprintf(spec + n, "%u", pick(conv == 'f' ? 22 : 30));
+  }
+  if (conv == 'd' || conv == 'i' || conv == 'u' || conv == 'x' ||
+      conv == 'X')
+    n += (size_t)sprintf(spec + n, "%s", lengths_int[pick(9)]);
+  if (conv == 'f' && pick(4) == 0)
+    spec[n++] = 'l';
+  spec[n++] = conv;
+  spec[n] = '\0';
+}
+
+/* Formats one random value for conv; width and precision are passed
+ * first only when the spec takes them from '*' */
+static bool check_case(const char *format, char conv, bool starred, int width,
+                       int prec, size_t size) {
+  char fast[512], libc[512];
+  int a = 0, b = 0;
+  memset(fast, 'x', sizeof(fast));
+  memset(libc, 'x', sizeof(libc));
+  unsigned long long bits = next_random() >> pick(64);
+  double d = random_double();
+  static const char *const strings[] = {"", "a", "hello", "multi word text",
+                                        "0123456789abcdefghij"};
+  const char *str = strings[pick(5)];
+  int chr = ' ' + (int)pick(95);
+
+#define BOTH(value)                                                            \
+  do {                                                                         \
+    if (starred) {                                                             \
+      a = fast_format(fast, size, format, width, prec, value);                 \
+      b = libc_format(libc, size, format, width, prec, value);                 \
+    } else {                                                                   \
+      a = fast_format(fast, size, format, value);                              \
+      b = libc_format(libc, size, format, value);                              \
+    }                                                                          \
+  } while (0)
+  switch (conv) {
+  case 'f':
+    BOTH(d);
+    break;
+  case 's':
+    BOTH(str);
+    break;
+  case 'c':
+    BOTH(chr);
+    break;
+  case 'p':
+    BOTH((void *)(uintptr_t)(bits | 1));
+    break;
+  default:
+    BOTH(bits);
+    break;
+  }
+#undef BOTH
+  if (a != b || memcmp(fast, libc, sizeof(fast)) != 0) {
+    fprintf(stderr, "Mismatch for \"%s\" (size %zu): \"%.*s\" (%d) vs \"%.*s\" "
+                    "(%d)\n",
+            format, size, (int)(size ? size : 1), fast, a,
+            (int)(size ? size : 1), libc, b);
+    return false;
+  }
+  return true;
+}
+
+extern void test_format(void) {
+  TEST_START("Message Formatter");
+  char fast[256], libc[256];
+
+  /* Fixed cases: every supported conversion and the fallbacks */
+  int a = fast_format(fast, sizeof(fast), "%d|%5d|%-5d|%05d|%+d|% d|%.3d|%.0d",
+                      -42, 42, 42, -42, 42, 42, 7, 0);
+  int b = libc_format(libc, sizeof(libc), "%d|%5d|%-5d|%05d|%+d|% d|%.3d|%.0d",
+                      -42, 42, 42, -42, 42, 42, 7, 0);
+  TEST_ASSERT(a == b && strcmp(fast, libc) == 0, "Integer flags and widths");
+  a = fast_format(fast, sizeof(fast), "%hhd %hu %ld %lld %zu %jd %td %x %X",
+                  (char)-1, (unsigned short)65535, -1L, -9223372036854775807LL,
+                  (size_t)-1, (intmax_t)12, (ptrdiff_t)-3, 0xabcu, 0xabcu);
+  b = libc_format(libc, sizeof(libc), "%hhd %hu %ld %lld %zu %jd %td %x %X",
+                  (char)-1, (unsigned short)65535, -1L, -9223372036854775807LL,
+                  (size_t)-1, (intmax_t)12, (ptrdiff_t)-3, 0xabcu, 0xabcu);
+  TEST_ASSERT(a == b && strcmp(fast, libc) == 0, "Length modifiers");
+  a = fast_format(fast, sizeof(fast), "%s|%10s|%-10s|%.2s|%.*s|%c|%3c|%%",
+                  "abc", "abc", "abc", "abc", 3, "abcdef", 'x', 'y');
+  b = libc_format(libc, sizeof(libc), "%s|%10s|%-10s|%.2s|%.*s|%c|%3c|%%",
+                  "abc", "abc", "abc", "abc", 3, "abcdef", 'x', 'y');
+  TEST_ASSERT(a == b && strcmp(fast, libc) == 0, "Strings and characters");
+  a = fast_format(fast, sizeof(fast), "%f %.2f %10.3f %-10.1f|%+.0f %.1f %.1f",
+                  3.14159, 2.675, -1.5, 0.05, 2.5, 0.25, 0.35);
+  b = libc_format(libc, sizeof(libc), "%f %.2f %10.3f %-10.1f|%+.0f %.1f %.1f",
+                  3.14159, 2.675, -1.5, 0.05, 2.5, 0.25, 0.35);
+  TEST_ASSERT(a == b && strcmp(fast, libc) == 0, "Fixed-point doubles");
+  a = fast_format(fast, sizeof(fast), "%#x %o %e %g %5.1Lf", 255u, 8u, 1.5,
+                  2.5, (long double)1.25);
+  b = libc_format(libc, sizeof(libc), "%#x %o %e %g %5.1Lf", 255u, 8u, 1.5,
+                  2.5, (long double)1.25);
+  TEST_ASSERT(a == b && strcmp(fast, libc) == 0,
+              "Unsupported conversions fall back to vsnprintf");
+  a = fast_format(fast, 8, "%s and more", "truncated");
+  b = libc_format(libc, 8, "%s and more", "truncated");
+  TEST_ASSERT(a == b && strcmp(fast, libc) == 0,
+              "Truncation returns the full length");
+  TEST_ASSERT(fast_format(NULL, 0, "%d", 12345) == 5,
+              "Zero-size buffer only measures");
+
+  /* Random conversions, with random flags, widths and precisions, checked
+   * byte for byte against libc, including the truncated tail */
+  static const char convs[] = "diuxXcspf";
+  bool all_match = true;
+  for (int i = 0; i < FORMAT_CASES && all_match; i++) {
+    char conv = convs[pick(sizeof(convs) - 1)];
+    char spec[64], format[128];
+    random_spec(spec, conv, true, true);
+    snprintf(format, sizeof(format), "[%s]", spec);
+    int width = pick(8) == 0 ? -(int)pick(20) : (int)pick(25);
+    int prec = pick(8) == 0 ? -1 : (int)pick(conv == 'f' ? 25 : 30);
+    size_t size = pick(4) == 0 ? pick(12) : 512;
+    all_match = check_case(format, conv, true, width, prec, size);
+    if (all_match) {
+      /* The same conversion with width and precision in the format */
+      char *star = strchr(spec, '*');
+      char inline_spec[64];
+      size_t n = (size_t)(star - spec);
+      memcpy(inline_spec, spec, n);
+      n += (size_t)sprintf(inline_spec + n, "%d", width < 0 ? -width : width);
+      char *rest = star + 1;
+      if (*rest == '.' && rest[1] == '*') {
+        n += (size_t)sprintf(inline_spec + n, ".%d", prec < 0 ? 0 : prec);
+        rest += 2;
+      }
+      strcpy(inline_spec + n, rest);
+      snprintf(format, sizeof(format), "x%sy", inline_spec);
+      all_match = check_case(format, conv, false, 0, 0, size);
+    }
+  }
+  TEST_ASSERT(all_match, "Random conversions match vsnprintf byte for byte");
+
+  FILE *out = fopen("test_format.log", "w");
+  TEST_ASSERT(out != NULL, "Open log file");
+  clog_set_output(out);
+  clog_set_show_timestamp(0);
+  INFO("count=%d ratio=%.3f name=%-6s|", 7, 0.1235, "abc");
+  clog_set_show_timestamp(1);
+  clog_set_output(NULL);
+  fclose(out);
+  out = fopen("test_format.log", "r");
+  char line[256] = {0};
+  fgets(line, sizeof(line), out);
+  fclose(out);
+  const char *expected =
+      "[INFO] count=7 ratio=0.123 name=abc   |  (test_format.c:";
+  TEST_ASSERT(strncmp(line, expected, strlen(expected)) == 0 &&
+                  strstr(line, " in test_format)\n") != NULL,
+              "Log line formatted by the engine");
+  remove("test_format.log");
+  TEST_END("Message Formatter");
+}
@@ -0,0 +1,102 @@
+#include "../clog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+static int evaluations = 0;
+
+/* Stands in for an expensive debug helper */
+static const char *dump_state(void) {
+  evaluations++;
+  return "state";
+}
+
+extern void test_lazy_args(void) {
+  TEST_START("Lazy Argument Evaluation");
+
+  FILE *file = fopen("test_lazy_args.log", "w");
+  TEST_ASSERT(file != NULL, "Open log file");
+  clog_set_output(file);
+  clog_set_show_timestamp(0);
+  clog_set_show_location(0);
+  clog_set_level(CLOG_WARN);
+
+  for (int i = 0; i < 100; i++) {
+    TRACE("state=%s", dump_state());
+    DEBUG("state=%s", dump_state());
+    INFO("state=%s", dump_state());
+    LOG(CLOG_DEBUG, 0, "state=%s", dump_state());
+    CLOG_EVERY_N(CLOG_INFO, 2, "state=%s", dump_state());
+    CLOG_KV(CLOG_DEBUG, CLOG_FIELDS(clog_field_str("state", dump_state())),
+            "Fields");
+    CLOG_CAT_INFO("lazy", "state=%s", dump_state());
+  }
+  TEST_ASSERT(evaluations == 0, "Filtered calls never evaluate arguments");
+
+  TEST_ASSERT(!CLOG_ENABLED(CLOG_INFO) && CLOG_ENABLED(CLOG_WARN),
+              "CLOG_ENABLED follows the runtime level");
+  if (CLOG_ENABLED(CLOG_DEBUG)) {
+    dump_state();
+    DEBUG("Guarded block");
+  }
+  TEST_ASSERT(evaluations == 0, "Guarded block skipped");
+
+  WARN("state=%s", dump_state());
+  if (CLOG_ENABLED(CLOG_ERROR))
+    ERROR("state=%s", dump_state());
+  TEST_ASSERT(evaluations == 2, "Enabled calls evaluate arguments once");
+
+  /* The macros are single statements */
+  if (evaluations)
+    WARN("Unbraced if");
+  else
+    WARN("Unreachable");
+
+  clog_sink_config_t config = {stderr, -1, CLOG_DEBUG, CLOG_COLOR_NEVER,
+                               CLOG_FORMAT_TEXT};
+  int sink = clog_add_sink(&config);
+  TEST_ASSERT(CLOG_ENABLED(CLOG_DEBUG) && !CLOG_ENABLED(CLOG_TRACE),
+              "CLOG_ENABLED includes the sinks");
+  clog_remove_sink(sink);
+  TEST_ASSERT(!CLOG_ENABLED(CLOG_DEBUG), "Removing the sink raises the gate");
+
+  clog_set_level(CLOG_TRACE);
+  clog_set_show_timestamp(1);
+  clog_set_show_location(1);
+  clog_set_output(NULL);
+  fclose(file);
+
+  file = fopen("test_lazy_args.log", "r");
+  TEST_ASSERT(file != NULL, "Reopen log file");
+  char buf[256] = {0};
+  fgets(buf, sizeof(buf), file);
+  TEST_ASSERT(strcmp(buf, "[WARN] state=state\n") == 0, "WARN written");
+  fgets(buf, sizeof(buf), file);
+  TEST_ASSERT(strcmp(buf, "[ERROR] state=state\n") == 0, "ERROR written");
+  fgets(buf, sizeof(buf), file);
+  TEST_ASSERT(strcmp(buf, "[WARN] Unbraced if\n") == 0,
+              "Macro works as an if body");
+  TEST_ASSERT(fgets(buf, sizeof(buf), file) == NULL,
+              "Nothing below WARN reached the output");
+  fclose(file);
+  remove("test_lazy_args.log");
+  TEST_END("Lazy Argument Evaluation");
+}
@@ -0,0 +1,117 @@
+#include "../clog.h"
+#include <stdio.h>
+#include <string.h>
+#if !defined(_WIN32) && defined(_POSIX_THREADS)
+#include <pthread.h>
+#define HAS_MMAP_TEST 1
+#else
+#define HAS_MMAP_TEST 0
+#endif
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+#define MMAP_THREADS 4
+#define MMAP_MESSAGES 3000
+
+#if HAS_MMAP_TEST
+static void *mmap_thread_function(void *arg) {
+  int id = *(int *)arg;
+  for (int i = 0; i < MMAP_MESSAGES; i++) {
+    INFO("mmap thread %d message %d", id, i);
+  }
+  return NULL;
+}
+
+/* Checks every line is whole and each thread's lines are in order */
+static int verify_mmap_file(const char *path, long *size, int *lines) {
+  FILE *file = fopen(path, "rb");
+  if (!file)
+    return 0;
+  int next[MMAP_THREADS] = {0};
+  char buf[256];
+  int ok = 1;
+  *lines = 0;
+  *size = 0;
+  while (fgets(buf, sizeof(buf), file)) {
+    size_t len = strlen(buf);
+    int id, i;
+    *size += (long)len;
+    (*lines)++;
+    if (buf[len - 1] != '\n') {
+      ok = 0;
+    } else if (sscanf(buf, "[INFO] mmap thread %d message %d", &id, &i) == 2) {
+      if (id < 0 || id >= MMAP_THREADS || i != next[id]++)
+        ok = 0;
+    } else if (strcmp(buf, "[INFO] Appended after reopening\n") != 0) {
+      ok = 0;
+    }
+  }
+  fseek(file, 0, SEEK_END);
+  if (ftell(file) != *size)
+    ok = 0; /* A NUL byte or partial line would stop fgets short */
+  fclose(file);
+  return ok;
+}
+
+extern void test_mmap(void) {
+  TEST_START("Memory-Mapped Sink");
+
+  const char *path = "test_mmap.log";
+  remove(path);
+  clog_set_show_timestamp(0);
+  clog_set_show_location(0);
+
+  /* Tiny segments so the run rolls over many times */
+  TEST_ASSERT(clog_set_output_mmap(path, 1), "Open mapped log");
+  pthread_t threads[MMAP_THREADS];
+  int ids[MMAP_THREADS];
+  for (int i = 0; i < MMAP_THREADS; i++) {
+    ids[i] = i;
+    pthread_create(&threads[i], NULL, mmap_thread_function, &ids[i]);
+  }
+  for (int i = 0; i < MMAP_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  TEST_ASSERT(clog_set_output_mmap(NULL, 0), "Close mapped log");
+
+  long size;
+  int lines;
+  TEST_ASSERT(verify_mmap_file(path, &size, &lines),
+              "Lines are whole, ordered and the tail is trimmed");
+  TEST_ASSERT(lines == MMAP_THREADS * MMAP_MESSAGES,
+              "No line lost across segment rollovers");
+
+  TEST_ASSERT(clog_set_output_mmap(path, 0), "Reopen mapped log");
+  INFO("Appended after reopening");
+  clog_set_output(stderr);
+  long appended_size;
+  TEST_ASSERT(verify_mmap_file(path, &appended_size, &lines) &&
+                  lines == MMAP_THREADS * MMAP_MESSAGES + 1,
+              "Reopening appends after the existing lines");
+
+  clog_set_show_timestamp(1);
+  clog_set_show_location(1);
+  remove(path);
+  TEST_END("Memory-Mapped Sink");
+}
+#else
+void test_mmap(void) {
+  printf("⚠️  Memory-mapped sink test skipped (POSIX only)\n");
+}
+#endif
@@ -0,0 +1,113 @@
+#include "../clog.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+/* Renders one record through clog_format_record */
+static size_t render(char *dst, size_t size, clog_level_t level, bool ansi,
+                     const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  size_t len = clog_format_record(dst, size, level, "src/dir/pattern.c", 42,
+                                  "handler", NULL, 0, format, args, ansi,
+                                  NULL);
+  va_end(args);
+  return len;
+}
+
+extern void test_pattern(void) {
+  TEST_START("Pattern Layouts");
+  char buf[CLOG_MAX_LINE_SIZE];
+  char expected[256];
+
+  TEST_ASSERT(clog_set_pattern("[%L] %m (%f:%l %F)"), "Set a pattern");
+  size_t len = render(buf, sizeof(buf), CLOG_WARN, false, "Disk %d%%", 91);
+  TEST_ASSERT(strcmp(buf, "[WARN] Disk 91% (pattern.c:42 handler)\n") == 0 &&
+                  len == strlen(buf),
+              "Fields, literals and message rendered");
+
+  clog_set_pattern("%-5L|%5L|%%|%6l|%-6l|");
+  render(buf, sizeof(buf), CLOG_INFO, false, "unused");
+  TEST_ASSERT(strcmp(buf, "INFO | INFO|%|    42|42    |\n") == 0,
+              "Widths pad on either side");
+  render(buf, sizeof(buf), (clog_level_t)9, false, "unused");
+  TEST_ASSERT(strncmp(buf, "UNKN | UNKN|", 12) == 0,
+              "Out-of-range levels render as UNKN");
+
+  clog_set_pattern("%C%L%R %m");
+  render(buf, sizeof(buf), CLOG_ERROR, true, "Colored");
+  snprintf(expected, sizeof(expected), "%sERROR%s Colored\n", CLOG_RED,
+           CLOG_RESET);
+  TEST_ASSERT(strcmp(buf, expected) == 0, "Level color pre-rendered");
+  render(buf, sizeof(buf), CLOG_ERROR, false, "Colored");
+  TEST_ASSERT(strcmp(buf, "ERROR Colored\n") == 0,
+              "Colors dropped without ANSI");
+
+  clog_set_pattern("%P %t %e %m");
+  render(buf, sizeof(buf), CLOG_INFO, false, "ids");
+  long pid = -1, tid = -1, elapsed = -1;
+  TEST_ASSERT(sscanf(buf, "%ld %ld %ld ids", &pid, &tid, &elapsed) == 3 &&
+                  pid == (long)getpid() && tid > 0 && elapsed >= 0,
+              "Process, thread and elapsed time rendered");
+
+  const char *bad[] = {"%m %m", "%q", "trailing %", "%-"};
+  bool rejected = true;
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    rejected = rejected && !clog_set_pattern(bad[i]);
+  char huge[CLOG_PATTERN_TEXT_SIZE + 8];
+  memset(huge, 'x', sizeof(huge) - 1);
+  huge[sizeof(huge) - 1] = '\0';
+  rejected = rejected && !clog_set_pattern(huge);
+  TEST_ASSERT(rejected, "Malformed and oversized patterns rejected");
+  render(buf, sizeof(buf), CLOG_INFO, false, "kept");
+  TEST_ASSERT(strncmp(buf, "kept", 4) != 0 && strstr(buf, " kept\n"),
+              "Rejected pattern keeps the previous one");
+
+  /* The main output, categories and sinks all use the pattern */
+  FILE *file = fopen("test_pattern.log", "w");
+  TEST_ASSERT(file != NULL, "Open log file");
+  clog_set_output(file);
+  clog_set_pattern("%-5L %c|%m");
+  INFO("Plain %d", 1);
+  clog_set_category_level("pattern", CLOG_TRACE);
+  CLOG_CAT_DEBUG("pattern.test", "Categorized %d", 2);
+  CLOG_KV(CLOG_WARN, CLOG_FIELDS(clog_field_int("n", 3)), "With fields");
+  clog_clear_category_level("pattern");
+  clog_set_pattern(NULL);
+  clog_set_show_timestamp(0);
+  clog_set_show_location(0);
+  INFO("Built-in");
+  clog_set_show_timestamp(1);
+  clog_set_show_location(1);
+  clog_set_output(NULL);
+  fclose(file);
+
+  static char text[4096];
+  slurp("test_pattern.log", text, sizeof(text));
+  TEST_ASSERT(strcmp(text, "INFO  |Plain 1\n"
+                           "DEBUG pattern.test|Categorized 2\n"
+                           "WARN  |With fields n=3\n"
+                           "[INFO] Built-in\n") == 0,
+              "Output follows the pattern until it is cleared");
+  remove("test_pattern.log");
+  TEST_END("Pattern Layouts");
+}
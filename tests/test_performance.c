@@ -31,5 +31,47 @@ extern void test_performance(void) {
   double elapsed_ms = (double)(end - start) * 1000.0 / CLOCKS_PER_SEC;
   printf("Logged %d messages in %.2f ms\n", message_count, elapsed_ms);
   TEST_ASSERT(elapsed_ms < 10000, "Performance within timeout");
+
+  static const struct {
+    const char *name;
+    clog_level_t level;
+    size_t bytes;
+    unsigned int interval_ms;
+  } policies[] = {
+      {"flush every line", CLOG_TRACE, 0, 0},
+      {"flush at ERROR+", CLOG_ERROR, 0, 0},
+      {"flush every 16 KiB", CLOG_FLUSH_LEVEL_NONE, 16 * 1024, 0},
+      {"flush every 100 ms", CLOG_FLUSH_LEVEL_NONE, 0, 100},
+  };
+  FILE *file = fopen("test_performance.log", "w");
+  TEST_ASSERT(file != NULL, "Open log file");
+  clog_set_output(file);
+  for (size_t p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+    clog_set_flush_policy(policies[p].level, policies[p].bytes,
+                          policies[p].interval_ms);
+    start = clock();
+    for (int i = 0; i < message_count; i++) {
+      TRACE("Perf message %d", i);
+    }
+    clog_flush();
+    end = clock();
+    elapsed_ms = (double)(end - start) * 1000.0 / CLOCKS_PER_SEC;
+    printf("%-20s %8.2f ms (%.0f msg/s)\n", policies[p].name, elapsed_ms,
+           elapsed_ms > 0 ? message_count * 1000.0 / elapsed_ms : 0.0);
+    TEST_ASSERT(elapsed_ms < 10000, "Policy performance within timeout");
+  }
+  clog_set_flush_policy(CLOG_TRACE, 0, 0);
+  clog_set_output(NULL);
+  fclose(file);
+
+  file = fopen("test_performance.log", "r");
+  TEST_ASSERT(file != NULL, "Reopen log file");
+  char buf[256];
+  int lines = 0;
+  while (fgets(buf, sizeof(buf), file))
+    lines++;
+  fclose(file);
+  remove("test_performance.log");
+  TEST_ASSERT(lines == message_count * 4, "Every buffered line was flushed");
   TEST_END("Performance");
 }
@@ -0,0 +1,111 @@
+/* Report suppressed counts quickly so the test does not wait seconds */
+#define CLOG_SUPPRESS_REPORT_MS 50
+#include "../clog.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#define usleep(t) Sleep(t / 1000)
+#else
+#include <unistd.h>
+#endif
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+static int evaluated = 0;
+
+static int count_evaluation(void) { return ++evaluated; }
+
+/* Value reported by the first "Suppressed N messages" line */
+static long first_suppressed_report(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return -1;
+  char buf[256];
+  long value = -1;
+  while (value < 0 && fgets(buf, sizeof(buf), file)) {
+    const char *p = strstr(buf, "Suppressed ");
+    if (p)
+      value = atol(p + strlen("Suppressed "));
+  }
+  fclose(file);
+  return value;
+}
+
+static void limited_call(int i) {
+  CLOG_RATE_LIMIT(CLOG_WARN, 5, "Limited %d", i);
+}
+
+extern void test_rate_limit(void) {
+  TEST_START("Rate Limiting and Sampling");
+
+  FILE *file = fopen("test_rate_limit.log", "w");
+  TEST_ASSERT(file != NULL, "Open log file");
+  clog_set_output(file);
+  clog_set_show_timestamp(0);
+  clog_set_level(CLOG_INFO);
+
+  for (int i = 0; i < 100; i++) {
+    CLOG_EVERY_N(CLOG_INFO, 10, "Every tenth %d", count_evaluation());
+  }
+  TEST_ASSERT(evaluated == 10, "EVERY_N skips formatting of suppressed calls");
+
+  for (int i = 0; i < 100; i++) {
+    CLOG_FIRST_N(CLOG_INFO, 3, "First three %d", i);
+  }
+
+  evaluated = 0;
+  for (int i = 0; i < 100; i++) {
+    CLOG_EVERY_N(CLOG_TRACE, 1, "Below level %d", count_evaluation());
+  }
+  TEST_ASSERT(evaluated == 0, "Disabled levels never reach the site");
+
+  for (int i = 0; i < 100; i++) {
+    limited_call(i);
+  }
+  usleep(60000);
+  limited_call(100);
+
+  clog_set_output(stderr);
+  clog_set_show_timestamp(1);
+  clog_set_level(CLOG_TRACE);
+  fclose(file);
+
+  TEST_ASSERT(count_lines("test_rate_limit.log", "Every tenth") == 10,
+              "EVERY_N logs one call in n");
+  TEST_ASSERT(count_lines("test_rate_limit.log", "First three") == 3,
+              "FIRST_N logs only the first n calls");
+  TEST_ASSERT(count_lines("test_rate_limit.log", "Below level") == 0,
+              "Filtered sampling site stays silent");
+
+  /* The loop may straddle a second boundary and get two windows */
+  int limited = count_lines("test_rate_limit.log", "Limited ");
+  TEST_ASSERT(limited >= 5 && limited <= 11,
+              "RATE_LIMIT caps calls per second");
+  /* Whether or not the last call got through, it flushes the count, so
+   * logged and reported calls add up to all 101 */
+  long reported = first_suppressed_report("test_rate_limit.log");
+  TEST_ASSERT(reported > 0 && reported + limited == 101,
+              "Suppressed count reported for the site");
+  remove("test_rate_limit.log");
+
+  TEST_END("Rate Limiting and Sampling");
+}
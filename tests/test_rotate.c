@@ -0,0 +1,152 @@
+#include "../clog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if !defined(_WIN32) && defined(_POSIX_THREADS)
+#include <unistd.h>
+#define HAS_ROTATE_TEST 1
+#else
+#define HAS_ROTATE_TEST 0
+#endif
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+#if HAS_ROTATE_TEST
+#define ROTATE_PATH "test_rotate.log"
+
+static bool file_exists(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (file)
+    fclose(file);
+  return file != NULL;
+}
+
+/* Returns the first message number in a file, checking the rest follow on
+ * in order; -1 if the file is missing or out of order */
+static int first_message(const char *path, int *last) {
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return -1;
+  char buf[256];
+  int first = -1;
+  *last = -1;
+  while (fgets(buf, sizeof(buf), file)) {
+    int n;
+    if (sscanf(buf, "[INFO] Rotating message %d", &n) != 1 ||
+        (*last >= 0 && n != *last + 1)) {
+      first = -1;
+      break;
+    }
+    if (first < 0)
+      first = n;
+    *last = n;
+  }
+  fclose(file);
+  return first;
+}
+
+static void log_slowly(int from, int to) {
+  for (int i = from; i < to; i++) {
+    INFO("Rotating message %d with some padding to fill the file", i);
+    /* Give the rotation thread time to prepare the next file */
+    if (i % 20 == 19)
+      usleep(2000);
+  }
+}
+
+static void remove_rotated(void) {
+  const char *names[] = {ROTATE_PATH,         ROTATE_PATH ".1",
+                         ROTATE_PATH ".2",    ROTATE_PATH ".3",
+                         ROTATE_PATH ".4",    ROTATE_PATH ".1.gz",
+                         ROTATE_PATH ".2.gz", ROTATE_PATH ".next"};
+  for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+    remove(names[i]);
+  }
+}
+
+extern void test_rotate(void) {
+  TEST_START("Rotating File Sink");
+
+  remove_rotated();
+  clog_set_show_timestamp(0);
+  clog_set_show_location(0);
+
+  TEST_ASSERT(clog_set_output_rotating(ROTATE_PATH, 4096, CLOG_ROTATE_NEVER, 3),
+              "Open rotating sink");
+  log_slowly(0, 400);
+  TEST_ASSERT(clog_set_output_rotating(NULL, 0, CLOG_ROTATE_NEVER, 0),
+              "Close rotating sink");
+
+  int last, last1, last2, last3;
+  int first = first_message(ROTATE_PATH, &last);
+  int first1 = first_message(ROTATE_PATH ".1", &last1);
+  int first2 = first_message(ROTATE_PATH ".2", &last2);
+  int first3 = first_message(ROTATE_PATH ".3", &last3);
+  TEST_ASSERT(first3 >= 0 && first2 == last3 + 1 && first1 == last2 + 1 &&
+                  first == last1 + 1 && last == 399,
+              "Rotated files hold consecutive, whole lines");
+  TEST_ASSERT(!file_exists(ROTATE_PATH ".4"), "Only keep files are retained");
+  TEST_ASSERT(!file_exists(ROTATE_PATH ".next"),
+              "Unused successor removed on close");
+
+  /* Reopening appends and counts the existing size toward the limit */
+  TEST_ASSERT(clog_set_output_rotating(ROTATE_PATH, 1 << 20, CLOG_ROTATE_NEVER,
+                                       3),
+              "Reopen rotating sink");
+  INFO("Rotating message %d with some padding to fill the file", 400);
+  clog_set_output(stderr);
+  TEST_ASSERT(first_message(ROTATE_PATH, &last) == first && last == 400,
+              "Reopened sink appends to the active file");
+
+  if (system("gzip --version > /dev/null 2>&1") == 0) {
+    remove_rotated();
+    clog_set_rotate_compress(CLOG_COMPRESS_GZIP);
+    TEST_ASSERT(clog_set_output_rotating(ROTATE_PATH, 4096, CLOG_ROTATE_NEVER,
+                                         2),
+                "Open compressing sink");
+    log_slowly(0, 200);
+    clog_set_output(stderr);
+    clog_set_rotate_compress(CLOG_COMPRESS_NONE);
+    TEST_ASSERT(file_exists(ROTATE_PATH ".1.gz") &&
+                    file_exists(ROTATE_PATH ".2.gz") &&
+                    !file_exists(ROTATE_PATH ".1"),
+                "Rotated files compressed off the logging path");
+  } else {
+    printf("⚠️  gzip not installed, compression check skipped\n");
+  }
+
+  time_t now = time(NULL);
+  time_t hour = clog_rotate_deadline(now, CLOG_ROTATE_HOURLY);
+  time_t day = clog_rotate_deadline(now, CLOG_ROTATE_DAILY);
+  long offset = clog_utc_offset(now);
+  TEST_ASSERT(hour > now && hour <= now + 3600 && (hour + offset) % 3600 == 0,
+              "Hourly rotation at the top of the local hour");
+  TEST_ASSERT(day > now && day <= now + 86400 && (day + offset) % 86400 == 0,
+              "Daily rotation at local midnight");
+
+  remove_rotated();
+  clog_set_show_timestamp(1);
+  clog_set_show_location(1);
+  TEST_END("Rotating File Sink");
+}
+#else
+void test_rotate(void) {
+  printf("⚠️  Rotating file sink test skipped (POSIX only)\n");
+}
+#endif
@@ -0,0 +1,97 @@
+#include "../clog.h"
+#include <stdio.h>
+#include <time.h>
+#ifdef _POSIX_THREADS
+#include <pthread.h>
+#define HAS_THREADS 1
+#else
+#define HAS_THREADS 0
+#endif
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+#define SCALING_MAX_THREADS 8
+#define SCALING_TOTAL_MESSAGES 80000
+
+#ifdef _WIN32
+#define NULL_DEVICE "NUL"
+#else
+#define NULL_DEVICE "/dev/null"
+#endif
+
+#if HAS_THREADS
+typedef struct {
+  int messages;
+  int logged;
+} scaling_data_t;
+
+static void *scaling_log_function(void *arg) {
+  scaling_data_t *data = (scaling_data_t *)arg;
+  for (int i = 0; i < data->messages; i++) {
+    INFO("Scaling message %d with payload %s and value %.3f", i,
+         "abcdefghijklmnopqrstuvwxyz", i * 0.5);
+    data->logged++;
+  }
+  return NULL;
+}
+
+static double scaling_now_ms(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+extern void test_throughput_scaling(void) {
+  TEST_START("Throughput Scaling");
+  FILE *sink = fopen(NULL_DEVICE, "w");
+  TEST_ASSERT(sink != NULL, "Open null device");
+  clog_set_output(sink);
+
+  for (int n = 1; n <= SCALING_MAX_THREADS; n *= 2) {
+    pthread_t threads[SCALING_MAX_THREADS];
+    scaling_data_t data[SCALING_MAX_THREADS];
+    int per_thread = SCALING_TOTAL_MESSAGES / n;
+
+    double start = scaling_now_ms();
+    for (int i = 0; i < n; i++) {
+      data[i].messages = per_thread;
+      data[i].logged = 0;
+      pthread_create(&threads[i], NULL, scaling_log_function, &data[i]);
+    }
+    int logged = 0;
+    for (int i = 0; i < n; i++) {
+      pthread_join(threads[i], NULL);
+      logged += data[i].logged;
+    }
+    double elapsed_ms = scaling_now_ms() - start;
+
+    printf("%d thread(s): %d messages in %.2f ms (%.0f msg/s)\n", n, logged,
+           elapsed_ms, elapsed_ms > 0 ? logged * 1000.0 / elapsed_ms : 0.0);
+    TEST_ASSERT(logged == per_thread * n, "All scaling messages logged");
+  }
+
+  clog_set_output(NULL);
+  fclose(sink);
+  TEST_END("Throughput Scaling");
+}
+#else
+void test_throughput_scaling(void) {
+  printf("⚠️  Throughput scaling test skipped (pthread not available)\n");
+}
+#endif
@@ -0,0 +1,64 @@
+/* Uses the single instance defined in test_shared_impl.c */
+#define CLOG_SHARED
+#include "../clog.h"
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+extern const void *shared_impl_level_address(void);
+extern void shared_impl_log(void);
+
+extern void test_shared(void) {
+  TEST_START("Shared Implementation Mode");
+
+  TEST_ASSERT(shared_impl_level_address() == (const void *)&clog_min_level,
+              "Both files see the same state");
+
+  FILE *file = fopen("test_shared.log", "w");
+  TEST_ASSERT(file != NULL, "Open log file");
+  clog_set_output(file);
+  clog_set_show_timestamp(0);
+  clog_set_show_location(0);
+  clog_set_level(CLOG_WARN);
+  INFO("Info from the test unit");
+  WARN("Warning from the test unit");
+  shared_impl_log();
+  clog_set_level(CLOG_TRACE);
+  clog_set_output(stderr);
+  clog_set_show_timestamp(1);
+  clog_set_show_location(1);
+  fclose(file);
+
+  file = fopen("test_shared.log", "r");
+  TEST_ASSERT(file != NULL, "Reopen log file");
+  char buf[256] = {0};
+  fgets(buf, sizeof(buf), file);
+  TEST_ASSERT(strcmp(buf, "[WARN] Warning from the test unit\n") == 0,
+              "Level set here filters this file");
+  fgets(buf, sizeof(buf), file);
+  TEST_ASSERT(
+      strcmp(buf, "[WARN] Warning from the implementation unit\n") == 0,
+      "Level and output set here apply to the other file");
+  TEST_ASSERT(fgets(buf, sizeof(buf), file) == NULL, "No filtered lines");
+  fclose(file);
+  remove("test_shared.log");
+
+  TEST_END("Shared Implementation Mode");
+}
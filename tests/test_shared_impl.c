@@ -0,0 +1,14 @@
+/* The one translation unit that instantiates the shared library state used
+ * by test_shared.c */
+#define CLOG_IMPLEMENTATION
+#include "../clog.h"
+
+extern const void *shared_impl_level_address(void);
+extern void shared_impl_log(void);
+
+const void *shared_impl_level_address(void) { return &clog_min_level; }
+
+void shared_impl_log(void) {
+  INFO("Info from the implementation unit");
+  WARN("Warning from the implementation unit");
+}
@@ -1,7 +1,9 @@
 #include "../clog.h"
+#include "test_util.h"
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #ifdef _WIN32
 #include <windows.h>
 #define usleep(t) Sleep(t / 1000)
@@ -39,6 +41,16 @@ static void signal_handler(int sig) {
   signal(SIGINT, signal_handler);
 }
 
+static void formatted_signal_handler(int sig) {
+  static unsigned int calls = 0;
+  calls++;
+  clog_signal_logf(CLOG_WARN, "sig=%d calls=%u hex=%08x neg=%ld size=%zu "
+                   "ptr=%p str=%s nul=%s chr=%c pct=%%",
+                   sig, calls, 0xbeefu, -42L, (size_t)123456,
+                   (void *)0x1234, "text", (const char *)NULL, 'Z');
+  clog_signal_logf(CLOG_DEBUG, "below the output level");
+}
+
 extern void test_signal_safety(void) {
   TEST_START("Signal Safety");
   signal(SIGINT, signal_handler);
@@ -50,5 +62,34 @@ extern void test_signal_safety(void) {
   TEST_ASSERT(signal_log_count >= 5, "Signal handler called 5 times");
   TEST_ASSERT(signal_test_complete == 1, "Signal test complete");
   signal(SIGINT, SIG_DFL);
+
+  FILE *out = fopen("test_signal.log", "w");
+  TEST_ASSERT(out != NULL, "Open log file");
+  clog_set_output(out);
+  clog_set_level(CLOG_INFO);
+  clog_set_show_timestamp(0);
+  signal(SIGINT, formatted_signal_handler);
+  raise(SIGINT);
+  clog_set_show_timestamp(1);
+  raise(SIGINT);
+  signal(SIGINT, SIG_DFL);
+  clog_set_output(NULL);
+  fclose(out);
+  clog_set_level(CLOG_TRACE);
+
+  char buf[1024];
+  slurp("test_signal.log", buf, sizeof(buf));
+  const char *expected = "[WARN] sig=2 calls=1 hex=0000beef neg=-42 "
+                         "size=123456 ptr=0x1234 str=text nul=(null) chr=Z "
+                         "pct=%\n";
+  TEST_ASSERT(strncmp(buf, expected, strlen(expected)) == 0,
+              "Formatted line written to the output descriptor");
+  const char *second = buf + strlen(expected);
+  TEST_ASSERT(strlen(second) > 20 && second[4] == '-' && second[19] == ' ' &&
+                  strncmp(second + 20, "[WARN] sig=2 calls=2 ", 21) == 0,
+              "Timestamp precedes the level tag");
+  TEST_ASSERT(strstr(buf, "below the output level") == NULL,
+              "Output level applies to signal lines");
+  remove("test_signal.log");
   TEST_END("Signal Safety");
 }
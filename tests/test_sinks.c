@@ -0,0 +1,131 @@
+#include "../clog.h"
+#include "test_util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+extern void test_sinks(void) {
+  TEST_START("Multiple Sinks");
+  static char main_log[65536], json_a[65536], json_b[65536], errors[65536];
+
+  FILE *main_out = fopen("test_sinks_main.log", "w");
+  FILE *json_out_a = fopen("test_sinks_a.json", "w");
+  FILE *json_out_b = fopen("test_sinks_b.json", "w");
+  FILE *error_out = fopen("test_sinks_errors.log", "w");
+  TEST_ASSERT(main_out && json_out_a && json_out_b && error_out,
+              "Open sink files");
+
+  clog_set_output(main_out);
+  clog_set_level(CLOG_WARN);
+  TEST_ASSERT(clog_min_level == CLOG_WARN, "Gate follows the main output");
+
+  clog_sink_config_t config = {json_out_a, -1, CLOG_DEBUG, CLOG_COLOR_NEVER,
+                               CLOG_FORMAT_JSON};
+  int json_a_id = clog_add_sink(&config);
+  config.fp = json_out_b;
+  int json_b_id = clog_add_sink(&config);
+  clog_sink_config_t error_config = {error_out, -1, CLOG_ERROR,
+                                     CLOG_COLOR_AUTO, CLOG_FORMAT_TEXT};
+  int error_id = clog_add_sink(&error_config);
+  TEST_ASSERT(json_a_id > 0 && json_b_id > 0 && error_id > 0 &&
+                  json_a_id != json_b_id,
+              "Sinks registered with distinct ids");
+  TEST_ASSERT(clog_min_level == CLOG_DEBUG,
+              "Gate is the lowest level across sinks");
+
+  TRACE("Sink trace");
+  DEBUG("Sink debug");
+  WARN("Sink warn");
+  ERROR("Sink error %d", 42);
+  clog_flush();
+
+  slurp("test_sinks_main.log", main_log, sizeof(main_log));
+  slurp("test_sinks_a.json", json_a, sizeof(json_a));
+  slurp("test_sinks_b.json", json_b, sizeof(json_b));
+  slurp("test_sinks_errors.log", errors, sizeof(errors));
+  TEST_ASSERT(!strstr(main_log, "Sink trace") && !strstr(json_a, "Sink trace"),
+              "Record below every level reaches no sink");
+  TEST_ASSERT(!strstr(main_log, "Sink debug") &&
+                  strstr(main_log, "Sink warn") &&
+                  strstr(main_log, "Sink error 42"),
+              "Main output keeps its own level");
+  TEST_ASSERT(count_matches(json_a, "{\"ts\":") == 3 &&
+                  strstr(json_a, "\"msg\":\"Sink debug\""),
+              "JSON sink receives DEBUG and above");
+  TEST_ASSERT(strcmp(json_a, json_b) == 0,
+              "Sinks sharing a layout get the same rendering");
+  TEST_ASSERT(count_matches(errors, "Sink") == 1 &&
+                  strstr(errors, "[ERROR] Sink error 42") &&
+                  !strstr(errors, "\x1B["),
+              "ERROR sink gets uncolored text, ERROR only");
+
+  TEST_ASSERT(clog_remove_sink(json_a_id), "Remove a sink");
+  TEST_ASSERT(!clog_remove_sink(json_a_id), "Removing twice fails");
+  TEST_ASSERT(clog_min_level == CLOG_DEBUG, "Gate kept by the other sink");
+  TEST_ASSERT(clog_remove_sink(json_b_id), "Remove the second JSON sink");
+  TEST_ASSERT(clog_min_level == CLOG_WARN, "Gate rises back to WARN");
+
+  /* Through the async queue the main line is the copy rendered for sinks */
+  clog_set_level(CLOG_INFO);
+  config.fp = json_out_a;
+  config.format = CLOG_FORMAT_TEXT;
+  config.level = CLOG_INFO;
+  json_a_id = clog_add_sink(&config);
+  TEST_ASSERT(clog_set_async(true), "Enable async mode");
+  for (int i = 0; i < 200; i++)
+    INFO("Async fan-out %d", i);
+  ERROR("Async error");
+  clog_flush();
+  TEST_ASSERT(clog_set_async(false), "Disable async mode");
+  slurp("test_sinks_main.log", main_log, sizeof(main_log));
+  slurp("test_sinks_a.json", json_a, sizeof(json_a));
+  slurp("test_sinks_errors.log", errors, sizeof(errors));
+  TEST_ASSERT(count_matches(main_log, "Async fan-out") == 200 &&
+                  count_matches(json_a, "Async fan-out") == 200,
+              "Async main output and sink both get every record");
+  TEST_ASSERT(count_matches(errors, "Async") == 1, "ERROR sink filters");
+
+  clog_remove_sink(json_a_id);
+  clog_remove_sink(error_id);
+
+  int ids[CLOG_MAX_SINKS];
+  config.fp = json_out_a;
+  for (int i = 0; i < CLOG_MAX_SINKS; i++)
+    ids[i] = clog_add_sink(&config);
+  TEST_ASSERT(ids[CLOG_MAX_SINKS - 1] > 0 && clog_add_sink(&config) == -1,
+              "Table holds CLOG_MAX_SINKS sinks");
+  for (int i = 0; i < CLOG_MAX_SINKS; i++)
+    clog_remove_sink(ids[i]);
+  config.fp = NULL;
+  TEST_ASSERT(clog_add_sink(&config) == -1, "Sink needs a stream or fd");
+
+  clog_set_level(CLOG_TRACE);
+  clog_set_output(NULL);
+  fclose(main_out);
+  fclose(json_out_a);
+  fclose(json_out_b);
+  fclose(error_out);
+  remove("test_sinks_main.log");
+  remove("test_sinks_a.json");
+  remove("test_sinks_b.json");
+  remove("test_sinks_errors.log");
+  TEST_END("Multiple Sinks");
+}
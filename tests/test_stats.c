@@ -0,0 +1,121 @@
+#define CLOG_STATS
+#include "../clog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if !defined(_WIN32) && defined(_POSIX_THREADS)
+#include <pthread.h>
+#define HAS_STATS_THREADS 1
+#else
+#define HAS_STATS_THREADS 0
+#endif
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+#define STATS_THREADS 4
+#define STATS_PER_THREAD 1000
+
+#if HAS_STATS_THREADS
+static void *stats_thread_function(void *arg) {
+  (void)arg;
+  for (int i = 0; i < STATS_PER_THREAD; i++) {
+    WARN("Counted from a thread %d", i);
+    DEBUG("Filtered in a thread %d", i);
+  }
+  return NULL;
+}
+#endif
+
+extern void test_stats(void) {
+  TEST_START("Runtime Statistics");
+  clog_stats_t stats;
+
+  FILE *out = fopen("test_stats.log", "w");
+  TEST_ASSERT(out != NULL, "Open log file");
+  clog_set_output(out);
+  clog_set_level(CLOG_INFO);
+  clog_reset_stats();
+
+  for (int i = 0; i < 3; i++)
+    TRACE("Filtered %d", i);
+  for (int i = 0; i < 5; i++)
+    INFO("Emitted %d", i);
+  ERROR("Emitted error");
+  CLOG_EVERY_N(CLOG_DEBUG, 2, "Filtered by the sampling macro");
+  char long_message[CLOG_MAX_MESSAGE_SIZE + 100];
+  memset(long_message, 'x', sizeof(long_message) - 1);
+  long_message[sizeof(long_message) - 1] = '\0';
+  WARN("%s", long_message);
+  clog_flush();
+
+  clog_get_stats(&stats);
+  TEST_ASSERT(stats.filtered[CLOG_TRACE] == 3 && stats.filtered[CLOG_DEBUG] == 1,
+              "Filtered records counted per level");
+  TEST_ASSERT(stats.emitted[CLOG_INFO] == 5 &&
+                  stats.emitted[CLOG_ERROR] == 1 &&
+                  stats.emitted[CLOG_WARN] == 1 && stats.emitted[CLOG_TRACE] == 0,
+              "Emitted records counted per level");
+  TEST_ASSERT(stats.truncated == 1, "Over-long message counted as truncated");
+  long size = ftell(out);
+  TEST_ASSERT(size > 0 && stats.bytes_written == (uint64_t)size,
+              "Bytes written match the file size");
+  TEST_ASSERT(stats.writes == 7 && stats.write_errors == 0,
+              "One write per line, no errors");
+  TEST_ASSERT(stats.lock.acquisitions >= 7,
+              "Lock acquisitions included in the statistics");
+
+  clog_set_output(NULL);
+  fclose(out);
+
+  /* A stream opened for reading refuses writes */
+  FILE *read_only = fopen("test_stats.log", "r");
+  TEST_ASSERT(read_only != NULL, "Reopen log read-only");
+  clog_set_output(read_only);
+  INFO("Cannot be written");
+  clog_set_output(NULL);
+  fclose(read_only);
+  clog_get_stats(&stats);
+  TEST_ASSERT(stats.write_errors == 1, "Failed write counted");
+
+#if HAS_STATS_THREADS
+  out = fopen("test_stats.log", "w");
+  clog_set_output(out);
+  clog_reset_stats();
+  pthread_t threads[STATS_THREADS];
+  for (int i = 0; i < STATS_THREADS; i++)
+    pthread_create(&threads[i], NULL, stats_thread_function, NULL);
+  for (int i = 0; i < STATS_THREADS; i++)
+    pthread_join(threads[i], NULL);
+  clog_get_stats(&stats);
+  TEST_ASSERT(stats.emitted[CLOG_WARN] == STATS_THREADS * STATS_PER_THREAD &&
+                  stats.filtered[CLOG_DEBUG] ==
+                      STATS_THREADS * STATS_PER_THREAD,
+              "Sharded counters add up across threads");
+  clog_set_output(NULL);
+  fclose(out);
+#endif
+
+  clog_reset_stats();
+  clog_get_stats(&stats);
+  TEST_ASSERT(stats.emitted[CLOG_INFO] == 0 && stats.bytes_written == 0,
+              "Reset zeroes the counters");
+  clog_set_level(CLOG_TRACE);
+  remove("test_stats.log");
+  TEST_END("Runtime Statistics");
+}
@@ -0,0 +1,158 @@
+#include "../clog.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+#define STRUCTURED_LOG "test_structured.log"
+
+/* Byte-at-a-time reference for the vectorized scan */
+static size_t reference_scan(const char *s, size_t n, bool logfmt) {
+  for (size_t i = 0; i < n; i++) {
+    unsigned char c = (unsigned char)s[i];
+    if (c < 0x20 || c == '"' || c == '\\' ||
+        (logfmt && (c == ' ' || c == '=')))
+      return i;
+  }
+  return n;
+}
+
+/* Reads the whole log back as one string */
+static char *read_log(void) {
+  static char buf[8192];
+  FILE *file = fopen(STRUCTURED_LOG, "r");
+  if (!file)
+    return NULL;
+  size_t n = fread(buf, 1, sizeof(buf) - 1, file);
+  buf[n] = '\0';
+  fclose(file);
+  return buf;
+}
+
+static void log_sample(void) {
+  CLOG_KV(CLOG_INFO,
+          CLOG_FIELDS(clog_field_int("user", -42),
+                      clog_field_double("ratio", 0.1),
+                      clog_field_str("path", "C:\\tmp \"x\""),
+                      clog_field_bool("ok", true),
+                      clog_field_str("none", NULL)),
+          "Login\tfrom %s", "host\n1");
+}
+
+extern void test_structured(void) {
+  TEST_START("Structured Output");
+
+  FILE *out = fopen(STRUCTURED_LOG, "w");
+  TEST_ASSERT(out != NULL, "Open log file");
+  clog_set_output(out);
+  clog_set_show_timestamp(0);
+  clog_set_show_location(0);
+
+  clog_set_output_format(CLOG_FORMAT_JSON);
+  log_sample();
+  fflush(out);
+  TEST_ASSERT(strcmp(read_log(),
+                     "{\"level\":\"INFO\",\"msg\":\"Login\\tfrom host\\n1\","
+                     "\"user\":-42,\"ratio\":0.1,"
+                     "\"path\":\"C:\\\\tmp \\\"x\\\"\",\"ok\":true,"
+                     "\"none\":null}\n") == 0,
+              "JSON line with typed fields and escapes");
+
+  freopen(STRUCTURED_LOG, "w", out);
+  clog_set_output_format(CLOG_FORMAT_LOGFMT);
+  log_sample();
+  INFO("plain");
+  fflush(out);
+  TEST_ASSERT(strcmp(read_log(),
+                     "level=INFO msg=\"Login\\tfrom host\\n1\" user=-42 "
+                     "ratio=0.1 path=\"C:\\\\tmp \\\"x\\\"\" ok=true none=\n"
+                     "level=INFO msg=plain\n") == 0,
+              "logfmt quotes only values that need it");
+
+  freopen(STRUCTURED_LOG, "w", out);
+  CLOG_KV(CLOG_INFO,
+          CLOG_FIELDS(clog_field_int("user id", 1), clog_field_bool("a=b", true),
+                      clog_field_str("say \"hi\"", "x")),
+          "Keys");
+  fflush(out);
+  TEST_ASSERT(strcmp(read_log(), "level=INFO msg=Keys \"user id\"=1 "
+                                 "\"a=b\"=true \"say \\\"hi\\\"\"=x\n") == 0,
+              "logfmt quotes keys that need it");
+
+  freopen(STRUCTURED_LOG, "w", out);
+  clog_set_output_format(CLOG_FORMAT_TEXT);
+  CLOG_KV(CLOG_WARN, CLOG_FIELDS(clog_field_int("retries", 3)), "Slow");
+  fflush(out);
+  TEST_ASSERT(strcmp(read_log(), "[WARN] Slow retries=3\n") == 0,
+              "Text layout appends fields to the message");
+
+  freopen(STRUCTURED_LOG, "w", out);
+  clog_set_output_format(CLOG_FORMAT_JSON);
+  clog_set_show_timestamp(1);
+  clog_set_show_location(1);
+  INFO("Located");
+  fflush(out);
+  char *line = read_log();
+  TEST_ASSERT(strncmp(line, "{\"ts\":\"", 7) == 0, "Timestamp comes first");
+  TEST_ASSERT(strstr(line, "\"file\":\"test_structured.c\",\"line\":") &&
+                  strstr(line, "\"func\":\"test_structured\"}\n"),
+              "Location rendered as fields");
+
+  /* A message made of escapes overflows the line; it must still close */
+  char quotes[CLOG_MAX_MESSAGE_SIZE];
+  memset(quotes, '"', sizeof(quotes) - 1);
+  quotes[sizeof(quotes) - 1] = '\0';
+  freopen(STRUCTURED_LOG, "w", out);
+  CLOG_KV(CLOG_ERROR, CLOG_FIELDS(clog_field_str("tail", quotes)), "%s",
+          quotes);
+  fflush(out);
+  line = read_log();
+  size_t len = strlen(line);
+  TEST_ASSERT(len < CLOG_MAX_LINE_SIZE && len > 2 &&
+                  strcmp(line + len - 3, "\\\"}\n") != 0 &&
+                  strcmp(line + len - 2, "}\n") == 0,
+              "Truncated JSON line stays well formed");
+  TEST_ASSERT(strstr(line, "\"tail\"") == NULL,
+              "Field that does not fit is dropped whole");
+
+  clog_set_output_format(CLOG_FORMAT_TEXT);
+  clog_set_output(NULL);
+  fclose(out);
+  remove(STRUCTURED_LOG);
+
+  /* Every length and position, so each vector width and tail is covered */
+  char buf[160];
+  bool same = true;
+  for (size_t n = 0; n < 100 && same; n++) {
+    for (size_t pos = 0; pos <= n && same; pos++) {
+      const char specials[] = {'"', '\\', '\n', 0x1f, ' ', '=', (char)0xc3};
+      for (size_t k = 0; k < sizeof(specials); k++) {
+        memset(buf, 'a', n);
+        if (pos < n)
+          buf[pos] = specials[k];
+        if (clog_escape_scan(buf, n, false) != reference_scan(buf, n, false) ||
+            clog_escape_scan(buf, n, true) != reference_scan(buf, n, true))
+          same = false;
+      }
+    }
+  }
+  TEST_ASSERT(same, "Vectorized scan matches the scalar reference");
+  TEST_END("Structured Output");
+}
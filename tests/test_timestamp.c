@@ -0,0 +1,141 @@
+#include "../clog.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TEST_ASSERT(condition, message)                                        \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "❌ ASSERTION FAILED: %s\n", message);                   \
+      exit(EXIT_FAILURE);                                                      \
+    } else {                                                                   \
+      printf("✅ PASSED: %s\n", message);                                      \
+    }                                                                          \
+  } while (0)
+
+#define TEST_START(name)                                                       \
+  printf("\n🧪 Starting test: %s\n", name);                                    \
+  printf("=====================================\n")
+
+#define TEST_END(name)                                                         \
+  printf("✅ Test completed: %s\n", name);                                     \
+  printf("=====================================\n")
+
+/* '#' matches a digit, anything else must match literally */
+static int matches_pattern(const char *str, const char *pattern) {
+  size_t i = 0;
+  for (; pattern[i]; i++) {
+    if (pattern[i] == '#' ? !isdigit((unsigned char)str[i])
+                          : str[i] != pattern[i])
+      return 0;
+  }
+  return str[i] == '\0';
+}
+
+/* Compares our rendering with strftime down to the minute, retrying if the
+ * two calls straddle a minute boundary */
+static int matches_libc(bool utc, const char *strftime_format) {
+  for (int attempt = 0; attempt < 3; attempt++) {
+    char ours[CLOG_MAX_TIME_SIZE];
+    char libc[64];
+    time_t now = time(NULL);
+    clog_format_time(ours, sizeof(ours));
+    struct tm tm_storage;
+#ifdef _WIN32
+    if (utc)
+      gmtime_s(&tm_storage, &now);
+    else
+      localtime_s(&tm_storage, &now);
+#else
+    if (utc)
+      gmtime_r(&now, &tm_storage);
+    else
+      localtime_r(&now, &tm_storage);
+#endif
+    strftime(libc, sizeof(libc), strftime_format, &tm_storage);
+    if (strncmp(ours, libc, strlen(libc)) == 0)
+      return 1;
+  }
+  return 0;
+}
+
+extern void test_timestamp(void) {
+  TEST_START("Timestamp Engine");
+  char buf[CLOG_MAX_TIME_SIZE];
+
+  size_t len = clog_format_time(buf, sizeof(buf));
+  TEST_ASSERT(len == strlen(buf) &&
+                  matches_pattern(buf, "####-##-## ##:##:##"),
+              "Default layout is YYYY-MM-DD HH:MM:SS");
+  TEST_ASSERT(matches_libc(false, "%Y-%m-%d %H:%M"),
+              "Default layout matches localtime");
+
+  clog_set_time_precision(CLOG_TIME_MILLIS);
+  clog_format_time(buf, sizeof(buf));
+  TEST_ASSERT(matches_pattern(buf, "####-##-## ##:##:##.###"),
+              "Millisecond fraction appended");
+  clog_set_time_precision(CLOG_TIME_MICROS);
+  clog_format_time(buf, sizeof(buf));
+  TEST_ASSERT(matches_pattern(buf, "####-##-## ##:##:##.######"),
+              "Microsecond fraction appended");
+
+  clog_set_time_precision(CLOG_TIME_NANOS);
+  clog_set_time_format(CLOG_TIME_FORMAT_ISO8601);
+  clog_set_time_utc(true);
+  clog_format_time(buf, sizeof(buf));
+  TEST_ASSERT(matches_pattern(buf, "####-##-##T##:##:##.#########Z"),
+              "ISO-8601 UTC layout with nanoseconds");
+  TEST_ASSERT(matches_libc(true, "%Y-%m-%dT%H:%M"), "UTC matches gmtime");
+
+  clog_set_time_coarse(true);
+  clog_format_time(buf, sizeof(buf));
+  TEST_ASSERT(matches_pattern(buf, "####-##-##T##:##:##.#########Z"),
+              "Coarse clock renders the same layout");
+  clog_set_time_coarse(false);
+
+#ifndef _WIN32
+  const char *saved_tz = getenv("TZ");
+  char saved[128] = {0};
+  if (saved_tz)
+    snprintf(saved, sizeof(saved), "%s", saved_tz);
+  setenv("TZ", "<+0530>-5:30", 1);
+  tzset();
+  clog_set_time_utc(false);
+  clog_set_time_precision(CLOG_TIME_SECONDS);
+  clog_format_time(buf, sizeof(buf));
+  TEST_ASSERT(matches_pattern(buf, "####-##-##T##:##:##+05:30"),
+              "ISO-8601 local layout carries the UTC offset");
+  TEST_ASSERT(matches_libc(false, "%Y-%m-%dT%H:%M"),
+              "Cached offset matches localtime");
+  if (saved_tz)
+    setenv("TZ", saved, 1);
+  else
+    unsetenv("TZ");
+  tzset();
+#endif
+
+  clog_set_time_format(CLOG_TIME_FORMAT_DEFAULT);
+  clog_set_time_utc(false);
+  clog_set_time_precision(CLOG_TIME_MILLIS);
+  FILE *file = fopen("test_timestamp.log", "w");
+  TEST_ASSERT(file != NULL, "Open log file");
+  clog_set_output(file);
+  clog_set_show_location(0);
+  INFO("Timestamped");
+  fclose(file);
+  clog_set_output(NULL);
+  clog_set_show_location(1);
+  clog_set_time_precision(CLOG_TIME_SECONDS);
+
+  file = fopen("test_timestamp.log", "r");
+  TEST_ASSERT(file != NULL, "Reopen log file");
+  char line[256] = {0};
+  fgets(line, sizeof(line), file);
+  fclose(file);
+  remove("test_timestamp.log");
+  TEST_ASSERT(
+      matches_pattern(line, "####-##-## ##:##:##.### [INFO] Timestamped\n"),
+      "Log line carries millisecond timestamp");
+  TEST_END("Timestamp Engine");
+}
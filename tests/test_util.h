@@ -0,0 +1,45 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+/* File and text helpers shared by the tests */
+#include <stdio.h>
+#include <string.h>
+
+/* Reads a whole file into buf, always terminated; returns the bytes read,
+ * 0 if the file cannot be opened */
+static inline size_t slurp(const char *path, char *buf, size_t size) {
+  FILE *file = fopen(path, "rb");
+  size_t n = 0;
+  if (file) {
+    n = fread(buf, 1, size - 1, file);
+    fclose(file);
+  }
+  buf[n] = '\0';
+  return n;
+}
+
+/* Counts the occurrences of needle in text */
+static inline int count_matches(const char *text, const char *needle) {
+  int count = 0;
+  for (const char *p = text; (p = strstr(p, needle)) != NULL; p++)
+    count++;
+  return count;
+}
+
+/* Counts the lines of a file that contain needle, or -1 if it cannot be
+ * opened */
+static inline int count_lines(const char *path, const char *needle) {
+  FILE *file = fopen(path, "r");
+  if (!file)
+    return -1;
+  char buf[512];
+  int lines = 0;
+  while (fgets(buf, sizeof(buf), file)) {
+    if (strstr(buf, needle))
+      lines++;
+  }
+  fclose(file);
+  return lines;
+}
+
+#endif
@@ -0,0 +1,42 @@
+/* clog-decode: turns a clog binary log back into text.
+ *
+ * Usage: clog-decode [input [output]]
+ * Reads stdin and writes stdout when the paths are omitted or "-". */
+#include "../clog.h"
+#include <stdio.h>
+#include <string.h>
+
+int main(int argc, char **argv) {
+  FILE *in = stdin;
+  FILE *out = stdout;
+
+  if (argc > 3) {
+    fprintf(stderr, "usage: %s [input [output]]\n", argv[0]);
+    return 2;
+  }
+  if (argc > 1 && strcmp(argv[1], "-") != 0) {
+    in = fopen(argv[1], "rb");
+    if (!in) {
+      perror(argv[1]);
+      return 1;
+    }
+  }
+  if (argc > 2 && strcmp(argv[2], "-") != 0) {
+    out = fopen(argv[2], "w");
+    if (!out) {
+      perror(argv[2]);
+      return 1;
+    }
+  }
+
+  bool ok = clog_binary_decode(in, out);
+  if (!ok)
+    fprintf(stderr, "%s: malformed or truncated binary log\n", argv[0]);
+
+  if (in != stdin)
+    fclose(in);
+  if (out != stdout)
+    fclose(out);
+  clog_cleanup();
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,238 @@
+/* clogctl: inspects and steers processes that publish a clog control
+ * block (clog_set_control, or building with CLOG_CONTROL).
+ *
+ * Usage: clogctl [-d dir] list
+ *        clogctl [-d dir] show <pid>
+ *        clogctl [-d dir] level <pid> <trace|debug|info|warn|error|fatal>
+ *        clogctl [-d dir] clean
+ * dir defaults to CLOG_CONTROL_DIR. */
+#include "../clog.h"
+#include <stdio.h>
+#include <string.h>
+
+#if CLOG_HAS_CONTROL
+#include <dirent.h>
+#include <strings.h>
+
+/* How long "level" waits for the control thread to apply a request */
+#define CTL_APPLY_TIMEOUT_MS 2000
+
+/* Maps dir/clog.<pid>; NULL if it is missing or not a control block */
+static clog_control_t *ctl_open(const char *dir, long pid) {
+  char path[512];
+  struct stat st;
+  snprintf(path, sizeof(path), "%s/clog.%ld", dir, pid);
+  int fd = open(path, O_RDWR | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+  if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(clog_control_t)) {
+    close(fd);
+    return NULL;
+  }
+  void *map = mmap(NULL, sizeof(clog_control_t), PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return NULL;
+  clog_control_t *block = (clog_control_t *)map;
+  if (atomic_load_explicit(&block->magic, memory_order_acquire) !=
+          CLOG_CONTROL_MAGIC ||
+      block->version != CLOG_CONTROL_VERSION) {
+    munmap(map, sizeof(clog_control_t));
+    return NULL;
+  }
+  return block;
+}
+
+static void ctl_sleep_ms(unsigned int ms) {
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+  nanosleep(&ts, NULL);
+}
+
+static void ctl_close(clog_control_t *block) {
+  munmap(block, sizeof(clog_control_t));
+}
+
+/* A process that exited without clog_cleanup leaves its block behind */
+static bool ctl_alive(long pid) {
+  return kill((pid_t)pid, 0) == 0 || errno == EPERM;
+}
+
+/* Parses the pid out of a "clog.<pid>" file name, or returns -1 */
+static long ctl_pid_of(const char *name) {
+  if (strncmp(name, "clog.", 5) != 0 || !name[5])
+    return -1;
+  char *end;
+  long pid = strtol(name + 5, &end, 10);
+  return *end || pid <= 0 ? -1 : pid;
+}
+
+static bool ctl_parse_level(const char *name, clog_level_t *level) {
+  for (int i = CLOG_TRACE; i <= CLOG_FATAL; i++) {
+    if (strcasecmp(name, clog_level_string((clog_level_t)i)) == 0) {
+      *level = (clog_level_t)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static uint64_t ctl_sum(atomic_uint_least64_t *counters) {
+  uint64_t sum = 0;
+  for (int i = CLOG_TRACE; i <= CLOG_FATAL; i++)
+    sum += atomic_load_explicit(&counters[i], memory_order_relaxed);
+  return sum;
+}
+
+static int ctl_list(const char *dir, bool clean) {
+  DIR *d = opendir(dir);
+  if (!d) {
+    perror(dir);
+    return 1;
+  }
+  if (!clean)
+    printf("%-8s %-6s %-6s %12s %12s %10s  %s\n", "PID", "LEVEL", "MIN",
+           "EMITTED", "FILTERED", "DROPPED", "STATE");
+  struct dirent *entry;
+  while ((entry = readdir(d)) != NULL) {
+    long pid = ctl_pid_of(entry->d_name);
+    if (pid < 0)
+      continue;
+    bool alive = ctl_alive(pid);
+    if (clean) {
+      if (!alive) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if (unlink(path) == 0)
+          printf("removed %s\n", path);
+        else
+          perror(path);
+      }
+      continue;
+    }
+    clog_control_t *block = ctl_open(dir, pid);
+    if (!block)
+      continue;
+    printf("%-8ld %-6s %-6s %12llu %12llu %10llu  %s\n", pid,
+           clog_level_string((clog_level_t)atomic_load(&block->level)),
+           clog_level_string((clog_level_t)atomic_load(&block->min_level)),
+           (unsigned long long)ctl_sum(block->emitted),
+           (unsigned long long)ctl_sum(block->filtered),
+           (unsigned long long)atomic_load(&block->dropped),
+           alive ? "running" : "stale");
+    ctl_close(block);
+  }
+  closedir(d);
+  return 0;
+}
+
+static int ctl_show(const char *dir, long pid) {
+  clog_control_t *block = ctl_open(dir, pid);
+  if (!block) {
+    fprintf(stderr, "clogctl: no control block for pid %ld in %s\n", pid, dir);
+    return 1;
+  }
+  printf("pid           %ld%s\n", pid, ctl_alive(pid) ? "" : " (stale)");
+  printf("level         %s\n",
+         clog_level_string((clog_level_t)atomic_load(&block->level)));
+  printf("min level     %s\n",
+         clog_level_string((clog_level_t)atomic_load(&block->min_level)));
+  printf("%-13s %12s %12s\n", "", "emitted", "filtered");
+  for (int i = CLOG_TRACE; i <= CLOG_FATAL; i++)
+    printf("%-13s %12llu %12llu\n", clog_level_string((clog_level_t)i),
+           (unsigned long long)atomic_load(&block->emitted[i]),
+           (unsigned long long)atomic_load(&block->filtered[i]));
+  printf("bytes written %llu\n",
+         (unsigned long long)atomic_load(&block->bytes_written));
+  printf("truncated     %llu\n",
+         (unsigned long long)atomic_load(&block->truncated));
+  printf("write errors  %llu\n",
+         (unsigned long long)atomic_load(&block->write_errors));
+  printf("dropped       %llu\n",
+         (unsigned long long)atomic_load(&block->dropped));
+  printf("blocked       %llu\n",
+         (unsigned long long)atomic_load(&block->blocked));
+  printf("publishes     %u\n", atomic_load(&block->publishes));
+  ctl_close(block);
+  return 0;
+}
+
+static int ctl_level(const char *dir, long pid, const char *name) {
+  clog_level_t level;
+  if (!ctl_parse_level(name, &level)) {
+    fprintf(stderr, "clogctl: unknown level '%s'\n", name);
+    return 2;
+  }
+  clog_control_t *block = ctl_open(dir, pid);
+  if (!block) {
+    fprintf(stderr, "clogctl: no control block for pid %ld in %s\n", pid, dir);
+    return 1;
+  }
+  atomic_store(&block->requested_level, (int)level);
+  /* The control thread takes the request and republishes the level */
+  bool applied = false;
+  for (int waited = 0; waited < CTL_APPLY_TIMEOUT_MS; waited += 10) {
+    if (atomic_load(&block->requested_level) == CLOG_CONTROL_NO_REQUEST &&
+        atomic_load(&block->level) == (int)level) {
+      applied = true;
+      break;
+    }
+    ctl_sleep_ms(10);
+  }
+  ctl_close(block);
+  if (!applied) {
+    fprintf(stderr, "clogctl: pid %ld did not apply the level\n", pid);
+    return 1;
+  }
+  printf("pid %ld level %s\n", pid, clog_level_string(level));
+  return 0;
+}
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [-d dir] list | show <pid> | level <pid> <level> | "
+          "clean\n",
+          argv0);
+}
+
+int main(int argc, char **argv) {
+  const char *dir = CLOG_CONTROL_DIR;
+  int arg = 1;
+  if (arg + 1 < argc && strcmp(argv[arg], "-d") == 0) {
+    dir = argv[arg + 1];
+    arg += 2;
+  }
+  if (arg >= argc) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  const char *command = argv[arg];
+  int rest = argc - arg - 1;
+  long pid = -1;
+  if (rest > 0) {
+    char *end;
+    pid = strtol(argv[arg + 1], &end, 10);
+    if (*end)
+      pid = -1;
+  }
+
+  if (strcmp(command, "list") == 0 && rest == 0)
+    return ctl_list(dir, false);
+  if (strcmp(command, "clean") == 0 && rest == 0)
+    return ctl_list(dir, true);
+  if (strcmp(command, "show") == 0 && rest == 1 && pid > 0)
+    return ctl_show(dir, pid);
+  if (strcmp(command, "level") == 0 && rest == 2 && pid > 0)
+    return ctl_level(dir, pid, argv[arg + 2]);
+  usage(argv[0]);
+  return 2;
+}
+#else
+int main(void) {
+  fprintf(stderr, "clogctl: POSIX only\n");
+  return 1;
+}
+#endif